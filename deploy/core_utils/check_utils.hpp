@@ -0,0 +1,34 @@
+/**
+ * @FlieName check_utils
+ * @description: core_utils 下各检查程序共用的断言宏与结果汇总
+ **/
+#pragma once
+
+#include <iostream>
+
+namespace easy_deploy {
+
+// 失败的检查项数，每个检查程序一份
+inline int g_failed_checks = 0;
+
+// 汇总检查结果，作为 main 的返回值
+inline int ReportCheckResult() {
+    if (g_failed_checks != 0) {
+        std::cerr << "[ERROR] " << g_failed_checks << " 项检查失败！" << std::endl;
+        return 1;
+    }
+    std::cout << "[INFO] 全部检查通过！" << std::endl;
+    return 0;
+}
+
+} // namespace easy_deploy
+
+// 条件不成立时打印位置并计数，不中断后续检查
+#define EXPECT_TRUE(cond)                                                                     \
+    do {                                                                                      \
+        if (!(cond)) {                                                                        \
+            std::cerr << "[ERROR] " << __FILE__ << ":" << __LINE__ << " 检查失败：" #cond    \
+                      << std::endl;                                                           \
+            ++::easy_deploy::g_failed_checks;                                                 \
+        }                                                                                     \
+    } while (0)
@@ -0,0 +1,234 @@
+/**
+ * @FlieName test_batch_inference
+ * @description: 动态批处理行为检查：批处理块按包上报失败，OrtInferCore 批量推理的输入聚合、
+ *               输出分发与静态 batch 模型的逐包回退，以及 buffer 在多个 onnxruntime 副本间流转
+ **/
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <vector>
+
+#include "check_utils.hpp"
+#include "deploy_core/async_pipeline.hpp"
+#include "deploy_core/base_infer_core.hpp"
+#include "deploy_core/infer_core_pool.hpp"
+#include "ort_core/ort_core.hpp"
+
+using namespace easy_deploy;
+
+using PackagePtr = std::shared_ptr<IPipelinePackage>;
+
+// 单个 Identity 节点的 onnx 模型，input/output 形状为 [batch, 4]，batch 维为动态
+static const unsigned char kIdentityDynamicBatch[] = {
+    0x08, 0x07, 0x42, 0x04, 0x0a, 0x00, 0x10, 0x0d, 0x3a, 0x62, 0x0a, 0x19, 0x0a, 0x05, 0x69,
+    0x6e, 0x70, 0x75, 0x74, 0x12, 0x06, 0x6f, 0x75, 0x74, 0x70, 0x75, 0x74, 0x22, 0x08, 0x49,
+    0x64, 0x65, 0x6e, 0x74, 0x69, 0x74, 0x79, 0x12, 0x08, 0x69, 0x64, 0x65, 0x6e, 0x74, 0x69,
+    0x74, 0x79, 0x5a, 0x1c, 0x0a, 0x05, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x12, 0x13, 0x0a, 0x11,
+    0x08, 0x01, 0x12, 0x0d, 0x0a, 0x07, 0x12, 0x05, 0x62, 0x61, 0x74, 0x63, 0x68, 0x0a, 0x02,
+    0x08, 0x04, 0x62, 0x1d, 0x0a, 0x06, 0x6f, 0x75, 0x74, 0x70, 0x75, 0x74, 0x12, 0x13, 0x0a,
+    0x11, 0x08, 0x01, 0x12, 0x0d, 0x0a, 0x07, 0x12, 0x05, 0x62, 0x61, 0x74, 0x63, 0x68, 0x0a,
+    0x02, 0x08, 0x04};
+
+// 同上，batch 维固定为 1
+static const unsigned char kIdentityStaticBatch[] = {
+    0x08, 0x07, 0x42, 0x04, 0x0a, 0x00, 0x10, 0x0d, 0x3a, 0x58, 0x0a, 0x19, 0x0a, 0x05, 0x69,
+    0x6e, 0x70, 0x75, 0x74, 0x12, 0x06, 0x6f, 0x75, 0x74, 0x70, 0x75, 0x74, 0x22, 0x08, 0x49,
+    0x64, 0x65, 0x6e, 0x74, 0x69, 0x74, 0x79, 0x12, 0x08, 0x69, 0x64, 0x65, 0x6e, 0x74, 0x69,
+    0x74, 0x79, 0x5a, 0x17, 0x0a, 0x05, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x12, 0x0e, 0x0a, 0x0c,
+    0x08, 0x01, 0x12, 0x08, 0x0a, 0x02, 0x08, 0x01, 0x0a, 0x02, 0x08, 0x04, 0x62, 0x18, 0x0a,
+    0x06, 0x6f, 0x75, 0x74, 0x70, 0x75, 0x74, 0x12, 0x0e, 0x0a, 0x0c, 0x08, 0x01, 0x12, 0x08,
+    0x0a, 0x02, 0x08, 0x01, 0x0a, 0x02, 0x08, 0x04};
+
+struct ValuePackage : public IPipelinePackage {
+    int                          value = 0;
+    std::shared_ptr<BlobsTensor> blobs;
+
+    BlobsTensor *GetInferBuffer() override {
+        return blobs.get();
+    }
+};
+
+struct GenValue {
+    int operator()(const PackagePtr &package) {
+        return std::static_pointer_cast<ValuePackage>(package)->value;
+    }
+};
+
+struct GenOutput {
+    std::vector<float> operator()(const PackagePtr &package) {
+        const float *output = package->GetInferBuffer()->GetTensor("output")->Cast<float>();
+        return std::vector<float>(output, output + 4);
+    }
+};
+
+// 只有一个批处理块：值乘 10，值为 3 的倍数的包失败；fail_whole_batch 时整批返回 false
+class FakeBatchPipeline : public BaseAsyncPipeline<int, GenValue> {
+public:
+    explicit FakeBatchPipeline(bool fail_whole_batch) {
+        auto block = BuildPipelineBlock([](PackagePtr) { return true; }, "FakeBatch");
+        block.SetBatchFunc(
+            [this, fail_whole_batch](const std::vector<PackagePtr> &packages,
+                                     std::vector<bool>              &results) {
+                int max_size = max_batch_size.load();
+                while (static_cast<int>(packages.size()) > max_size &&
+                       !max_batch_size.compare_exchange_weak(max_size, packages.size())) {
+                }
+                int last = -1;
+                for (size_t i = 0; i < packages.size(); ++i) {
+                    auto package = std::static_pointer_cast<ValuePackage>(packages[i]);
+                    if (package->value <= last) {
+                        in_order = false;
+                    }
+                    last = package->value;
+                    results[i] = package->value % 3 != 0;
+                    package->value *= 10;
+                }
+                return !fail_whole_batch;
+            },
+            4, std::chrono::milliseconds(20));
+        ConfigPipeline("batch", {AsyncPipelineContext<PackagePtr>(
+                                    std::vector<AsyncPipelineBlock<PackagePtr>>{block})});
+        InitPipeline();
+    }
+
+    std::future<int> Push(int value) {
+        auto package   = std::make_shared<ValuePackage>();
+        package->value = value;
+        return PushPipeline("batch", package);
+    }
+
+    std::atomic<int>  max_batch_size{0};
+    std::atomic<bool> in_order{true};
+};
+
+// 复用推理核心的流水线上下文，包的 input 为 [base, base+1, base+2, base+3]
+class OrtBatchRunner : public BaseAsyncPipeline<std::vector<float>, GenOutput> {
+public:
+    explicit OrtBatchRunner(BaseInferCore *core) : core_(core) {
+        ConfigPipeline("batch", {core_->GetPipelineContext()});
+        InitPipeline();
+    }
+
+    std::future<std::vector<float>> Push(float base) {
+        auto package   = std::make_shared<ValuePackage>();
+        package->blobs = core_->GetBuffer(true);
+        float *input   = package->blobs->GetTensor("input")->Cast<float>();
+        for (int i = 0; i < 4; ++i) {
+            input[i] = base + i;
+        }
+        return PushPipeline("batch", package);
+    }
+
+private:
+    BaseInferCore *core_;
+};
+
+static bool ThrowsFromFuture(std::future<int> &future) {
+    try {
+        future.get();
+    } catch (const std::exception &) {
+        return true;
+    }
+    return false;
+}
+
+// 一批中只有失败的包被丢弃，其余包的结果回到各自的 future
+void TestFailedPackagesOnly() {
+    FakeBatchPipeline pipeline(false);
+    std::vector<std::future<int>> futures;
+    for (int i = 1; i <= 12; ++i) {
+        futures.push_back(pipeline.Push(i));
+    }
+    for (int i = 1; i <= 12; ++i) {
+        auto &future = futures[i - 1];
+        if (i % 3 == 0) {
+            EXPECT_TRUE(ThrowsFromFuture(future));
+        } else {
+            EXPECT_TRUE(future.get() == i * 10);
+        }
+    }
+    EXPECT_TRUE(pipeline.max_batch_size.load() > 1);
+    EXPECT_TRUE(pipeline.in_order.load());
+}
+
+// 批处理函数返回 false 时整批失败
+void TestWholeBatchFails() {
+    FakeBatchPipeline pipeline(true);
+    std::vector<std::future<int>> futures;
+    for (int i = 1; i <= 8; ++i) {
+        futures.push_back(pipeline.Push(i));
+    }
+    for (auto &future : futures) {
+        EXPECT_TRUE(ThrowsFromFuture(future));
+    }
+}
+
+static std::string WriteModel(const std::string &name, const unsigned char *data, size_t size) {
+    const auto    path = std::filesystem::temp_directory_path() / name;
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char *>(data), size);
+    return path.string();
+}
+
+// 每个包的输出与自己的输入一致，即输入按包聚合、输出分发回原来的包
+static void CheckIdentityBatches(BaseInferCore *core) {
+    OrtBatchRunner                                runner(core);
+    std::vector<std::future<std::vector<float>>> futures;
+    for (int i = 0; i < 8; ++i) {
+        futures.push_back(runner.Push(i * 10.f));
+    }
+    for (int i = 0; i < 8; ++i) {
+        const auto output = futures[i].get();
+        bool       same   = output.size() == 4;
+        for (int j = 0; same && j < 4; ++j) {
+            same = output[j] == i * 10.f + j;
+        }
+        EXPECT_TRUE(same);
+    }
+}
+
+void TestOrtDynamicBatch() {
+    const auto model_path =
+        WriteModel("test_batch_identity_dynamic.onnx", kIdentityDynamicBatch,
+                   sizeof(kIdentityDynamicBatch));
+    auto core = CreateOrtInferCore(model_path, {{"input", {1, 4}}}, {{"output", {1, 4}}});
+    core->EnableDynamicBatching(4, std::chrono::milliseconds(20));
+    CheckIdentityBatches(core.get());
+    std::filesystem::remove(model_path);
+}
+
+// 静态 batch 模型无法真正合批，回退为逐包推理
+void TestOrtStaticBatchFallback() {
+    const auto model_path = WriteModel("test_batch_identity_static.onnx", kIdentityStaticBatch,
+                                       sizeof(kIdentityStaticBatch));
+    auto       core       = CreateOrtInferCore(model_path);
+    core->EnableDynamicBatching(4, std::chrono::milliseconds(20));
+    CheckIdentityBatches(core.get());
+    std::filesystem::remove(model_path);
+}
+
+// 副本各有自己的 session，buffer 在副本间流转时每个 session 使用自己的绑定
+void TestOrtReplicaPool() {
+    const auto model_path = WriteModel("test_batch_identity_pool.onnx", kIdentityStaticBatch,
+                                       sizeof(kIdentityStaticBatch));
+    auto       pool       = CreateInferCorePool(CreateOrtInferCoreFactory(model_path), 3);
+    for (int round = 0; round < 4; ++round) {
+        CheckIdentityBatches(pool.get());
+    }
+    pool.reset();
+    std::filesystem::remove(model_path);
+}
+
+int main() {
+    std::cout << "===== 动态批处理行为检查 =====" << std::endl;
+    TestFailedPackagesOnly();
+    TestWholeBatchFails();
+    TestOrtDynamicBatch();
+    TestOrtStaticBatchFallback();
+    TestOrtReplicaPool();
+
+    return ReportCheckResult();
+}
@@ -0,0 +1,270 @@
+/**
+ * @FlieName test_cover_oldest
+ * @description: cover_oldest 行为检查：满队列时丢弃最旧的包并上报 PIPELINE_DROPPED，
+ *               其 blobs buffer 回到内存池，多线程块的保序输出不会卡在被丢弃的包上
+ **/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "check_utils.hpp"
+#include "deploy_core/async_pipeline.hpp"
+#include "deploy_core/base_infer_core.hpp"
+
+using namespace easy_deploy;
+
+using PackagePtr = std::shared_ptr<IPipelinePackage>;
+
+// 只提供空的 blobs buffer，供 MemBufferPool 使用
+class FakeInferCore : public IRotInferCore {
+public:
+    std::unique_ptr<BlobsTensor> AllocBlobsBuffer() override {
+        return std::make_unique<BlobsTensor>(
+            std::unordered_map<std::string, std::unique_ptr<ITensor>>{});
+    }
+
+    bool PreProcess(std::shared_ptr<IPipelinePackage>) override {
+        return true;
+    }
+
+    bool Inference(std::shared_ptr<IPipelinePackage>) override {
+        return true;
+    }
+
+    bool PostProcess(std::shared_ptr<IPipelinePackage>) override {
+        return true;
+    }
+};
+
+struct ValuePackage : public IPipelinePackage {
+    int                          value = 0;
+    std::shared_ptr<BlobsTensor> blobs;
+
+    BlobsTensor *GetInferBuffer() override {
+        return blobs.get();
+    }
+};
+
+struct GenValue {
+    int operator()(const PackagePtr &package) {
+        return std::static_pointer_cast<ValuePackage>(package)->value;
+    }
+};
+
+// 两个线程执行的块，闸门打开前停在块内，使输入队列被填满。cover_all_queues 时所有队列都丢弃
+// 最旧的包，否则只有 Push 的输入队列如此
+class GatedPipeline : public BaseAsyncPipeline<int, GenValue> {
+public:
+    GatedPipeline(MemBufferPool &pool, bool cover_all_queues) : pool_(pool) {
+        auto block = BuildPipelineBlock(
+            [this](PackagePtr) {
+                entered_.fetch_add(1);
+                std::unique_lock<std::mutex> lck(gate_mutex_);
+                gate_cv_.wait(lck, [this]() { return gate_open_; });
+                return true;
+            },
+            "Gate", 2);
+        ConfigPipeline("cover", {AsyncPipelineContext<PackagePtr>(
+                                    std::vector<AsyncPipelineBlock<PackagePtr>>{block})});
+        PipelineOptions options;
+        options.queue_max_size = 2;
+        options.cover_oldest   = cover_all_queues;
+        InitPipeline(options);
+    }
+
+    PackagePtr CreatePackage(int value) {
+        auto package   = std::make_shared<ValuePackage>();
+        package->value = value;
+        package->blobs = AcquireForPush<BlobsTensor>(
+            "cover", true, [this](bool block) { return pool_.Alloc(block); });
+        return package;
+    }
+
+    bool Push(int value, PipelineCallback<int> on_done) {
+        return PushPipeline("cover", CreatePackage(value), std::move(on_done), nullptr, true);
+    }
+
+    std::future<int> Push(int value) {
+        return PushPipeline("cover", CreatePackage(value), true);
+    }
+
+    void WaitEntered(int count) {
+        while (entered_.load() < count) {
+            std::this_thread::yield();
+        }
+    }
+
+    void OpenGate() {
+        {
+            std::lock_guard<std::mutex> lck(gate_mutex_);
+            gate_open_ = true;
+        }
+        gate_cv_.notify_all();
+    }
+
+private:
+    MemBufferPool          &pool_;
+    std::atomic<int>        entered_{0};
+    std::mutex              gate_mutex_;
+    std::condition_variable gate_cv_;
+    bool                    gate_open_ = false;
+};
+
+// 包在回调返回后才释放，等待所有 buffer 回到内存池
+static bool WaitPoolFull(MemBufferPool &pool) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool.RemainSize() != static_cast<int>(pool.PoolSize())) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// 0、1 停在块内，2、3 填满输入队列；内存池耗尽后 4、5 分别顶替 2、3
+void TestEvictOldest() {
+    FakeInferCore core;
+    MemBufferPool pool(&core, 4);
+    GatedPipeline pipeline(pool, false);
+
+    std::mutex                  mutex;
+    std::condition_variable     cv;
+    std::vector<PipelineStatus> status(6, PIPELINE_FAILED);
+    std::vector<int>            output_order;
+    int                         done_count = 0;
+    auto                        func_on_done = [&](int value) {
+        return [&, value](PipelineStatus s, int result) {
+            std::lock_guard<std::mutex> lck(mutex);
+            status[value] = s;
+            if (s == PIPELINE_SUCCESS) {
+                output_order.push_back(result);
+            }
+            ++done_count;
+            cv.notify_all();
+        };
+    };
+
+    EXPECT_TRUE(pipeline.Push(0, func_on_done(0)));
+    EXPECT_TRUE(pipeline.Push(1, func_on_done(1)));
+    pipeline.WaitEntered(2);
+    EXPECT_TRUE(pipeline.Push(2, func_on_done(2)));
+    EXPECT_TRUE(pipeline.Push(3, func_on_done(3)));
+    EXPECT_TRUE(pool.RemainSize() == 0);
+
+    // 被顶替的包在 Push 返回前就已上报，buffer 已回收给新包
+    EXPECT_TRUE(pipeline.Push(4, func_on_done(4)));
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        EXPECT_TRUE(status[2] == PIPELINE_DROPPED);
+    }
+    EXPECT_TRUE(pool.RemainSize() == 0);
+    EXPECT_TRUE(pipeline.Push(5, func_on_done(5)));
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        EXPECT_TRUE(status[3] == PIPELINE_DROPPED);
+    }
+
+    // 保序输出跳过被丢弃的序号，所有回调都能在限时内完成
+    pipeline.OpenGate();
+    {
+        std::unique_lock<std::mutex> lck(mutex);
+        EXPECT_TRUE(cv.wait_for(lck, std::chrono::seconds(5), [&]() { return done_count == 6; }));
+        EXPECT_TRUE(status[0] == PIPELINE_SUCCESS && status[1] == PIPELINE_SUCCESS);
+        EXPECT_TRUE(status[4] == PIPELINE_SUCCESS && status[5] == PIPELINE_SUCCESS);
+        EXPECT_TRUE((output_order == std::vector<int>{0, 1, 4, 5}));
+    }
+    EXPECT_TRUE(WaitPoolFull(pool));
+}
+
+// future 接口下被丢弃的包抛出 PipelineDropped
+void TestDroppedFuture() {
+    FakeInferCore core;
+    MemBufferPool pool(&core, 4);
+    GatedPipeline pipeline(pool, false);
+
+    std::vector<std::future<int>> futures;
+    futures.push_back(pipeline.Push(0));
+    futures.push_back(pipeline.Push(1));
+    pipeline.WaitEntered(2);
+    for (int i = 2; i < 6; ++i) {
+        futures.push_back(pipeline.Push(i));
+    }
+    pipeline.OpenGate();
+
+    for (int i = 0; i < 6; ++i) {
+        bool dropped = false;
+        bool ready   = futures[i].wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+        EXPECT_TRUE(ready);
+        if (!ready) {
+            continue;
+        }
+        try {
+            EXPECT_TRUE(futures[i].get() == i);
+        } catch (const PipelineDropped &) {
+            dropped = true;
+        }
+        EXPECT_TRUE(dropped == (i == 2 || i == 3));
+    }
+    EXPECT_TRUE(WaitPoolFull(pool));
+}
+
+// 所有队列都丢弃最旧的包时，输出队列满了也会丢弃已处理的包：每个包恰好上报一次，成功的包保序，
+// buffer 全部回到内存池
+void TestCoverAllQueues() {
+    FakeInferCore core;
+    MemBufferPool pool(&core, 4);
+    GatedPipeline pipeline(pool, true);
+
+    const int                   total = 50;
+    std::mutex                  mutex;
+    std::condition_variable     cv;
+    std::vector<int>            report_count(total, 0);
+    std::vector<PipelineStatus> status(total, PIPELINE_FAILED);
+    std::vector<int>            output_order;
+    int                         done_count = 0;
+    for (int i = 0; i < total; ++i) {
+        pipeline.Push(i, [&, i](PipelineStatus s, int result) {
+            std::lock_guard<std::mutex> lck(mutex);
+            ++report_count[i];
+            status[i] = s;
+            if (s == PIPELINE_SUCCESS) {
+                output_order.push_back(result);
+            }
+            ++done_count;
+            cv.notify_all();
+        });
+        if (i == 1) {
+            pipeline.WaitEntered(2);
+        }
+    }
+    pipeline.OpenGate();
+
+    std::unique_lock<std::mutex> lck(mutex);
+    EXPECT_TRUE(cv.wait_for(lck, std::chrono::seconds(5), [&]() { return done_count == total; }));
+    int dropped_count = 0;
+    for (int i = 0; i < total; ++i) {
+        EXPECT_TRUE(report_count[i] == 1);
+        EXPECT_TRUE(status[i] == PIPELINE_SUCCESS || status[i] == PIPELINE_DROPPED);
+        dropped_count += status[i] == PIPELINE_DROPPED;
+    }
+    EXPECT_TRUE(dropped_count >= total - 6);
+    EXPECT_TRUE(std::is_sorted(output_order.begin(), output_order.end()));
+    lck.unlock();
+    EXPECT_TRUE(WaitPoolFull(pool));
+}
+
+int main() {
+    std::cout << "===== cover_oldest 行为检查 =====" << std::endl;
+    TestEvictOldest();
+    TestDroppedFuture();
+    TestCoverAllQueues();
+
+    return ReportCheckResult();
+}
@@ -0,0 +1,164 @@
+/**
+ * @FlieName test_infer_core_pool
+ * @description: InferCorePool 分发行为检查：推理请求分给当前调用数最少的副本，负载相同时
+ *               优先上次处理同一 buffer 的副本
+ **/
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "check_utils.hpp"
+#include "deploy_core/base_infer_core.hpp"
+#include "deploy_core/infer_core_pool.hpp"
+
+using namespace easy_deploy;
+
+// 所有副本共享的闸门与统计，闸门关闭时 Inference 停在副本内
+struct ReplicaBoard {
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    gate_open = true;
+    std::vector<int>        running;
+    std::vector<int>        calls;
+    int                     entered = 0;
+
+    void CloseGate() {
+        std::lock_guard<std::mutex> lck(mutex);
+        gate_open = false;
+        entered   = 0;
+    }
+
+    void OpenGate() {
+        {
+            std::lock_guard<std::mutex> lck(mutex);
+            gate_open = true;
+        }
+        cv.notify_all();
+    }
+
+    bool WaitEntered(int count) {
+        std::unique_lock<std::mutex> lck(mutex);
+        return cv.wait_for(lck, std::chrono::seconds(5), [&]() { return entered >= count; });
+    }
+};
+
+class FakeReplica : public BaseInferCore {
+public:
+    FakeReplica(ReplicaBoard &board, int index) : board_(board), index_(index) {
+        Init(1);
+    }
+
+    ~FakeReplica() override {
+        BaseInferCore::Release();
+    }
+
+    std::unique_ptr<BlobsTensor> AllocBlobsBuffer() override {
+        return std::make_unique<BlobsTensor>(
+            std::unordered_map<std::string, std::unique_ptr<ITensor>>{});
+    }
+
+    bool PreProcess(std::shared_ptr<IPipelinePackage>) override {
+        return true;
+    }
+
+    bool Inference(std::shared_ptr<IPipelinePackage>) override {
+        std::unique_lock<std::mutex> lck(board_.mutex);
+        ++board_.running[index_];
+        ++board_.calls[index_];
+        ++board_.entered;
+        board_.cv.notify_all();
+        board_.cv.wait(lck, [this]() { return board_.gate_open; });
+        --board_.running[index_];
+        return true;
+    }
+
+    bool PostProcess(std::shared_ptr<IPipelinePackage>) override {
+        return true;
+    }
+
+private:
+    ReplicaBoard &board_;
+    const int     index_;
+};
+
+class FakeReplicaFactory : public BaseInferCoreFactory {
+public:
+    explicit FakeReplicaFactory(ReplicaBoard &board) : board_(board) {}
+
+    std::shared_ptr<BaseInferCore> Create() override {
+        const int index = static_cast<int>(board_.running.size());
+        board_.running.push_back(0);
+        board_.calls.push_back(0);
+        return std::make_shared<FakeReplica>(board_, index);
+    }
+
+private:
+    ReplicaBoard &board_;
+};
+
+// 6 个并发调用分到 3 个副本上，每个副本恰好 2 个
+void TestLeastLoaded() {
+    ReplicaBoard board;
+    auto         pool = CreateInferCorePool(std::make_shared<FakeReplicaFactory>(board), 3);
+    EXPECT_TRUE(board.running.size() == 3);
+
+    board.CloseGate();
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 6; ++i) {
+        callers.emplace_back([&]() {
+            auto buffer = pool->GetBuffer(true);
+            EXPECT_TRUE(pool->SyncInfer(buffer.get()));
+        });
+        // 逐个进入，每次分发时都能看到前面调用的负载
+        EXPECT_TRUE(board.WaitEntered(i + 1));
+    }
+    {
+        std::lock_guard<std::mutex> lck(board.mutex);
+        EXPECT_TRUE((board.running == std::vector<int>{2, 2, 2}));
+    }
+    board.OpenGate();
+    for (auto &caller : callers) {
+        caller.join();
+    }
+}
+
+// 副本 0 被占用时 buffer 落到副本 1，之后空闲时同一 buffer 仍交给副本 1
+void TestBufferAffinityOnTie() {
+    ReplicaBoard board;
+    auto         pool   = CreateInferCorePool(std::make_shared<FakeReplicaFactory>(board), 3);
+    auto         buffer = pool->GetBuffer(true);
+
+    board.CloseGate();
+    std::thread busy([&]() {
+        auto other = pool->GetBuffer(true);
+        EXPECT_TRUE(pool->SyncInfer(other.get()));
+    });
+    EXPECT_TRUE(board.WaitEntered(1));
+    std::thread first([&]() { EXPECT_TRUE(pool->SyncInfer(buffer.get())); });
+    EXPECT_TRUE(board.WaitEntered(2));
+    {
+        std::lock_guard<std::mutex> lck(board.mutex);
+        EXPECT_TRUE((board.running == std::vector<int>{1, 1, 0}));
+    }
+    board.OpenGate();
+    busy.join();
+    first.join();
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(pool->SyncInfer(buffer.get()));
+    }
+    std::lock_guard<std::mutex> lck(board.mutex);
+    EXPECT_TRUE((board.calls == std::vector<int>{1, 6, 0}));
+}
+
+int main() {
+    std::cout << "===== InferCorePool 分发行为检查 =====" << std::endl;
+    TestLeastLoaded();
+    TestBufferAffinityOnTie();
+
+    return ReportCheckResult();
+}
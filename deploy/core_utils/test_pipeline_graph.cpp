@@ -0,0 +1,183 @@
+/**
+ * @FlieName test_pipeline_graph
+ * @description: AsyncPipelineGraph 行为检查：同层节点并发执行后汇合，独占线程模式下分支运行在流水线
+ *               自己的辅助线程上，不依赖全局线程池
+ **/
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "check_utils.hpp"
+#include "deploy_core/async_pipeline.hpp"
+
+using namespace easy_deploy;
+
+using PackagePtr = std::shared_ptr<IPipelinePackage>;
+
+struct GraphPackage : public IPipelinePackage {
+    int value = 0;
+    int left  = 0;
+    int right = 0;
+
+    // 同层两个分支的会合点
+    std::mutex              mutex;
+    std::condition_variable cv;
+    int                     arrived = 0;
+
+    BlobsTensor *GetInferBuffer() override {
+        return nullptr;
+    }
+
+    // 等待另一个分支也进入，限时内没有等到说明两个分支没有并发执行
+    bool Rendezvous() {
+        std::unique_lock<std::mutex> lck(mutex);
+        ++arrived;
+        cv.notify_all();
+        return cv.wait_for(lck, std::chrono::seconds(2), [this]() { return arrived == 2; });
+    }
+};
+
+struct GenValue {
+    int operator()(const PackagePtr &package) {
+        return std::static_pointer_cast<GraphPackage>(package)->value;
+    }
+};
+
+static std::shared_ptr<GraphPackage> Cast(const PackagePtr &package) {
+    return std::static_pointer_cast<GraphPackage>(package);
+}
+
+// src -> {left, right} -> join，rendezvous 时 left 与 right 必须同时在执行才能成功
+class DiamondPipeline : public BaseAsyncPipeline<int, GenValue> {
+public:
+    DiamondPipeline(PipelineExecution execution, bool rendezvous) {
+        auto src   = BuildPipelineBlock([](PackagePtr p) { return ++Cast(p)->value > 0; }, "src");
+        auto left  = BuildPipelineBlock(
+            [rendezvous](PackagePtr p) {
+                Cast(p)->left = Cast(p)->value * 2;
+                return !rendezvous || Cast(p)->Rendezvous();
+            },
+            "left");
+        auto right = BuildPipelineBlock(
+            [rendezvous](PackagePtr p) {
+                Cast(p)->right = Cast(p)->value * 3;
+                return !rendezvous || Cast(p)->Rendezvous();
+            },
+            "right");
+        auto join  = BuildPipelineBlock(
+            [](PackagePtr p) {
+                Cast(p)->value = Cast(p)->left + Cast(p)->right;
+                return true;
+            },
+            "join");
+
+        AsyncPipelineGraph<PackagePtr> graph;
+        graph.AddNode(src)
+            .AddNode(left, {"src"})
+            .AddNode(right, {"src"})
+            .AddNode(join, {"left", "right"});
+        ConfigPipeline("diamond", graph);
+
+        PipelineOptions options;
+        options.execution = execution;
+        InitPipeline(options);
+    }
+
+    std::future<int> Push(int value) {
+        auto package   = std::make_shared<GraphPackage>();
+        package->value = value;
+        return PushPipeline("diamond", package);
+    }
+};
+
+static void CheckDiamond(PipelineExecution execution, bool rendezvous) {
+    DiamondPipeline               pipeline(execution, rendezvous);
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 20; ++i) {
+        futures.push_back(pipeline.Push(i));
+    }
+    for (int i = 0; i < 20; ++i) {
+        bool success = false;
+        try {
+            success = futures[i].get() == (i + 1) * 5;
+        } catch (const std::exception &) {
+        }
+        EXPECT_TRUE(success);
+    }
+}
+
+// 分层编译：同层的节点合并为一个块
+void TestToContext() {
+    auto block = [](const std::string &name) {
+        return AsyncPipelineBlock<PackagePtr>([](PackagePtr) { return true; }, name);
+    };
+    AsyncPipelineGraph<PackagePtr> graph;
+    graph.AddNode(block("a")).AddNode(block("b"), {"a"}).AddNode(block("c"), {"a"});
+    graph.AddNode(block("d"), {"b", "c"});
+    auto context = graph.ToContext();
+    EXPECT_TRUE(context.blocks_.size() == 3);
+    EXPECT_TRUE(context.blocks_[1].GetBranchNum() == 2);
+    EXPECT_TRUE(context.blocks_[2].GetBranchNum() == 1);
+
+    AsyncPipelineGraph<PackagePtr> cycle;
+    cycle.AddNode(block("a"), {"b"}).AddNode(block("b"), {"a"});
+    bool thrown = false;
+    try {
+        cycle.ToContext();
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+}
+
+// 全局线程池被占满时，独占线程模式的分支仍能并发执行
+void TestDedicatedBranchesAvoidGlobalPool() {
+    auto                    pool = WorkStealingThreadPool::Global();
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    release = false;
+    std::atomic<int>        blocked{0};
+    for (size_t i = 0; i < pool->GetThreadNum(); ++i) {
+        pool->Submit([&]() {
+            blocked.fetch_add(1);
+            std::unique_lock<std::mutex> lck(mutex);
+            cv.wait(lck, [&]() { return release; });
+            blocked.fetch_sub(1);
+        });
+    }
+    while (blocked.load() < static_cast<int>(pool->GetThreadNum())) {
+        std::this_thread::yield();
+    }
+
+    CheckDiamond(PipelineExecution::DEDICATED_THREADS, true);
+
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    // 占位任务引用本函数的局部变量，等它们全部退出
+    while (blocked.load() > 0) {
+        std::this_thread::yield();
+    }
+}
+
+// 其他执行模式下分支在全局线程池上执行，线程池只有一个线程时分支可能依次执行，不要求会合
+void TestOtherExecutions() {
+    CheckDiamond(PipelineExecution::SHARED_THREAD_POOL, false);
+    CheckDiamond(PipelineExecution::RUN_TO_COMPLETION, false);
+}
+
+int main() {
+    std::cout << "===== AsyncPipelineGraph 行为检查 =====" << std::endl;
+    TestToContext();
+    TestDedicatedBranchesAvoidGlobalPool();
+    TestOtherExecutions();
+
+    return ReportCheckResult();
+}
@@ -0,0 +1,43 @@
+/**
+ * @FlieName test_shape_bucket
+ * @description: SelectShapeBucket 行为检查：选择能容纳缩放后图像的最小 bucket
+ **/
+#include <iostream>
+#include <vector>
+
+#include "check_utils.hpp"
+#include "deploy_core/base_infer_core.hpp"
+
+using namespace easy_deploy;
+
+static bool SameBucket(const ShapeBucket &a, int height, int width) {
+    return a.height == height && a.width == width;
+}
+
+int main() {
+    std::cout << "===== SelectShapeBucket 行为检查 =====" << std::endl;
+    // 乱序给出，最大的 bucket 为 384x512
+    const std::vector<ShapeBucket> buckets = {{320, 512}, {384, 512}, {256, 512}};
+    const ShapeBucket              fallback{256, 512};
+
+    // 640x400 传感器：缩放到 320x512，正好放进 320x512 而不是最大的 384x512
+    EXPECT_TRUE(SameBucket(SelectShapeBucket(buckets, 400, 640, fallback), 320, 512));
+    // 16:9 图像缩放到 288x512，取能容纳它的最小 bucket 320x512
+    EXPECT_TRUE(SameBucket(SelectShapeBucket(buckets, 720, 1280, fallback), 320, 512));
+    // 2:1 图像与最小 bucket 比例相同
+    EXPECT_TRUE(SameBucket(SelectShapeBucket(buckets, 256, 512, fallback), 256, 512));
+    EXPECT_TRUE(SameBucket(SelectShapeBucket(buckets, 1024, 2048, fallback), 256, 512));
+    // 接近正方形的图像只能放进最大的 bucket
+    EXPECT_TRUE(SameBucket(SelectShapeBucket(buckets, 1000, 1000, fallback), 384, 512));
+    // 比任何 bucket 都小的图像同样先缩放到最大 bucket
+    EXPECT_TRUE(SameBucket(SelectShapeBucket(buckets, 30, 40, fallback), 384, 512));
+
+    // 单个 bucket 总是被选中
+    EXPECT_TRUE(SameBucket(SelectShapeBucket({{320, 640}}, 480, 640, fallback), 320, 640));
+
+    // 没有 bucket 或图像尺寸无效时返回 fallback
+    EXPECT_TRUE(SameBucket(SelectShapeBucket({}, 400, 640, fallback), 256, 512));
+    EXPECT_TRUE(SameBucket(SelectShapeBucket(buckets, 0, 640, fallback), 256, 512));
+
+    return ReportCheckResult();
+}
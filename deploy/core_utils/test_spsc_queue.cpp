@@ -0,0 +1,145 @@
+/**
+ * @FlieName test_spsc_queue
+ * @description: SpscQueue 行为检查：环形回绕、满/空边界、阻塞唤醒、超时与清空
+ **/
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "check_utils.hpp"
+#include "common_utils/spsc_queue.hpp"
+
+using namespace easy_deploy;
+
+// 容量为 3 的队列内部环长为 4，生产者/消费者各一个线程，多次回绕后顺序不变
+void TestWrapAroundKeepsOrder() {
+    SpscQueue<int> queue(3);
+    const int      total = 10000;
+    std::thread    producer([&]() {
+        for (int i = 0; i < total; ++i) {
+            queue.BlockPush(i);
+        }
+        queue.SetNoMoreInput();
+    });
+
+    int  expected = 0;
+    bool in_order = true;
+    while (auto value = queue.Take()) {
+        in_order &= value.value() == expected;
+        ++expected;
+    }
+    producer.join();
+
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(expected == total);
+    EXPECT_TRUE(queue.Empty());
+    EXPECT_TRUE(queue.GetHighWaterMark() <= queue.GetMaxSize());
+}
+
+// 满队列 TryPush 失败，空队列 TryTake 返回 nullopt
+void TestFullAndEmpty() {
+    SpscQueue<int> queue(2);
+    EXPECT_TRUE(!queue.TryTake().has_value());
+    EXPECT_TRUE(queue.TryPush(1));
+    EXPECT_TRUE(queue.TryPush(2));
+    EXPECT_TRUE(!queue.TryPush(3));
+    EXPECT_TRUE(queue.Size() == 2);
+    EXPECT_TRUE(queue.TryTake().value() == 1);
+    EXPECT_TRUE(queue.TryPush(3));
+    EXPECT_TRUE(queue.TryTake().value() == 2);
+    EXPECT_TRUE(queue.TryTake().value() == 3);
+    EXPECT_TRUE(queue.Empty());
+}
+
+// 阻塞在 Take / BlockPush 上的一方（已进入 futex 睡眠）能被另一方唤醒
+void TestWaiterIsWoken() {
+    {
+        SpscQueue<int> queue(1);
+        std::thread    producer([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            queue.BlockPush(42);
+        });
+        auto value = queue.Take();
+        producer.join();
+        EXPECT_TRUE(value.has_value() && value.value() == 42);
+    }
+    {
+        SpscQueue<int> queue(1);
+        EXPECT_TRUE(queue.BlockPush(1));
+        std::thread consumer([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            queue.Take();
+        });
+        // 队列已满，等待消费者取走后才能写入
+        EXPECT_TRUE(queue.BlockPush(2));
+        consumer.join();
+        EXPECT_TRUE(queue.TryTake().value() == 2);
+    }
+    {
+        SpscQueue<int> queue(1);
+        std::thread    closer([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            queue.SetNoMoreInput();
+        });
+        EXPECT_TRUE(!queue.Take().has_value());
+        closer.join();
+    }
+    {
+        SpscQueue<int> queue(1);
+        std::thread    closer([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            queue.Disable();
+        });
+        EXPECT_TRUE(!queue.Take().has_value());
+        closer.join();
+    }
+}
+
+// TakeUntil 在截止时间返回 nullopt
+void TestTakeUntilTimesOut() {
+    SpscQueue<int> queue(1);
+    const auto     start = std::chrono::steady_clock::now();
+    auto value = queue.TakeUntil(start + std::chrono::milliseconds(20));
+    EXPECT_TRUE(!value.has_value());
+    EXPECT_TRUE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+}
+
+// DisableAndClear 第一次调用即释放队列中的元素，阻塞在满队列上的生产者被唤醒并写入失败
+void TestDisableAndClearDrains() {
+    {
+        SpscQueue<std::shared_ptr<int>> queue(2);
+        auto                            element = std::make_shared<int>(7);
+        EXPECT_TRUE(queue.TryPush(element));
+        EXPECT_TRUE(queue.TryPush(element));
+        queue.DisableAndClear();
+        EXPECT_TRUE(element.use_count() == 1);
+        EXPECT_TRUE(queue.Empty());
+        EXPECT_TRUE(!queue.TryTake().has_value());
+        EXPECT_TRUE(!queue.TryPush(element));
+    }
+    {
+        SpscQueue<std::shared_ptr<int>> queue(1);
+        auto                            element = std::make_shared<int>(7);
+        EXPECT_TRUE(queue.BlockPush(element));
+        bool        pushed = true;
+        std::thread producer([&]() { pushed = queue.BlockPush(element); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.DisableAndClear();
+        EXPECT_TRUE(queue.Empty());
+        producer.join();
+        EXPECT_TRUE(!pushed);
+        EXPECT_TRUE(element.use_count() == 1);
+    }
+}
+
+int main() {
+    std::cout << "===== SpscQueue 行为检查 =====" << std::endl;
+    TestWrapAroundKeepsOrder();
+    TestFullAndEmpty();
+    TestWaiterIsWoken();
+    TestTakeUntilTimesOut();
+    TestDisableAndClearDrains();
+
+    return ReportCheckResult();
+}
@@ -0,0 +1,169 @@
+/**
+ * @FlieName test_stereo_tiling
+ * @description: BuildStereoTiles / AccumulateStereoDispTile 行为检查：覆盖、羽化权重与融合结果
+ **/
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "check_utils.hpp"
+#include "deploy_core/stereo_postprocess.hpp"
+
+using namespace easy_deploy;
+
+struct BlendResult {
+    cv::Mat disp;        // 融合后的视差
+    cv::Mat weight_sum;  // 每个像素的权重和
+    cv::Mat coverage;    // 每个像素被多少个 tile 的 valid 区域覆盖
+};
+
+// 每个 tile 输出常数视差 tile_values[i]，按 ComputeDispTiled 的方式融合
+BlendResult BlendConstantTiles(int                            image_height,
+                               int                            image_width,
+                               const std::vector<StereoTile> &tiles,
+                               const std::vector<float>      &tile_values) {
+    BlendResult result;
+    result.disp       = cv::Mat(image_height, image_width, CV_32FC1, cv::Scalar(0));
+    result.weight_sum = cv::Mat(image_height, image_width, CV_32FC1, cv::Scalar(0));
+    result.coverage   = cv::Mat(image_height, image_width, CV_32SC1, cv::Scalar(0));
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        const auto &tile = tiles[i];
+        cv::Mat     tile_disp(tile.crop.height, tile.crop.width, CV_32FC1,
+                              cv::Scalar(tile_values[i]));
+        AccumulateStereoDispTile(tile_disp, tile, result.disp, result.weight_sum);
+        for (int y = tile.valid.y; y < tile.valid.y + tile.valid.height; ++y) {
+            for (int x = tile.valid.x; x < tile.valid.x + tile.valid.width; ++x) {
+                ++result.coverage.ptr<int>(y)[x];
+            }
+        }
+    }
+    for (int y = 0; y < image_height; ++y) {
+        for (int x = 0; x < image_width; ++x) {
+            const float weight = result.weight_sum.ptr<float>(y)[x];
+            if (weight > 0) {
+                result.disp.ptr<float>(y)[x] /= weight;
+            }
+        }
+    }
+    return result;
+}
+
+// 对给定尺寸检查 tile 几何与融合结果
+void CheckImageSize(int image_height, int image_width, const StereoTilingOptions &options) {
+    std::cout << "[INFO] 检查 " << image_height << " x " << image_width << std::endl;
+    const cv::Rect image_rect(0, 0, image_width, image_height);
+    const auto     tiles = BuildStereoTiles(image_height, image_width, options);
+    EXPECT_TRUE(!tiles.empty());
+
+    std::vector<float> constant_values(tiles.size(), 7.5f);
+    std::vector<float> varying_values(tiles.size());
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        const auto &tile = tiles[i];
+        // crop 在图像内，valid 在 crop 内；图像比 tile 小时 crop 即整幅图像
+        EXPECT_TRUE((tile.crop & image_rect) == tile.crop);
+        EXPECT_TRUE((tile.valid & tile.crop) == tile.valid);
+        EXPECT_TRUE(tile.valid.width > 0 && tile.valid.height > 0);
+        EXPECT_TRUE(tile.crop.width == std::min(options.tile_width, image_width));
+        EXPECT_TRUE(tile.crop.height == std::min(options.tile_height, image_height));
+        // 第一列之外的 tile 在左侧保留 max_disparity 的匹配范围
+        EXPECT_TRUE(tile.valid.x == 0 || tile.valid.x - tile.crop.x == options.max_disparity);
+        EXPECT_TRUE(tile.feather_left + tile.feather_right <= 2 * tile.valid.width);
+        varying_values[i] = static_cast<float>(i % 5) * 10.f;
+    }
+
+    // 每个方向上覆盖各行/各列的 tile 数，tile 按行优先排列
+    std::vector<int> row_coverage(image_height, 0), col_coverage(image_width, 0);
+    for (const auto &tile : tiles) {
+        if (tile.crop.y == tiles.front().crop.y) {
+            for (int x = tile.valid.x; x < tile.valid.x + tile.valid.width; ++x) {
+                ++col_coverage[x];
+            }
+        }
+        if (tile.crop.x == tiles.front().crop.x) {
+            for (int y = tile.valid.y; y < tile.valid.y + tile.valid.height; ++y) {
+                ++row_coverage[y];
+            }
+        }
+    }
+
+    const auto constant = BlendConstantTiles(image_height, image_width, tiles, constant_values);
+    bool       covered = true, weight_positive = true, constant_kept = true;
+    bool       weights_sum_to_one = true;
+    int        max_coverage = 0;
+    for (int y = 0; y < image_height; ++y) {
+        for (int x = 0; x < image_width; ++x) {
+            const int   coverage = constant.coverage.ptr<int>(y)[x];
+            const float weight   = constant.weight_sum.ptr<float>(y)[x];
+            covered &= coverage > 0;
+            weight_positive &= weight > 0;
+            constant_kept &= std::fabs(constant.disp.ptr<float>(y)[x] - 7.5f) < 1e-4f;
+            // 每个方向上至多两个 tile 重叠时，羽化权重恰好互补，权重和为 1
+            if (row_coverage[y] <= 2 && col_coverage[x] <= 2) {
+                weights_sum_to_one &= std::fabs(weight - 1.f) < 1e-4f;
+            }
+            max_coverage = std::max(max_coverage, coverage);
+        }
+    }
+    EXPECT_TRUE(covered);
+    EXPECT_TRUE(weight_positive);
+    EXPECT_TRUE(constant_kept);
+    EXPECT_TRUE(weights_sum_to_one);
+    std::cout << "[INFO]   tile 数 " << tiles.size() << "，最多 " << max_coverage << " 个 tile 重叠"
+              << std::endl;
+
+    // 融合结果是各 tile 视差的加权平均，不会超出其取值范围
+    const auto varying = BlendConstantTiles(image_height, image_width, tiles, varying_values);
+    bool       in_range = true;
+    for (int y = 0; y < image_height; ++y) {
+        for (int x = 0; x < image_width; ++x) {
+            const float value = varying.disp.ptr<float>(y)[x];
+            in_range &= value >= -1e-4f && value <= 40.f + 1e-4f;
+        }
+    }
+    EXPECT_TRUE(in_range);
+}
+
+int main() {
+    std::cout << "===== Stereo tiling 行为检查 =====" << std::endl;
+    const StereoTilingOptions options;
+
+    // 比 tile 小、与 tile 相同大小
+    CheckImageSize(100, 200, options);
+    CheckImageSize(options.tile_height, options.tile_width, options);
+    // 每个方向两个 tile
+    CheckImageSize(400, 700, options);
+    // 最后一个 tile 回退到图像内，与前两个 tile 的 valid 区域同时重叠
+    CheckImageSize(720, 801, options);
+    CheckImageSize(720, 1280, options);
+    CheckImageSize(2160, 3840, options);
+
+    {
+        const auto tiles = BuildStereoTiles(400, 700, options);
+        EXPECT_TRUE(tiles.size() == 4);
+    }
+    // 宽 801 时列方向最后一个 tile 的 valid 区域与前两个都重叠
+    {
+        const auto tiles = BuildStereoTiles(options.tile_height, 801, options);
+        EXPECT_TRUE(tiles.size() == 3);
+        if (tiles.size() == 3) {
+            EXPECT_TRUE(tiles[2].crop.x + tiles[2].crop.width == 801);
+            EXPECT_TRUE(tiles[2].valid.x < tiles[0].valid.x + tiles[0].valid.width);
+        }
+    }
+
+    // tile 宽度容不下 max_disparity 与 overlap 时抛出异常
+    {
+        StereoTilingOptions invalid_options;
+        invalid_options.tile_width = invalid_options.max_disparity + invalid_options.overlap;
+        bool thrown = false;
+        try {
+            BuildStereoTiles(720, 1280, invalid_options);
+        } catch (const std::exception &) {
+            thrown = true;
+        }
+        EXPECT_TRUE(thrown);
+    }
+
+    return ReportCheckResult();
+}
@@ -0,0 +1,154 @@
+/**
+ * @FlieName test_work_stealing_pool
+ * @description: WorkStealingThreadPool 压力检查：工作线程睡眠时多个生产者并发提交、任务内再提交、
+ *               任务抛异常，所有任务都恰好执行一次且析构时干净退出
+ **/
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check_utils.hpp"
+#include "common_utils/work_stealing_pool.hpp"
+
+using namespace easy_deploy;
+
+// 限时等待计数到达 expected，不会因为丢失唤醒而永久卡住
+static bool WaitCount(const std::atomic<int> &count, int expected) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (count.load() < expected) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// 每轮开始前留出空闲时间让工作线程全部睡下，再由多个生产者同时提交一批短任务，
+// 检查睡眠中的线程不会漏掉唤醒
+void TestProducersWakeSleepingWorkers() {
+    WorkStealingThreadPool pool(4);
+    const int              rounds        = 50;
+    const int              producer_num  = 8;
+    const int              tasks_per_run = 200;
+    std::atomic<int>       executed{0};
+    std::vector<std::unique_ptr<std::atomic<int>>> run_count;
+    for (int i = 0; i < rounds * producer_num * tasks_per_run; ++i) {
+        run_count.emplace_back(std::make_unique<std::atomic<int>>(0));
+    }
+
+    bool all_finished = true;
+    for (int round = 0; round < rounds; ++round) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        std::atomic<bool>        start{false};
+        std::vector<std::thread> producers;
+        for (int p = 0; p < producer_num; ++p) {
+            producers.emplace_back([&, round, p]() {
+                while (!start.load()) {
+                    std::this_thread::yield();
+                }
+                for (int t = 0; t < tasks_per_run; ++t) {
+                    const int id = (round * producer_num + p) * tasks_per_run + t;
+                    pool.Submit([&, id]() {
+                        run_count[id]->fetch_add(1);
+                        executed.fetch_add(1);
+                    });
+                }
+            });
+        }
+        start.store(true);
+        for (auto &producer : producers) {
+            producer.join();
+        }
+        all_finished &= WaitCount(executed, (round + 1) * producer_num * tasks_per_run);
+    }
+
+    EXPECT_TRUE(all_finished);
+    bool exactly_once = true;
+    for (const auto &count : run_count) {
+        exactly_once &= count->load() == 1;
+    }
+    EXPECT_TRUE(exactly_once);
+}
+
+// 任务在池内再提交后续任务（进入自己的队列），外部生产者同时提交，链上的任务全部执行
+void TestNestedSubmit() {
+    WorkStealingThreadPool pool(3);
+    const int              chains      = 64;
+    const int              chain_depth = 100;
+    std::atomic<int>       executed{0};
+
+    std::function<void(int)> step = [&](int depth) {
+        executed.fetch_add(1);
+        if (depth + 1 < chain_depth) {
+            pool.Submit([&, depth]() { step(depth + 1); });
+        }
+    };
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p) {
+        producers.emplace_back([&]() {
+            for (int c = 0; c < chains / 4; ++c) {
+                pool.Submit([&]() { step(0); });
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    EXPECT_TRUE(WaitCount(executed, chains * chain_depth));
+}
+
+// 抛异常的任务被吞掉，工作线程继续执行后续任务
+void TestThrowingTasks() {
+    WorkStealingThreadPool pool(2);
+    const int              total = 1000;
+    std::atomic<int>       executed{0};
+    for (int i = 0; i < total; ++i) {
+        pool.Submit([&, i]() {
+            executed.fetch_add(1);
+            if (i % 10 == 0) {
+                throw std::runtime_error("expected task failure");
+            }
+        });
+    }
+    EXPECT_TRUE(WaitCount(executed, total));
+}
+
+// 析构时队列中尚未执行的任务全部执行完，工作线程退出，析构不会卡住
+void TestShutdownDrainsPending() {
+    for (int iter = 0; iter < 20; ++iter) {
+        const int        total = 2000;
+        std::atomic<int> executed{0};
+        {
+            WorkStealingThreadPool   pool(4);
+            std::vector<std::thread> producers;
+            for (int p = 0; p < 4; ++p) {
+                producers.emplace_back([&]() {
+                    for (int t = 0; t < total / 4; ++t) {
+                        pool.Submit([&]() { executed.fetch_add(1); });
+                    }
+                });
+            }
+            for (auto &producer : producers) {
+                producer.join();
+            }
+        }
+        EXPECT_TRUE(executed.load() == total);
+    }
+}
+
+int main() {
+    std::cout << "===== WorkStealingThreadPool 压力检查 =====" << std::endl;
+    TestProducersWakeSleepingWorkers();
+    TestNestedSubmit();
+    TestThrowingTasks();
+    TestShutdownDrainsPending();
+
+    return ReportCheckResult();
+}
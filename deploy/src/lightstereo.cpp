@@ -1,6 +1,7 @@
-#include <opencv2/highgui/highgui.hpp>
 #include "stereo/lightstereo.hpp"
 
+#include "deploy_core/stereo_postprocess.hpp"
+
 namespace easy_deploy {
 
 class LightStereo : public BaseStereoMatchingModel {
@@ -71,15 +72,23 @@ bool LightStereo::PreProcess(std::shared_ptr<IPipelinePackage> _package)
               "`DetectionPipelinePackage`");
 
   auto blobs_tensor = package->GetInferBuffer();
-
-  const float left_scale  = preprocess_block_->Process(package->left_image_data,
-                                                       blobs_tensor->GetTensor(input_blobs_name_[0]),
-                                                       input_height_, input_width_);
-  const float right_scale = preprocess_block_->Process(
-      package->right_image_data, blobs_tensor->GetTensor(input_blobs_name_[1]), input_height_,
-      input_width_);
-
-  package->transform_scale = left_scale;
+  // the smallest shape bucket holding the image if the inference core has dynamic resolution
+  CHECK_STATE(SelectInputShape(*package, input_height_, input_width_),
+              "[LightStereo] PreProcess failed to select the input shape");
+
+  DebugTapFrameScope tap_scope(package->debug_frame);
+  // both views share the same geometry, let the preprocess block process them together
+  package->transform_scale = preprocess_block_->ProcessPair(
+      package->left_image_data, package->right_image_data,
+      blobs_tensor->GetTensor(input_blobs_name_[0]), blobs_tensor->GetTensor(input_blobs_name_[1]),
+      package->input_height, package->input_width);
+
+  const auto &image_info = package->left_image_data->GetImageDataInfo();
+  const auto  geometry   =
+      preprocess_block_->GetGeometry(image_info.image_height, image_info.image_width,
+                                     package->input_height, package->input_width);
+  package->valid_roi =
+      cv::Rect(geometry.left, geometry.top, geometry.fix_width, geometry.fix_height);
   return true;
 }
 
@@ -96,24 +105,19 @@ bool LightStereo::PostProcess(std::shared_ptr<IPipelinePackage> _package)
   CHECK_STATE(output_disp != nullptr,
               "[LightStereo] `PostProcess` Got invalid output disp ptr !!!");
 
-  cv::Mat disp(input_height_, input_width_, CV_32FC1);
-  memcpy(disp.data, output_disp, input_height_ * input_width_ * sizeof(float));
-  cv::imwrite("disp.png", disp);
-//  disp /= package->transform_scale;
-
-  // 1. crop
-  const int original_height = package->left_image_data->GetImageDataInfo().image_height;
-  const int original_width  = package->left_image_data->GetImageDataInfo().image_width;
-  const int crop_height     = original_height * package->transform_scale;
-  const int crop_width      = original_width * package->transform_scale;
-  const int top_pad         = input_height_ - crop_height;
-  cv::Mat   crop_disp       = disp(cv::Rect(0, top_pad, crop_width, crop_height));
-
-  // 2. resize to original
-  cv::Mat disp_to_original;
-  cv::resize(crop_disp, disp_to_original, {original_width, original_height});
-  cv::imwrite("disp_to_original.png", disp_to_original);
-  package->disp = disp_to_original;
+  DebugTapFrameScope tap_scope(package->debug_frame);
+  if (DebugTap::CurrentFrame().capture)
+  {
+    DebugTap::Publish("raw_disp", cv::Mat(package->input_height, package->input_width,
+                                          CV_32FC1, const_cast<void *>(output_disp)));
+  }
+
+  // crop the valid area, resize to the original size and rescale the disparities in one pass
+  const auto &image_info = package->left_image_data->GetImageDataInfo();
+  StereoDispToOriginal(static_cast<const float *>(output_disp), package->input_height,
+                       package->input_width, package->valid_roi, image_info.image_height,
+                       image_info.image_width, package->disp);
+  DebugTap::Publish("disp", package->disp);
 
   return true;
 }
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <future>
 #include <memory>
+#include <stdexcept>
 #include <thread>
 #include <unordered_map>
 
@@ -27,10 +29,65 @@ public:
    */
   virtual BlobsTensor *GetInferBuffer() = 0;
 
+  /**
+   * @brief When the input of the package was captured, the end-to-end latency is measured from
+   * here. Left at the default, the push time is used.
+   */
+  std::chrono::steady_clock::time_point capture_time{};
+
+  /**
+   * @brief Absolute deadline of the package. The pipeline skips the remaining blocks once it can
+   * not be met and reports `PIPELINE_TIMEOUT`. Left at the default, it is derived from
+   * `PipelineOptions::latency_target` if set.
+   */
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
 protected:
   virtual ~IPipelinePackage() = default;
 };
 
+/**
+ * @brief Reported through the `std::future` of a package which missed its deadline.
+ *
+ */
+class PipelineDeadlineExceeded : public std::runtime_error {
+public:
+  PipelineDeadlineExceeded()
+      : std::runtime_error("[BaseAsyncPipeline] the package missed its deadline")
+  {}
+};
+
+/**
+ * @brief Reported through the `std::future` of a package which was dropped before reaching the
+ * output, e.g. evicted by `PipelineOptions::cover_oldest` or discarded by `ClosePipeline`.
+ *
+ */
+class PipelineDropped : public std::runtime_error {
+public:
+  PipelineDropped() : std::runtime_error("[BaseAsyncPipeline] the package was dropped")
+  {}
+};
+
+/**
+ * @brief Runs the completion callbacks of `BaseAsyncPipeline` off the pipeline output thread,
+ * e.g. on a thread pool of the application.
+ *
+ */
+class IPipelineExecutor {
+public:
+  virtual void Execute(std::function<void()> task) = 0;
+
+  virtual ~IPipelineExecutor() = default;
+};
+
+/**
+ * @brief Completion callback of an asynchronous request, called exactly once. `result` is only
+ * meaningful if `status` is `PIPELINE_SUCCESS`.
+ *
+ */
+template <typename ResultType>
+using PipelineCallback = SmallFunction<void(PipelineStatus status, ResultType result)>;
+
 /**
  * @brief This base class provides a simple implementation of the asynchronous inference
  * pipeline which could be plug-and-play.
@@ -47,6 +104,7 @@ class BaseAsyncPipeline {
   using ParsingType = std::shared_ptr<IPipelinePackage>;
   using Block_t     = AsyncPipelineBlock<ParsingType>;
   using Context_t   = AsyncPipelineContext<ParsingType>;
+  using Graph_t     = AsyncPipelineGraph<ParsingType>;
 
 protected:
   BaseAsyncPipeline() = default;
@@ -62,12 +120,15 @@ protected:
    *
    * @param func
    * @param block_name
+   * @param worker_num The number of threads which execute this block concurrently. `func` must be
+   * thread-safe if it is greater than one. The output order of the pipeline is preserved.
    * @return Block_t
    */
   static Block_t BuildPipelineBlock(const std::function<bool(ParsingType)> &func,
-                                    const std::string                      &block_name)
+                                    const std::string                      &block_name,
+                                    int                                     worker_num = 1)
   {
-    return Block_t(func, block_name);
+    return Block_t(func, block_name, worker_num);
   }
 
   /**
@@ -79,9 +140,60 @@ protected:
    */
   void ConfigPipeline(const std::string &pipeline_name, const std::vector<Context_t> &block_list)
   {
+    auto iter = map_name2instance_.find(pipeline_name);
+    if (iter != map_name2instance_.end())
+    {
+      // re-configure a pipeline which is not initialized yet
+      CHECK_STATE_THROW(!iter->second.IsInitialized(),
+                        "[BaseAsyncPipeline] Can not re-configure initialized pipeline {%s} !!!",
+                        pipeline_name.c_str());
+      map_name2instance_.erase(iter);
+    }
     map_name2instance_.emplace(pipeline_name, block_list);
   }
 
+  /**
+   * @brief Configure the pipeline from a graph of blocks, independent blocks run concurrently on
+   * a package. A chain of nodes is the same as the linear `ConfigPipeline` above.
+   *
+   * @param pipeline_name
+   * @param graph
+   */
+  void ConfigPipeline(const std::string &pipeline_name, const Graph_t &graph)
+  {
+    ConfigPipeline(pipeline_name, std::vector<Context_t>{graph.ToContext()});
+  }
+
+  /**
+   * @brief Get a resource which the packages in flight hold, e.g. a blobs buffer from a
+   * `MemBufferPool`, through `acquire(block)`. In `cover_oldest` mode the caller should not stall
+   * behind stale frames, so the oldest packages waiting at the pipeline input are dropped to give
+   * their resources back. Blocks only if all of them are held by packages being processed.
+   *
+   * @param pipeline_name
+   * @param cover_oldest
+   * @param acquire returns nullptr if nothing is available and `block` is false.
+   * @return std::shared_ptr<T>
+   */
+  template <typename T>
+  std::shared_ptr<T> AcquireForPush(const std::string                              &pipeline_name,
+                                    bool                                            cover_oldest,
+                                    const std::function<std::shared_ptr<T>(bool)> &acquire)
+  {
+    auto iter = map_name2instance_.find(pipeline_name);
+    if (iter == map_name2instance_.end() || !iter->second.IsInitialized() ||
+        !(cover_oldest || iter->second.IsCoverOldest()))
+    {
+      return acquire(true);
+    }
+    auto resource = acquire(false);
+    while (resource == nullptr && iter->second.DropOldestPending())
+    {
+      resource = acquire(false);
+    }
+    return resource != nullptr ? resource : acquire(true);
+  }
+
 public:
   /**
    * @brief Get the default pipeline context. Multiple instances derived from `BaseAsyncPipeline`
@@ -104,44 +216,116 @@ public:
   /**
    * @brief `PushPipeline` allow user to asynchronously push the package into pipeline and wait on
    * the `future` in another thread. The instance of template type `Result` is generated by functor
-   * `GenResult`.
+   * `GenResult`. Thread-safe, several producer threads may push into the same pipeline.
    *
    * @param pipeline_name
    * @param package
+   * @param cover_oldest drop the oldest waiting package instead of blocking if the pipeline is
+   * full. Always on if the pipeline was initialized with `PipelineOptions::cover_oldest`.
    * @return std::future<ResultType>
    */
   [[nodiscard]] std::future<ResultType> PushPipeline(const std::string &pipeline_name,
-                                                     const ParsingType &package) noexcept
+                                                     const ParsingType &package,
+                                                     bool cover_oldest = false) noexcept
   {
-    if (map_name2instance_.find(pipeline_name) == map_name2instance_.end())
+    auto instance = FindInitializedInstance(pipeline_name);
+    if (instance == nullptr)
     {
-      LOG_ERROR("[BaseAsyncPipeline] `PushPipeline` pipeline {%s} is not valid !!!",
-                pipeline_name.c_str());
       return std::future<ResultType>();
     }
 
-    if (!map_name2instance_.at(pipeline_name).IsInitialized())
+    // the promise travels with the package inside its callback, no shared bookkeeping is needed
+    // and producers do not contend on anything but the input queue. The shared state and the
+    // result storage of the promise are recycled. A package which a block failed on reports an
+    // exception, `PipelineDeadlineExceeded` if it missed its deadline and `PipelineDropped` if it
+    // was dropped.
+    std::promise<ResultType> promise(std::allocator_arg, PoolAllocator<ResultType>(promise_pool_));
+    auto                     ret = promise.get_future();
+
+    auto callback = [this, promise = std::move(promise)](const ParsingType &package,
+                                                         PipelineStatus     status) mutable {
+      try
+      {
+        if (status == PIPELINE_DROPPED)
+        {
+          throw PipelineDropped();
+        }
+        if (status == PIPELINE_FAILED)
+        {
+          throw std::runtime_error("[BaseAsyncPipeline] a pipeline block failed on the package");
+        }
+        if (status == PIPELINE_TIMEOUT)
+        {
+          throw PipelineDeadlineExceeded();
+        }
+        promise.set_value(gen_result_from_package_(package));
+      } catch (...)
+      {
+        promise.set_exception(std::current_exception());
+      }
+      return true;
+    };
+    instance->PushPipeline(package, std::move(callback), cover_oldest, package->capture_time,
+                           package->deadline);
+
+    return ret;
+  }
+
+  /**
+   * @brief Same as above, but `on_done` is called with the result and its status instead of
+   * fulfilling a `std::future`. It runs on the pipeline output thread, or is handed to
+   * `executor` if provided, and must not block for long in the former case. No future/promise
+   * shared state is involved. Thread-safe.
+   *
+   * @param pipeline_name
+   * @param package
+   * @param on_done
+   * @param executor
+   * @param cover_oldest
+   * @return false if the pipeline is not valid or initialized, `on_done` is not called then.
+   */
+  bool PushPipeline(const std::string                 &pipeline_name,
+                    const ParsingType                 &package,
+                    PipelineCallback<ResultType>       on_done,
+                    std::shared_ptr<IPipelineExecutor> executor     = nullptr,
+                    bool                               cover_oldest = false) noexcept
+  {
+    auto instance = FindInitializedInstance(pipeline_name);
+    if (instance == nullptr || on_done == nullptr)
     {
-      LOG_ERROR("[BaseAsyncPipeline] `PushPipeline` pipeline {%s} is not initilized !!!",
-                pipeline_name.c_str());
-      ;
-      return std::future<ResultType>();
+      return false;
     }
 
-    map_index2result_[package_index_] = std::promise<ResultType>();
-    auto ret                          = map_index2result_[package_index_].get_future();
-
-    auto callback = [this, package_index = package_index_](const ParsingType &package) -> bool {
-      ResultType result = gen_result_from_package_(package);
-      map_index2result_[package_index].set_value(std::move(result));
-      map_index2result_.erase(package_index);
+    auto callback = [this, on_done = std::move(on_done), executor = std::move(executor)](
+                        const ParsingType &package, PipelineStatus status) mutable {
+      ResultType result;
+      if (status == PIPELINE_SUCCESS)
+      {
+        try
+        {
+          result = gen_result_from_package_(package);
+        } catch (const std::exception &e)
+        {
+          LOG_ERROR("[BaseAsyncPipeline] Failed to generate result : %s", e.what());
+          status = PIPELINE_FAILED;
+        }
+      }
+      if (executor == nullptr)
+      {
+        on_done(status, std::move(result));
+      } else
+      {
+        executor->Execute(
+            [on_done = std::move(on_done), status, result = std::move(result)]() mutable {
+              on_done(status, std::move(result));
+            });
+      }
       return true;
     };
-    map_name2instance_[pipeline_name].PushPipeline(package, callback);
-
-    package_index_++;
+    instance->PushPipeline(package, std::move(callback), cover_oldest, package->capture_time,
+                           package->deadline);
 
-    return std::move(ret);
+    return true;
   }
 
   /**
@@ -197,12 +381,116 @@ public:
     }
   }
 
+  /**
+   * @brief Initialize all configured pipeline with `options`, e.g. to choose the queue type which
+   * connects the pipeline blocks, or to run the blocks on the shared thread pool or
+   * run-to-completion instead of on a thread per block, see `PipelineExecution`.
+   *
+   * @param options
+   */
+  void InitPipeline(const PipelineOptions &options)
+  {
+    for (auto &p_name_ins : map_name2instance_)
+    {
+      p_name_ins.second.Init(options);
+    }
+  }
+
+  /**
+   * @brief Initialize the pipeline `pipeline_name` with `options`. Return false if the pipeline
+   * is not configured.
+   *
+   * @param pipeline_name
+   * @param options
+   * @return true
+   * @return false
+   */
+  bool InitPipeline(const std::string &pipeline_name, const PipelineOptions &options)
+  {
+    if (map_name2instance_.find(pipeline_name) == map_name2instance_.end())
+    {
+      LOG_ERROR("[BaseAsyncPipeline] `InitPipeline` pipeline {%s} is not valid !!!",
+                pipeline_name.c_str());
+      return false;
+    }
+    map_name2instance_[pipeline_name].Init(options);
+    return true;
+  }
+
+  /**
+   * @brief Take a snapshot of the metrics of pipeline `pipeline_name` : per-block latency
+   * histograms, wait times, queue high-water marks and package counters. Safe to call while the
+   * pipeline is running.
+   *
+   * @param pipeline_name
+   * @return PipelineMetricsSnapshot Empty if the pipeline is not configured.
+   */
+  PipelineMetricsSnapshot GetPipelineMetrics(const std::string &pipeline_name)
+  {
+    PipelineMetricsSnapshot snapshot;
+    auto                    iter = map_name2instance_.find(pipeline_name);
+    if (iter != map_name2instance_.end())
+    {
+      snapshot = iter->second.GetMetrics();
+    }
+    snapshot.pipeline_name = pipeline_name;
+    return snapshot;
+  }
+
+  /**
+   * @brief Take a snapshot of the metrics of all configured pipelines.
+   *
+   * @return std::vector<PipelineMetricsSnapshot>
+   */
+  std::vector<PipelineMetricsSnapshot> GetPipelineMetrics()
+  {
+    std::vector<PipelineMetricsSnapshot> ret;
+    for (const auto &p_name_ins : map_name2instance_)
+    {
+      ret.push_back(GetPipelineMetrics(p_name_ins.first));
+    }
+    return ret;
+  }
+
+  /**
+   * @brief Write the metrics of all configured pipelines to `file_path` in Prometheus text
+   * format.
+   *
+   * @param file_path
+   * @return true
+   * @return false if the file could not be written.
+   */
+  bool ExportPipelineMetrics(const std::string &file_path)
+  {
+    return easy_deploy::ExportPipelineMetrics(GetPipelineMetrics(), file_path);
+  }
+
+private:
+  // only lookups, `map_name2instance_` is not modified once the pipelines are configured
+  PipelineInstance<ParsingType> *FindInitializedInstance(const std::string &pipeline_name) noexcept
+  {
+    auto iter = map_name2instance_.find(pipeline_name);
+    if (iter == map_name2instance_.end())
+    {
+      LOG_ERROR("[BaseAsyncPipeline] `PushPipeline` pipeline {%s} is not valid !!!",
+                pipeline_name.c_str());
+      return nullptr;
+    }
+    if (!iter->second.IsInitialized())
+    {
+      LOG_ERROR("[BaseAsyncPipeline] `PushPipeline` pipeline {%s} is not initilized !!!",
+                pipeline_name.c_str());
+      return nullptr;
+    }
+    return &iter->second;
+  }
+
 private:
   std::unordered_map<std::string, PipelineInstance<ParsingType>> map_name2instance_;
 
-  size_t                                               package_index_ = 0;
-  std::unordered_map<size_t, std::promise<ResultType>> map_index2result_;
-  GenResult                                            gen_result_from_package_;
+  GenResult gen_result_from_package_;
+
+  std::shared_ptr<RecyclingBlockPool> promise_pool_ = std::make_shared<RecyclingBlockPool>();
 };
 
 } // namespace easy_deploy
@@ -1,15 +1,50 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
-#include "common_utils/block_queue.hpp"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "common_utils/log.hpp"
+#include "common_utils/object_pool.hpp"
+#include "common_utils/small_function.hpp"
 #include "common_utils/types.hpp"
+#include "common_utils/work_stealing_pool.hpp"
+#include "deploy_core/async_pipeline_metrics.hpp"
+#include "deploy_core/async_pipeline_queue.hpp"
 
 namespace easy_deploy {
 
+/**
+ * @brief How a package left the pipeline, reported to its callback.
+ *
+ * `PIPELINE_SUCCESS` : all the blocks succeeded.
+ * `PIPELINE_FAILED`  : one block returned false or threw on it, the remaining blocks were
+ *                      skipped.
+ * `PIPELINE_DROPPED` : it was discarded before reaching the output stage, e.g. by `ClosePipeline`.
+ * `PIPELINE_TIMEOUT` : it could not finish before its deadline, the remaining blocks were skipped.
+ */
+enum PipelineStatus {
+  PIPELINE_SUCCESS = 0,
+  PIPELINE_FAILED  = 1,
+  PIPELINE_DROPPED = 2,
+  PIPELINE_TIMEOUT = 3
+};
+
 /**
  * @brief Async Pipeline Block
  *
@@ -18,23 +53,42 @@ namespace easy_deploy {
 template <typename ParsingType>
 class AsyncPipelineBlock {
 public:
+  using BatchFunc_t = std::function<bool(const std::vector<ParsingType> &, std::vector<bool> &)>;
+
   AsyncPipelineBlock() = default;
   AsyncPipelineBlock(const AsyncPipelineBlock &block)
-      : func_(block.func_), block_name_(block.block_name_)
+      : func_(block.func_),
+        block_name_(block.block_name_),
+        worker_num_(block.worker_num_),
+        batch_func_(block.batch_func_),
+        max_batch_size_(block.max_batch_size_),
+        batch_timeout_(block.batch_timeout_),
+        trivial_(block.trivial_),
+        fusable_(block.fusable_),
+        branch_num_(block.branch_num_)
   {}
 
   AsyncPipelineBlock &operator=(const AsyncPipelineBlock &block)
   {
-    func_       = block.func_;
-    block_name_ = block.block_name_;
+    func_           = block.func_;
+    block_name_     = block.block_name_;
+    worker_num_     = block.worker_num_;
+    batch_func_     = block.batch_func_;
+    max_batch_size_ = block.max_batch_size_;
+    batch_timeout_  = block.batch_timeout_;
+    trivial_        = block.trivial_;
+    fusable_        = block.fusable_;
+    branch_num_     = block.branch_num_;
     return *this;
   }
 
   AsyncPipelineBlock(const std::function<bool(ParsingType)> &func) : func_(func)
   {}
 
-  AsyncPipelineBlock(const std::function<bool(ParsingType)> &func, const std::string &block_name)
-      : func_(func), block_name_(block_name)
+  AsyncPipelineBlock(const std::function<bool(ParsingType)> &func,
+                     const std::string                      &block_name,
+                     int                                     worker_num = 1)
+      : func_(func), block_name_(block_name), worker_num_(worker_num < 1 ? 1 : worker_num)
   {}
 
   const std::string &GetName() const
@@ -42,6 +96,103 @@ public:
     return block_name_;
   }
 
+  /**
+   * @brief The number of worker threads which drain the input queue of this block concurrently.
+   * The block function must be thread-safe if it is greater than one.
+   *
+   */
+  int GetWorkerNum() const
+  {
+    return worker_num_;
+  }
+
+  void SetWorkerNum(int worker_num)
+  {
+    worker_num_ = worker_num < 1 ? 1 : worker_num;
+  }
+
+  /**
+   * @brief Let the block process packages in batches. The worker takes up to `max_batch_size`
+   * packages, waiting at most `timeout` after the first one, and calls `batch_func` once on them.
+   * `batch_func` gets one result per package preset to true, a package whose result is set to
+   * false is dropped alone. Returning false drops the whole batch.
+   *
+   */
+  void SetBatchFunc(const BatchFunc_t        &batch_func,
+                    size_t                    max_batch_size,
+                    std::chrono::microseconds timeout)
+  {
+    batch_func_     = batch_func;
+    max_batch_size_ = max_batch_size < 1 ? 1 : max_batch_size;
+    batch_timeout_  = timeout;
+  }
+
+  bool IsBatching() const
+  {
+    return batch_func_ != nullptr && max_batch_size_ > 1;
+  }
+
+  size_t GetMaxBatchSize() const
+  {
+    return max_batch_size_;
+  }
+
+  std::chrono::microseconds GetBatchTimeout() const
+  {
+    return batch_timeout_;
+  }
+
+  /**
+   * @brief A trivial block does nothing but `return true`, the pipeline removes it at `Init`
+   * instead of spending a thread and a queue hand-off on it.
+   *
+   */
+  void SetTrivial(bool trivial)
+  {
+    trivial_ = trivial;
+  }
+
+  bool IsTrivial() const
+  {
+    return trivial_;
+  }
+
+  /**
+   * @brief A fusable block is cheap enough to share its thread, the pipeline merges adjacent
+   * fusable blocks into one block at `Init`.
+   *
+   */
+  void SetFusable(bool fusable)
+  {
+    fusable_ = fusable;
+  }
+
+  bool IsFusable() const
+  {
+    return fusable_;
+  }
+
+  /**
+   * @brief The number of branches a fork-join block runs concurrently on one package, one for a
+   * plain block. A pipeline on dedicated threads keeps `branch_num - 1` helper threads per worker
+   * for it.
+   *
+   */
+  void SetBranchNum(size_t branch_num)
+  {
+    branch_num_ = branch_num < 1 ? 1 : branch_num;
+  }
+
+  size_t GetBranchNum() const
+  {
+    return branch_num_;
+  }
+
+  bool operator()(const std::vector<ParsingType> &pipeline_units, std::vector<bool> &results) const
+  {
+    return batch_func_(pipeline_units, results);
+  }
+
   bool operator()(const ParsingType &pipeline_unit) const
   {
     return func_(pipeline_unit);
@@ -50,6 +201,15 @@ public:
 private:
   std::function<bool(ParsingType)> func_;
   std::string                      block_name_;
+  int                              worker_num_ = 1;
+
+  BatchFunc_t               batch_func_;
+  size_t                    max_batch_size_ = 1;
+  std::chrono::microseconds batch_timeout_{0};
+
+  bool   trivial_    = false;
+  bool   fusable_    = false;
+  size_t branch_num_ = 1;
 };
 
 /**
@@ -124,6 +284,246 @@ public:
   std::vector<Block_t> blocks_;
 };
 
+namespace async_pipeline_detail {
+
+// the pool running the helper branches of the fork-join blocks called on this thread, set by the
+// block workers of a `DEDICATED_THREADS` pipeline. Unset, the helpers run on the global pool
+inline thread_local WorkStealingThreadPool *branch_pool = nullptr;
+
+} // namespace async_pipeline_detail
+
+/**
+ * @brief Async Pipeline Graph
+ *
+ * Blocks are added as nodes which name the nodes they depend on. `ToContext` compiles the graph
+ * into a linear context level by level, a node lands on the level after its last dependency. A
+ * level of one node is its block unchanged, so a chain of nodes gives the same context as
+ * configuring the blocks linearly. The independent nodes of a level become one block which runs
+ * them concurrently on a package, fan-out with the calling thread taking part, and returns once
+ * all of them finished (fan-in). The next level starts after that. A `DEDICATED_THREADS` pipeline
+ * runs the other branches on helper threads of its own, the other modes on the global
+ * `WorkStealingThreadPool`.
+ *
+ * The nodes of a level run on the same package at once and must not touch the same fields.
+ * Batching is only kept for nodes alone on their level.
+ *
+ * @tparam ParsingType
+ */
+template <typename ParsingType>
+class AsyncPipelineGraph {
+  using Block_t   = AsyncPipelineBlock<ParsingType>;
+  using Context_t = AsyncPipelineContext<ParsingType>;
+
+public:
+  AsyncPipelineGraph() = default;
+
+  /**
+   * @brief Add `block` as a node, it runs after all of `dependencies` finished on a package. The
+   * block name identifies the node and must be unique.
+   *
+   * @param block
+   * @param dependencies
+   * @return AsyncPipelineGraph&
+   */
+  AsyncPipelineGraph &AddNode(const Block_t                  &block,
+                              const std::vector<std::string> &dependencies = {})
+  {
+    nodes_.push_back({block, dependencies});
+    return *this;
+  }
+
+  /**
+   * @brief Add the blocks of `context` as a chain of nodes, e.g. the pipeline context of an
+   * inference core. The first one depends on `dependencies`, the last one can be named as
+   * dependency by the following nodes.
+   *
+   * @param context
+   * @param dependencies
+   * @return AsyncPipelineGraph&
+   */
+  AsyncPipelineGraph &AddNodes(const Context_t                &context,
+                               const std::vector<std::string> &dependencies = {})
+  {
+    auto prev = dependencies;
+    for (const auto &block : context.blocks_)
+    {
+      AddNode(block, prev);
+      prev = {block.GetName()};
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Compile the graph into a linear context. Throws `std::invalid_argument` on duplicated
+   * or unknown node names and on cycles.
+   *
+   * @return Context_t
+   */
+  Context_t ToContext() const
+  {
+    std::unordered_map<std::string, size_t> map_name2index;
+    for (size_t i = 0; i < nodes_.size(); ++i)
+    {
+      if (!map_name2index.emplace(nodes_[i].block.GetName(), i).second)
+      {
+        throw std::invalid_argument("[AsyncPipelineGraph] duplicated node : " +
+                                    nodes_[i].block.GetName());
+      }
+    }
+
+    // level of a node = 1 + the highest level of its dependencies, found by relaxing until
+    // nothing changes. More rounds than nodes means there is a cycle
+    std::vector<size_t> levels(nodes_.size(), 0);
+    bool                changed = true;
+    for (size_t round = 0; changed; ++round)
+    {
+      if (round > nodes_.size())
+      {
+        throw std::invalid_argument("[AsyncPipelineGraph] the graph has a cycle");
+      }
+      changed = false;
+      for (size_t i = 0; i < nodes_.size(); ++i)
+      {
+        for (const auto &dependency : nodes_[i].dependencies)
+        {
+          auto iter = map_name2index.find(dependency);
+          if (iter == map_name2index.end())
+          {
+            throw std::invalid_argument("[AsyncPipelineGraph] node " + nodes_[i].block.GetName() +
+                                        " depends on unknown node " + dependency);
+          }
+          if (levels[i] < levels[iter->second] + 1)
+          {
+            levels[i] = levels[iter->second] + 1;
+            changed   = true;
+          }
+        }
+      }
+    }
+
+    std::vector<std::vector<Block_t>> level_blocks;
+    for (size_t i = 0; i < nodes_.size(); ++i)
+    {
+      if (level_blocks.size() <= levels[i])
+      {
+        level_blocks.resize(levels[i] + 1);
+      }
+      level_blocks[levels[i]].push_back(nodes_[i].block);
+    }
+
+    Context_t context;
+    for (auto &blocks : level_blocks)
+    {
+      // a trivial node does not need a branch
+      std::vector<Block_t> branches;
+      for (const auto &block : blocks)
+      {
+        if (!block.IsTrivial())
+        {
+          branches.push_back(block);
+        }
+      }
+      if (branches.size() <= 1)
+      {
+        context.blocks_.push_back(branches.empty() ? blocks.front() : branches.front());
+      } else
+      {
+        context.blocks_.push_back(BuildForkJoinBlock(branches));
+      }
+    }
+    return context;
+  }
+
+private:
+  struct Node {
+    Block_t                  block;
+    std::vector<std::string> dependencies;
+  };
+
+  // shared with the helper tasks, which may start after the block function returned
+  struct _ForkJoinState {
+    explicit _ForkJoinState(std::vector<Block_t> *_branches, ParsingType _unit)
+        : branches(_branches), unit(std::move(_unit))
+    {}
+
+    // claim branches until there is none left, the calling thread and the helpers share the work
+    void Run()
+    {
+      size_t index;
+      while ((index = next.fetch_add(1)) < branches->size())
+      {
+        bool success = false;
+        try
+        {
+          success = (*branches)[index](unit);
+        } catch (...)
+        {
+          std::lock_guard<std::mutex> lck(mutex);
+          error = error == nullptr ? std::current_exception() : error;
+        }
+        std::lock_guard<std::mutex> lck(mutex);
+        all_success &= success;
+        if (++done == branches->size())
+        {
+          cv.notify_all();
+        }
+      }
+    }
+
+    std::vector<Block_t> *branches;
+    ParsingType           unit;
+    std::atomic<size_t>   next{0};
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    size_t                  done        = 0;
+    bool                    all_success = true;
+    std::exception_ptr      error;
+  };
+
+  static Block_t BuildForkJoinBlock(const std::vector<Block_t> &branches)
+  {
+    std::string name       = branches.front().GetName();
+    int         worker_num = branches.front().GetWorkerNum();
+    for (size_t i = 1; i < branches.size(); ++i)
+    {
+      name += " | " + branches[i].GetName();
+      worker_num = std::min(worker_num, branches[i].GetWorkerNum());
+    }
+
+    auto p_branches = std::make_shared<std::vector<Block_t>>(branches);
+    auto func       = [p_branches](ParsingType unit) -> bool {
+      auto state = std::make_shared<_ForkJoinState>(p_branches.get(), unit);
+      std::shared_ptr<WorkStealingThreadPool> global_pool;
+      WorkStealingThreadPool                 *pool = async_pipeline_detail::branch_pool;
+      if (pool == nullptr)
+      {
+        global_pool = WorkStealingThreadPool::Global();
+        pool        = global_pool.get();
+      }
+      for (size_t i = 1; i < p_branches->size(); ++i)
+      {
+        pool->Submit([state, p_branches]() { state->Run(); });
+      }
+      // helpers which do not start in time find nothing left, the join never waits on the pool
+      state->Run();
+      std::unique_lock<std::mutex> lck(state->mutex);
+      state->cv.wait(lck, [&state]() { return state->done == state->branches->size(); });
+      if (state->error != nullptr)
+      {
+        std::rethrow_exception(state->error);
+      }
+      return state->all_success;
+    };
+    Block_t block(func, name, worker_num);
+    block.SetBranchNum(branches.size());
+    return block;
+  }
+
+private:
+  std::vector<Node> nodes_;
+};
+
 /**
  * @brief Async Pipeline Processing Instance
  *
@@ -133,12 +533,35 @@ template <typename ParsingType>
 class PipelineInstance {
   using Block_t    = AsyncPipelineBlock<ParsingType>;
   using Context_t  = AsyncPipelineContext<ParsingType>;
-  using Callback_t = std::function<bool(const ParsingType &)>;
+  // stored inline in the pooled `_InnerPackage`, no allocation per package
+  using Callback_t = SmallFunction<bool(const ParsingType &, PipelineStatus), 128>;
 
   // for inner processing
   struct _InnerPackage {
     ParsingType package;
     Callback_t  callback;
+    // submission order, used to restore the order after multi-worker blocks
+    size_t seq = 0;
+    // the remaining blocks skip the package once it is not `PIPELINE_SUCCESS` any more
+    PipelineStatus status = PIPELINE_SUCCESS;
+    // `deadline` is `time_point::max()` if the package has none
+    std::chrono::steady_clock::time_point capture_time;
+    std::chrono::steady_clock::time_point deadline;
+
+    ~_InnerPackage()
+    {
+      // never reached the output stage, the callback is still owed a status
+      if (callback)
+      {
+        try
+        {
+          callback(package, PIPELINE_DROPPED);
+        } catch (const std::exception &e)
+        {
+          LOG_ERROR("[AsyncPipelineInstance] callback of a dropped package threw : %s", e.what());
+        }
+      }
+    }
   };
   using InnerParsingType = std::shared_ptr<_InnerPackage>;
   using InnerBlock_t     = AsyncPipelineBlock<InnerParsingType>;
@@ -154,7 +577,24 @@ public:
     for (const auto &block : context_.blocks_)
     {
       auto         func = [&](InnerParsingType p) -> bool { return block(p->package); };
-      InnerBlock_t inner_block(func, block.GetName());
+      InnerBlock_t inner_block(func, block.GetName(), block.GetWorkerNum());
+      inner_block.SetTrivial(block.IsTrivial());
+      inner_block.SetFusable(block.IsFusable());
+      inner_block.SetBranchNum(block.GetBranchNum());
+      if (block.IsBatching())
+      {
+        auto batch_func = [&](const std::vector<InnerParsingType> &ps,
+                              std::vector<bool>                   &results) -> bool {
+          std::vector<ParsingType> units;
+          units.reserve(ps.size());
+          for (const auto &p : ps)
+          {
+            units.push_back(p->package);
+          }
+          return block(units, results);
+        };
+        inner_block.SetBatchFunc(batch_func, block.GetMaxBatchSize(), block.GetBatchTimeout());
+      }
       inner_block_list.push_back(inner_block);
     }
     inner_context_ = InnerContext_t(inner_block_list);
@@ -166,26 +606,135 @@ public:
   }
 
   void Init(int bq_max_size = 100)
+  {
+    PipelineOptions options;
+    options.queue_max_size = bq_max_size;
+    Init(options);
+  }
+
+  void Init(const PipelineOptions &options)
   {
     // 1. for `n` blocks, construct `n+1` block queues
-    const auto blocks = inner_context_.blocks_;
-    const int  n      = blocks.size();
+    auto blocks = inner_context_.blocks_;
+    for (auto &block : blocks)
+    {
+      if (options.block_worker_num.find(block.GetName()) != options.block_worker_num.end())
+      {
+        block.SetWorkerNum(options.block_worker_num.at(block.GetName()));
+      }
+    }
+    if (options.optimize_blocks)
+    {
+      blocks = OptimizeBlocks(blocks);
+    }
+    const int n = blocks.size();
     LOG_DEBUG("[AsyncPipelineInstance] Total {%d} Pipeline Blocks", n);
-    for (int i = 0; i < n + 1; ++i)
+    std::vector<std::shared_ptr<PipelineBlockRecorder>> block_recorders(n);
+    if (options.enable_metrics)
     {
-      block_queue_.emplace_back(std::make_shared<BlockQueue<InnerParsingType>>(bq_max_size));
+      for (int i = 0; i < n; ++i)
+      {
+        block_recorders[i] =
+            std::make_shared<PipelineBlockRecorder>(blocks[i].GetName(), blocks[i].GetWorkerNum());
+      }
+    }
+    const bool use_pool = options.execution == PipelineExecution::SHARED_THREAD_POOL;
+    const bool use_rtc  = options.execution == PipelineExecution::RUN_TO_COMPLETION;
+    int        rtc_worker_num = options.run_to_completion_workers;
+    if (use_rtc && rtc_worker_num <= 0)
+    {
+      rtc_worker_num = 0;
+      for (const auto &block : blocks)
+      {
+        rtc_worker_num += block.GetWorkerNum();
+      }
+      rtc_worker_num = std::max(rtc_worker_num, 1);
+    }
+    {
+      std::lock_guard<std::mutex> lck(metrics_mutex_);
+      // run-to-completion only needs the input and the output queue
+      const int queue_num = use_rtc ? 2 : n + 1;
+      for (int i = 0; i < queue_num; ++i)
+      {
+        // the first queue is fed by the user threads calling `PushPipeline`
+        const bool single_producer =
+            i > 0 && (use_rtc ? rtc_worker_num == 1 : blocks[i - 1].GetWorkerNum() == 1);
+        const bool single_consumer =
+            i == queue_num - 1 || (!use_rtc && blocks[i].GetWorkerNum() == 1);
+        // a covering producer pops the oldest package, the link is not single-consumer then. The
+        // pool tasks of one block may run on any pool thread.
+        block_queue_.emplace_back(CreatePipelineQueue<InnerParsingType>(
+            use_pool ? PipelineQueueType::BLOCK_QUEUE : options.queue_type, options.queue_max_size,
+            single_producer && single_consumer && !options.cover_oldest && !use_pool));
+      }
+      block_recorders_ = block_recorders;
+      pushed_count_.store(0);
+      output_count_.store(0);
+      dropped_count_.store(0);
+      evicted_count_.store(0);
+      timeout_count_.store(0);
+      end_to_end_latency_ =
+          options.enable_metrics ? std::make_shared<LatencyHistogram>() : nullptr;
     }
     pipeline_close_flag_.store(false);
+    cover_oldest_   = options.cover_oldest;
+    latency_target_ = options.latency_target;
+    block_cost_ns_  = std::make_unique<std::atomic<uint64_t>[]>(n);
+    block_num_      = n;
+
+    // packages may overtake each other in a multi-worker block, restore the order before output
+    reorder_output_ = use_rtc && rtc_worker_num > 1;
+    for (const auto &block : blocks)
+    {
+      reorder_output_ |= !use_rtc && block.GetWorkerNum() > 1;
+    }
+    push_seq_.store(0);
+    next_output_seq_ = 0;
+    reorder_buffer_.clear();
+    {
+      std::lock_guard<std::mutex> lck(evicted_seq_mutex_);
+      evicted_seqs_.clear();
+    }
 
-    async_futures_.resize(n + 1);
-    // 2. open `n` async threads to execute blocks
-    for (int i = 0; i < n; ++i)
+    thread_pool_ = use_pool ? WorkStealingThreadPool::Global() : nullptr;
+    if (use_pool)
     {
-      async_futures_[i] = std::async(&PipelineInstance::ThreadExcuteEntry, this, block_queue_[i],
-                                     block_queue_[i + 1], blocks[i]);
+      StartPoolStages(blocks, block_recorders, options.queue_max_size);
+      pipeline_initialized_.store(true);
+      return;
+    }
+
+    // 2. open `worker_num` async threads for each block, or the run-to-completion workers
+    if (use_rtc)
+    {
+      StartRunToCompletion(blocks, block_recorders, rtc_worker_num, options.pin_threads);
+    } else
+    {
+      // every worker of a fork-join block gets its own helpers, a level never waits on another
+      size_t helper_num = 0;
+      for (const auto &block : blocks)
+      {
+        helper_num += (block.GetBranchNum() - 1) * block.GetWorkerNum();
+      }
+      branch_pool_ = helper_num > 0 ? std::make_shared<WorkStealingThreadPool>(helper_num)
+                                    : nullptr;
+      for (int i = 0; i < n; ++i)
+      {
+        const int worker_num = blocks[i].GetWorkerNum();
+        auto      alive_num  = std::make_shared<std::atomic<int>>(worker_num);
+        for (int w = 0; w < worker_num; ++w)
+        {
+          auto entry = blocks[i].IsBatching() ? &PipelineInstance::ThreadBatchExcuteEntry
+                                              : &PipelineInstance::ThreadExcuteEntry;
+          async_futures_.emplace_back(std::async(entry, this, block_queue_[i],
+                                                 block_queue_[i + 1], blocks[i], i, alive_num,
+                                                 block_recorders[i]));
+        }
+      }
     }
     // 3. open output threads to execute callback
-    async_futures_[n] = std::async(&PipelineInstance::ThreadOutputEntry, this, block_queue_[n]);
+    async_futures_.emplace_back(
+        std::async(&PipelineInstance::ThreadOutputEntry, this, block_queue_.back()));
 
     pipeline_initialized_.store(true);
   }
@@ -195,6 +744,8 @@ public:
     if (pipeline_initialized_)
     {
       LOG_DEBUG("[AsyncPipelineInstance] Closing pipeline ...");
+      // the dropped packages run their callbacks, which may read the metrics, so they are
+      // released without holding `metrics_mutex_`
       for (const auto &bq : block_queue_)
       {
         bq->DisableAndClear();
@@ -206,8 +757,23 @@ public:
       {
         auto res = future.get();
       }
+      if (thread_pool_ != nullptr)
+      {
+        std::unique_lock<std::mutex> lck(pool_task_mutex_);
+        pool_task_cv_.wait(lck, [this]() { return running_pool_tasks_.load() == 0; });
+      }
+      // the block workers are gone, the helpers only find branches which are already claimed
+      branch_pool_.reset();
       LOG_DEBUG("[AsyncPipelineInstance] Join all block queue ...");
-      block_queue_.clear();
+      async_futures_.clear();
+      std::vector<std::shared_ptr<IPipelineQueue<InnerParsingType>>> closed_queues;
+      {
+        // the block recorders are kept, the metrics stay readable after the pipeline is closed
+        std::lock_guard<std::mutex> lck(metrics_mutex_);
+        closed_queues.swap(block_queue_);
+      }
+      closed_queues.clear();
+      reorder_buffer_.clear();
       LOG_DEBUG("[AsyncPipelineInstance] Async pipeline is released successfully!!");
       pipeline_initialized_ = false;
       pipeline_close_flag_.store(true);
@@ -234,31 +800,279 @@ public:
     return context_;
   }
 
-  void PushPipeline(const ParsingType &obj, const Callback_t &callback)
+  bool IsCoverOldest() const
+  {
+    return cover_oldest_;
+  }
+
+  /**
+   * @brief Push a package. With `cover_oldest`, or if the pipeline was initialized in
+   * `cover_oldest` mode, a full input queue drops its oldest package instead of blocking.
+   * `capture_time` defaults to now, `deadline` to `capture_time` plus the latency target of the
+   * pipeline if there is one.
+   *
+   */
+  void PushPipeline(const ParsingType                    &obj,
+                    Callback_t                            callback,
+                    bool                                  cover_oldest = false,
+                    std::chrono::steady_clock::time_point capture_time = {},
+                    std::chrono::steady_clock::time_point deadline =
+                        std::chrono::steady_clock::time_point::max())
   {
-    auto inner_pack      = std::make_shared<_InnerPackage>();
-    inner_pack->package  = obj;
-    inner_pack->callback = callback;
+    if (capture_time == std::chrono::steady_clock::time_point{})
+    {
+      capture_time = std::chrono::steady_clock::now();
+    }
+    if (deadline == std::chrono::steady_clock::time_point::max() && latency_target_.count() > 0)
+    {
+      deadline = capture_time + latency_target_;
+    }
+
+    auto inner_pack          = MakePooledShared<_InnerPackage>(inner_package_pool_);
+    inner_pack->package      = obj;
+    inner_pack->callback     = std::move(callback);
+    inner_pack->seq          = push_seq_.fetch_add(1);
+    inner_pack->capture_time = capture_time;
+    inner_pack->deadline     = deadline;
+
+    pushed_count_.fetch_add(1, std::memory_order_relaxed);
+    if (!PushAndRecord(*block_queue_[0], inner_pack, nullptr, cover_oldest))
+    {
+      dropped_count_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    if (thread_pool_ != nullptr)
+    {
+      SchedulePoolStage(0);
+    }
+  }
+
+  /**
+   * @brief Drop the oldest package which has not entered the first block yet, e.g. to get back
+   * the buffers it holds. Return false if there is none.
+   *
+   */
+  bool DropOldestPending()
+  {
+    // the first queue is never a `SPSC_QUEUE`, taking from here is safe
+    auto data = block_queue_[0]->TryTake();
+    if (!data.has_value())
+    {
+      return false;
+    }
+    OnEvicted(std::move(data.value()));
+    return true;
+  }
 
-    block_queue_[0]->BlockPush(inner_pack);
+  /**
+   * @brief Take a snapshot of the pipeline metrics. Safe to call from any thread, also while
+   * the pipeline is running. Empty if the pipeline was initialized with metrics disabled.
+   *
+   * @return PipelineMetricsSnapshot
+   */
+  PipelineMetricsSnapshot GetMetrics()
+  {
+    PipelineMetricsSnapshot snapshot;
+    std::lock_guard<std::mutex> lck(metrics_mutex_);
+    snapshot.pushed_count  = pushed_count_.load(std::memory_order_relaxed);
+    snapshot.output_count  = output_count_.load(std::memory_order_relaxed);
+    snapshot.dropped_count = dropped_count_.load(std::memory_order_relaxed);
+    snapshot.evicted_count = evicted_count_.load(std::memory_order_relaxed);
+    snapshot.timeout_count = timeout_count_.load(std::memory_order_relaxed);
+    if (end_to_end_latency_ != nullptr)
+    {
+      snapshot.end_to_end_latency = end_to_end_latency_->Snapshot();
+    }
+    for (const auto &recorder : block_recorders_)
+    {
+      if (recorder != nullptr)
+      {
+        snapshot.blocks.push_back(recorder->Snapshot());
+      }
+    }
+    for (size_t i = 0; i < block_queue_.size(); ++i)
+    {
+      PipelineQueueMetrics queue_metrics;
+      queue_metrics.index           = i;
+      queue_metrics.size            = block_queue_[i]->Size();
+      queue_metrics.high_water_mark = block_queue_[i]->GetHighWaterMark();
+      queue_metrics.capacity        = block_queue_[i]->GetMaxSize();
+      snapshot.queues.push_back(queue_metrics);
+    }
+    return snapshot;
   }
 
 private:
-  bool ThreadExcuteEntry(std::shared_ptr<BlockQueue<InnerParsingType>> bq_input,
-                         std::shared_ptr<BlockQueue<InnerParsingType>> bq_output,
-                         const InnerBlock_t                           &pipeline_block)
+  // remove the trivial blocks and merge each run of adjacent fusable blocks into one block, which
+  // runs their functions in order on the thread of the slowest of them
+  static std::vector<InnerBlock_t> OptimizeBlocks(const std::vector<InnerBlock_t> &blocks)
+  {
+    std::vector<InnerBlock_t> ret;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+      if (blocks[i].IsTrivial())
+      {
+        LOG_DEBUG("[AsyncPipelineInstance] remove trivial block {%s}",
+                  blocks[i].GetName().c_str());
+        continue;
+      }
+      const bool fuse = blocks[i].IsFusable() && !blocks[i].IsBatching() && !ret.empty() &&
+                        ret.back().IsFusable() && !ret.back().IsBatching();
+      if (!fuse)
+      {
+        ret.push_back(blocks[i]);
+        continue;
+      }
+      auto prev  = ret.back();
+      auto block = blocks[i];
+      auto func  = [prev, block](InnerParsingType p) -> bool { return prev(p) && block(p); };
+      InnerBlock_t fused(func, prev.GetName() + " + " + block.GetName(),
+                         std::min(prev.GetWorkerNum(), block.GetWorkerNum()));
+      fused.SetFusable(true);
+      LOG_DEBUG("[AsyncPipelineInstance] fuse block {%s}", fused.GetName().c_str());
+      ret.back() = fused;
+    }
+    return ret;
+  }
+
+  // run the block function on one package, a failed or late package only passes through
+  void ExecuteBlock(const InnerBlock_t     &pipeline_block,
+                    size_t                  block_index,
+                    const InnerParsingType &inner_pack,
+                    PipelineBlockRecorder  *recorder)
+  {
+    if (inner_pack->status != PIPELINE_SUCCESS || !CheckDeadline(*inner_pack, block_index))
+    {
+      return;
+    }
+
+    try
+    {
+      auto       start   = std::chrono::steady_clock::now();
+      const bool success = pipeline_block(inner_pack);
+      auto       end     = std::chrono::steady_clock::now();
+      UpdateBlockCost(block_index, PipelineBlockRecorder::ElapsedNs(start, end));
+      if (recorder != nullptr)
+      {
+        recorder->latency.Record(PipelineBlockRecorder::ElapsedNs(start, end));
+        recorder->processed_count.fetch_add(1, std::memory_order_relaxed);
+      }
+      LOG_DEBUG("[AsyncPipelineInstance] Block name: {%s}, cost(us): %ld",
+                pipeline_block.GetName().c_str(),
+                std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+      if (!success)
+      {
+        LOG_ERROR("[AsyncPipelineInstance] {%s}, block function returned false, Drop package.",
+                  pipeline_block.GetName().c_str());
+        inner_pack->status = PIPELINE_FAILED;
+        if (recorder != nullptr)
+        {
+          recorder->failed_count.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    } catch (const std::exception &e)
+    {
+      LOG_ERROR(
+          "[AsyncPipelineInstance] {%s}, excute block function failed! Got exception : %s, Drop "
+          "package.",
+          pipeline_block.GetName().c_str(), e.what());
+      // still forward the package, the output stage may be waiting for it to keep the order
+      inner_pack->status = PIPELINE_FAILED;
+      if (recorder != nullptr)
+      {
+        recorder->failed_count.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void ExecuteBatchBlock(const InnerBlock_t                  &pipeline_block,
+                         size_t                               block_index,
+                         const std::vector<InnerParsingType> &batch,
+                         PipelineBlockRecorder               *recorder)
+  {
+    // failed and late packages only pass through
+    std::vector<InnerParsingType> valid_batch;
+    valid_batch.reserve(batch.size());
+    for (const auto &p : batch)
+    {
+      if (p->status == PIPELINE_SUCCESS && CheckDeadline(*p, block_index))
+      {
+        valid_batch.push_back(p);
+      }
+    }
+
+    if (!valid_batch.empty())
+    {
+      try
+      {
+        std::vector<bool> results(valid_batch.size(), true);
+        auto              start   = std::chrono::steady_clock::now();
+        const bool        success = pipeline_block(valid_batch, results);
+        auto              end     = std::chrono::steady_clock::now();
+        UpdateBlockCost(block_index, PipelineBlockRecorder::ElapsedNs(start, end));
+        if (recorder != nullptr)
+        {
+          recorder->latency.Record(PipelineBlockRecorder::ElapsedNs(start, end));
+          recorder->processed_count.fetch_add(valid_batch.size(), std::memory_order_relaxed);
+        }
+        LOG_DEBUG("[AsyncPipelineInstance] Block name: {%s}, batch: %ld, cost(us): %ld",
+                  pipeline_block.GetName().c_str(), valid_batch.size(),
+                  std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        // only the failed packages are dropped, the rest of the batch goes on
+        size_t failed_count = 0;
+        for (size_t i = 0; i < valid_batch.size(); ++i)
+        {
+          if (!success || i >= results.size() || !results[i])
+          {
+            valid_batch[i]->status = PIPELINE_FAILED;
+            ++failed_count;
+          }
+        }
+        if (failed_count > 0)
+        {
+          LOG_ERROR(
+              "[AsyncPipelineInstance] {%s}, batch block function failed, Drop %ld of %ld "
+              "packages.",
+              pipeline_block.GetName().c_str(), failed_count, valid_batch.size());
+          if (recorder != nullptr)
+          {
+            recorder->failed_count.fetch_add(failed_count, std::memory_order_relaxed);
+          }
+        }
+      } catch (const std::exception &e)
+      {
+        LOG_ERROR(
+            "[AsyncPipelineInstance] {%s}, excute batch block function failed! Got exception : "
+            "%s, Drop %ld packages.",
+            pipeline_block.GetName().c_str(), e.what(), valid_batch.size());
+        for (auto &p : valid_batch)
+        {
+          p->status = PIPELINE_FAILED;
+        }
+        if (recorder != nullptr)
+        {
+          recorder->failed_count.fetch_add(valid_batch.size(), std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+  bool ThreadExcuteEntry(std::shared_ptr<IPipelineQueue<InnerParsingType>> bq_input,
+                         std::shared_ptr<IPipelineQueue<InnerParsingType>> bq_output,
+                         const InnerBlock_t                               &pipeline_block,
+                         size_t                                            block_index,
+                         std::shared_ptr<std::atomic<int>>                 alive_worker_num,
+                         std::shared_ptr<PipelineBlockRecorder>            recorder)
   {
     LOG_DEBUG("[AsyncPipelineInstance] {%s} thread start!", pipeline_block.GetName().c_str());
+    async_pipeline_detail::branch_pool = branch_pool_.get();
     while (!pipeline_close_flag_)
     {
-      auto data = bq_input->Take();
+      auto data = TakeAndRecord(*bq_input, recorder.get());
       if (!data.has_value())
       {
         if (pipeline_no_more_input_)
         {
-          LOG_DEBUG("[AsyncPipelineInstance] {%s} set no more output ...",
-                    pipeline_block.GetName().c_str());
-          bq_output->SetNoMoreInput();
           break;
         } else
         {
@@ -266,37 +1080,194 @@ private:
         }
       }
 
-      try
+      ExecuteBlock(pipeline_block, block_index, data.value(), recorder.get());
+      PushAndRecord(*bq_output, data.value(), recorder.get());
+    }
+    // the last worker of this block tells the next block that no more input will come
+    if (alive_worker_num->fetch_sub(1) == 1 && pipeline_no_more_input_)
+    {
+      LOG_DEBUG("[AsyncPipelineInstance] {%s} set no more output ...",
+                pipeline_block.GetName().c_str());
+      bq_output->SetNoMoreInput();
+    }
+    async_pipeline_detail::branch_pool = nullptr;
+    LOG_DEBUG("[AsyncPipelineInstance] {%s} thread quit!", pipeline_block.GetName().c_str());
+    return true;
+  }
+
+  bool ThreadBatchExcuteEntry(std::shared_ptr<IPipelineQueue<InnerParsingType>> bq_input,
+                              std::shared_ptr<IPipelineQueue<InnerParsingType>> bq_output,
+                              const InnerBlock_t                               &pipeline_block,
+                              size_t                                            block_index,
+                              std::shared_ptr<std::atomic<int>>                 alive_worker_num,
+                              std::shared_ptr<PipelineBlockRecorder>            recorder)
+  {
+    LOG_DEBUG("[AsyncPipelineInstance] {%s} batch thread start!",
+              pipeline_block.GetName().c_str());
+    async_pipeline_detail::branch_pool = branch_pool_.get();
+    std::vector<InnerParsingType> batch;
+    batch.reserve(pipeline_block.GetMaxBatchSize());
+    while (!pipeline_close_flag_)
+    {
+      auto data = TakeAndRecord(*bq_input, recorder.get());
+      if (!data.has_value())
       {
-        auto start = std::chrono::high_resolution_clock::now();
-        pipeline_block(data.value());
-        auto end = std::chrono::high_resolution_clock::now();
-        LOG_DEBUG("[AsyncPipelineInstance] Block name: {%s}, cost(us): %ld",
-                  pipeline_block.GetName().c_str(),
-                  std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
-      } catch (const std::exception &e)
+        if (pipeline_no_more_input_)
+        {
+          break;
+        } else
+        {
+          continue;
+        }
+      }
+
+      // 1. collect up to `max_batch_size` packages, or until the deadline
+      batch.clear();
+      batch.push_back(std::move(data.value()));
+      const auto deadline = std::chrono::steady_clock::now() + pipeline_block.GetBatchTimeout();
+      while (batch.size() < pipeline_block.GetMaxBatchSize())
       {
-        LOG_ERROR(
-            "[AsyncPipelineInstance] {%s}, excute block function failed! Got exception : %s, Drop "
-            "package.",
-            pipeline_block.GetName().c_str(), e.what());
-        continue;
+        auto next = bq_input->TakeUntil(deadline);
+        if (!next.has_value())
+        {
+          break;
+        }
+        batch.push_back(std::move(next.value()));
       }
 
-      bq_output->BlockPush(data.value());
+      // 2. run the block function on the valid packages, all of them are forwarded
+      ExecuteBatchBlock(pipeline_block, block_index, batch, recorder.get());
+
+      for (auto &p : batch)
+      {
+        PushAndRecord(*bq_output, p, recorder.get());
+      }
+    }
+    if (alive_worker_num->fetch_sub(1) == 1 && pipeline_no_more_input_)
+    {
+      bq_output->SetNoMoreInput();
+    }
+    async_pipeline_detail::branch_pool = nullptr;
+    LOG_DEBUG("[AsyncPipelineInstance] {%s} batch thread quit!", pipeline_block.GetName().c_str());
+    return true;
+  }
+
+  void StartRunToCompletion(const std::vector<InnerBlock_t>                           &blocks,
+                            const std::vector<std::shared_ptr<PipelineBlockRecorder>> &recorders,
+                            int                                                        worker_num,
+                            bool                                                       pin_threads)
+  {
+    rtc_blocks_    = blocks;
+    rtc_recorders_ = recorders;
+    rtc_block_slots_.clear();
+    for (const auto &block : blocks)
+    {
+      auto slots  = std::make_unique<_BlockSlots>();
+      slots->free = block.GetWorkerNum();
+      rtc_block_slots_.push_back(std::move(slots));
+    }
+    auto alive_num = std::make_shared<std::atomic<int>>(worker_num);
+    for (int w = 0; w < worker_num; ++w)
+    {
+      async_futures_.emplace_back(std::async(&PipelineInstance::ThreadRunToCompletionEntry, this,
+                                             w, pin_threads, alive_num));
+    }
+    LOG_DEBUG("[AsyncPipelineInstance] {%d} run-to-completion workers for {%ld} blocks",
+              worker_num, blocks.size());
+  }
+
+  bool ThreadRunToCompletionEntry(int                               worker_index,
+                                  bool                              pin_thread,
+                                  std::shared_ptr<std::atomic<int>> alive_worker_num)
+  {
+    if (pin_thread)
+    {
+      PinCurrentThread(worker_index);
+    }
+    auto                         &bq_input  = *block_queue_.front();
+    auto                         &bq_output = *block_queue_.back();
+    std::vector<InnerParsingType> batch(1);
+    while (!pipeline_close_flag_)
+    {
+      auto data = TakeAndRecord(bq_input, nullptr);
+      if (!data.has_value())
+      {
+        if (pipeline_no_more_input_)
+        {
+          break;
+        } else
+        {
+          continue;
+        }
+      }
+
+      for (size_t i = 0; i < rtc_blocks_.size(); ++i)
+      {
+        if (data.value()->status != PIPELINE_SUCCESS)
+        {
+          break;
+        }
+        _BlockSlotGuard guard(*rtc_block_slots_[i]);
+        if (rtc_blocks_[i].IsBatching())
+        {
+          batch[0] = data.value();
+          ExecuteBatchBlock(rtc_blocks_[i], i, batch, rtc_recorders_[i].get());
+        } else
+        {
+          ExecuteBlock(rtc_blocks_[i], i, data.value(), rtc_recorders_[i].get());
+        }
+      }
+      batch[0].reset();
+      PushAndRecord(bq_output, data.value(), nullptr);
+    }
+    if (alive_worker_num->fetch_sub(1) == 1 && pipeline_no_more_input_)
+    {
+      bq_output.SetNoMoreInput();
     }
-    LOG_DEBUG("[AsyncPipelineInstance] {%s} thread quit!", pipeline_block.GetName().c_str());
     return true;
   }
 
-  bool ThreadOutputEntry(std::shared_ptr<BlockQueue<InnerParsingType>> bq_input)
+  // keeps a run-to-completion worker, and the packages it works on, on one core
+  static void PinCurrentThread(int worker_index)
+  {
+#ifdef __linux__
+    const unsigned core_num = std::thread::hardware_concurrency();
+    if (core_num == 0)
+    {
+      return;
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(worker_index % core_num, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+    {
+      LOG_WARN("[AsyncPipelineInstance] Failed to pin worker {%d} to core {%d}", worker_index,
+               worker_index % core_num);
+    }
+#else
+    LOG_WARN("[AsyncPipelineInstance] thread pinning is not supported on this platform");
+#endif
+  }
+
+  bool ThreadOutputEntry(std::shared_ptr<IPipelineQueue<InnerParsingType>> bq_input)
   {
     LOG_DEBUG("[AsyncPipelineInstance] {Output} thread start!");
     while (!pipeline_close_flag_)
     {
-      auto data = bq_input->Take();
+      // an evicted package may be recorded only after its successors arrived, wait for it with
+      // a timeout then
+      const bool waiting_evicted = reorder_output_ && !reorder_buffer_.empty() && HasEvicted();
+      auto       data            = waiting_evicted
+                                       ? bq_input->TakeUntil(std::chrono::steady_clock::now() +
+                                                             kEvictedRecheckInterval)
+                                       : bq_input->Take();
       if (!data.has_value())
       {
+        if (waiting_evicted)
+        {
+          FlushReorderBuffer();
+          continue;
+        }
         if (pipeline_no_more_input_)
         {
           LOG_DEBUG("[AsyncPipelineInstance] {Output} set no more output ...");
@@ -306,29 +1277,433 @@ private:
           continue;
         }
       }
-      const auto &inner_pack = data.value();
-      if (inner_pack != nullptr && inner_pack->callback != nullptr)
-      {
-        inner_pack->callback(inner_pack->package);
-      } else
+      if (!reorder_output_)
       {
-        LOG_WARN(
-            "[AsyncPipelineInstance] {Output} package without valid callback will be dropped!!!");
+        OutputPackage(data.value());
+        continue;
       }
+
+      reorder_buffer_.emplace(data.value()->seq, data.value());
+      FlushReorderBuffer();
     }
     LOG_DEBUG("[AsyncPipelineInstance] {Output} thread quit!");
 
     return true;
   }
 
+  void StartPoolStages(const std::vector<InnerBlock_t>                           &blocks,
+                       const std::vector<std::shared_ptr<PipelineBlockRecorder>> &recorders,
+                       size_t                                                     max_inflight)
+  {
+    max_inflight_ = max_inflight;
+    inflight_.store(0);
+    evicted_since_flush_.store(false);
+    pool_stages_.clear();
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+      auto stage        = std::make_unique<_PoolStage>();
+      stage->block      = blocks[i];
+      stage->recorder   = recorders[i];
+      stage->max_active = blocks[i].GetWorkerNum();
+      pool_stages_.push_back(std::move(stage));
+    }
+    // the output stage
+    pool_stages_.push_back(std::make_unique<_PoolStage>());
+    LOG_DEBUG("[AsyncPipelineInstance] {%ld} blocks scheduled on the shared thread pool of {%ld} "
+              "threads",
+              blocks.size(), thread_pool_->GetThreadNum());
+  }
+
+  bool PoolStageRunnable(size_t index)
+  {
+    if (index == block_num_ && evicted_since_flush_.load())
+    {
+      return true;
+    }
+    if (block_queue_[index]->Size() == 0)
+    {
+      return false;
+    }
+    return index != 0 || block_num_ == 0 || inflight_.load() < max_inflight_;
+  }
+
+  // submit a task for the block if it has work and runs on less than `worker_num` tasks
+  void SchedulePoolStage(size_t index)
+  {
+    auto &stage = *pool_stages_[index];
+    if (!PoolStageRunnable(index))
+    {
+      return;
+    }
+    int active = stage.active.load();
+    while (active < stage.max_active)
+    {
+      if (stage.active.compare_exchange_weak(active, active + 1))
+      {
+        running_pool_tasks_.fetch_add(1);
+        // `ClosePipeline` waits for the running tasks after setting the flag
+        if (pipeline_close_flag_.load())
+        {
+          stage.active.fetch_sub(1);
+          FinishPoolTask();
+          return;
+        }
+        thread_pool_->Submit([this, index]() { RunPoolStage(index); });
+        return;
+      }
+    }
+  }
+
+  void FinishPoolTask()
+  {
+    // decremented under the lock, `ClosePipeline` may destroy the instance right after
+    std::lock_guard<std::mutex> lck(pool_task_mutex_);
+    if (running_pool_tasks_.fetch_sub(1) == 1)
+    {
+      pool_task_cv_.notify_all();
+    }
+  }
+
+  // the packages taken by the first block are in flight until the output stage takes them
+  std::optional<InnerParsingType> PoolTake(size_t index)
+  {
+    const bool admit = index == 0 && block_num_ > 0;
+    if (admit)
+    {
+      size_t inflight = inflight_.load();
+      do
+      {
+        if (inflight >= max_inflight_)
+        {
+          return std::nullopt;
+        }
+      } while (!inflight_.compare_exchange_weak(inflight, inflight + 1));
+    }
+    auto data = block_queue_[index]->TryTake();
+    if (admit && !data.has_value())
+    {
+      inflight_.fetch_sub(1);
+    }
+    return data;
+  }
+
+  // one run of a block on the thread pool. It processes up to `kPoolTaskQuota` packages and hands
+  // the thread back, so the blocks of all the pipelines on the pool get their turn
+  void RunPoolStage(size_t index)
+  {
+    auto      &stage     = *pool_stages_[index];
+    const bool is_output = index == block_num_;
+    if (is_output && evicted_since_flush_.exchange(false))
+    {
+      FlushReorderBuffer();
+    }
+    for (size_t k = 0; k < kPoolTaskQuota && !pipeline_close_flag_; ++k)
+    {
+      auto data = PoolTake(index);
+      if (!data.has_value())
+      {
+        break;
+      }
+
+      if (is_output)
+      {
+        if (block_num_ > 0)
+        {
+          inflight_.fetch_sub(1);
+          SchedulePoolStage(0);
+        }
+        if (!reorder_output_)
+        {
+          OutputPackage(data.value());
+          continue;
+        }
+        reorder_buffer_.emplace(data.value()->seq, data.value());
+        FlushReorderBuffer();
+        continue;
+      }
+
+      if (stage.block.IsBatching())
+      {
+        std::vector<InnerParsingType> batch{std::move(data.value())};
+        while (batch.size() < stage.block.GetMaxBatchSize())
+        {
+          auto next = PoolTake(index);
+          if (!next.has_value())
+          {
+            break;
+          }
+          batch.push_back(std::move(next.value()));
+        }
+        ExecuteBatchBlock(stage.block, index, batch, stage.recorder.get());
+        for (auto &p : batch)
+        {
+          PushAndRecord(*block_queue_[index + 1], p, stage.recorder.get());
+        }
+      } else
+      {
+        ExecuteBlock(stage.block, index, data.value(), stage.recorder.get());
+        PushAndRecord(*block_queue_[index + 1], data.value(), stage.recorder.get());
+      }
+      SchedulePoolStage(index + 1);
+    }
+    stage.active.fetch_sub(1);
+    // a package pushed after the last take may have found this task still active
+    if (!pipeline_close_flag_)
+    {
+      SchedulePoolStage(index);
+    }
+    FinishPoolTask();
+  }
+
+  // mark the package `PIPELINE_TIMEOUT` if it can not pass the blocks from `block_index` on before
+  // its deadline. The estimate leaves out the queueing time, so only packages which are late for
+  // sure are skipped
+  bool CheckDeadline(_InnerPackage &inner_pack, size_t block_index) noexcept
+  {
+    if (inner_pack.deadline == std::chrono::steady_clock::time_point::max())
+    {
+      return true;
+    }
+    uint64_t remaining_ns = 0;
+    for (size_t i = block_index; i < block_num_; ++i)
+    {
+      remaining_ns += block_cost_ns_[i].load(std::memory_order_relaxed);
+    }
+    if (std::chrono::steady_clock::now() + std::chrono::nanoseconds(remaining_ns) <=
+        inner_pack.deadline)
+    {
+      return true;
+    }
+    inner_pack.status = PIPELINE_TIMEOUT;
+    timeout_count_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // moving average of the block execution time with a weight of 1/8. The workers of one block may
+  // race on it, which is fine for an estimate
+  void UpdateBlockCost(size_t block_index, uint64_t cost_ns) noexcept
+  {
+    auto          &cost     = block_cost_ns_[block_index];
+    const uint64_t old_cost = cost.load(std::memory_order_relaxed);
+    cost.store(old_cost == 0 ? cost_ns : old_cost - old_cost / 8 + cost_ns / 8,
+               std::memory_order_relaxed);
+  }
+
+  // output the buffered packages which are next in order, skipping the evicted ones
+  void FlushReorderBuffer()
+  {
+    while (!reorder_buffer_.empty())
+    {
+      if (reorder_buffer_.begin()->first == next_output_seq_)
+      {
+        OutputPackage(reorder_buffer_.begin()->second);
+        reorder_buffer_.erase(reorder_buffer_.begin());
+        ++next_output_seq_;
+        continue;
+      }
+      std::lock_guard<std::mutex> lck(evicted_seq_mutex_);
+      auto                        iter = evicted_seqs_.find(next_output_seq_);
+      if (iter == evicted_seqs_.end())
+      {
+        break;
+      }
+      evicted_seqs_.erase(iter);
+      ++next_output_seq_;
+    }
+  }
+
+  bool HasEvicted()
+  {
+    std::lock_guard<std::mutex> lck(evicted_seq_mutex_);
+    return !evicted_seqs_.empty();
+  }
+
+  // called by the thread which evicted `inner_pack`, the package reports `PIPELINE_DROPPED` here
+  void OnEvicted(InnerParsingType inner_pack)
+  {
+    evicted_count_.fetch_add(1, std::memory_order_relaxed);
+    dropped_count_.fetch_add(1, std::memory_order_relaxed);
+    if (reorder_output_)
+    {
+      // the output stage must not wait for it
+      {
+        std::lock_guard<std::mutex> lck(evicted_seq_mutex_);
+        evicted_seqs_.insert(inner_pack->seq);
+      }
+      if (thread_pool_ != nullptr)
+      {
+        // the output stage may be idle, waiting for this package
+        evicted_since_flush_.store(true);
+        SchedulePoolStage(block_num_);
+      }
+    }
+    inner_pack.reset();
+  }
+
+  void OutputPackage(const InnerParsingType &inner_pack)
+  {
+    if (inner_pack == nullptr || inner_pack->callback == nullptr)
+    {
+      LOG_WARN(
+          "[AsyncPipelineInstance] {Output} package without valid callback will be dropped!!!");
+      dropped_count_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // taken out, so the package does not report itself as dropped once released
+    Callback_t           callback = std::move(inner_pack->callback);
+    const PipelineStatus status   = inner_pack->status;
+    if (status == PIPELINE_SUCCESS)
+    {
+      output_count_.fetch_add(1, std::memory_order_relaxed);
+      if (end_to_end_latency_ != nullptr)
+      {
+        end_to_end_latency_->Record(PipelineBlockRecorder::ElapsedNs(
+            inner_pack->capture_time, std::chrono::steady_clock::now()));
+      }
+    } else
+    {
+      dropped_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    try
+    {
+      callback(inner_pack->package, status);
+    } catch (const std::exception &e)
+    {
+      LOG_ERROR("[AsyncPipelineInstance] {Output} callback threw : %s", e.what());
+    }
+  }
+
+  // time spent in `Take` is the time the block is starved
+  static std::optional<InnerParsingType> TakeAndRecord(IPipelineQueue<InnerParsingType> &bq,
+                                                       PipelineBlockRecorder *recorder) noexcept
+  {
+    if (recorder == nullptr)
+    {
+      return bq.Take();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    auto       data  = bq.Take();
+    recorder->take_wait_ns.fetch_add(
+        PipelineBlockRecorder::ElapsedNs(start, std::chrono::steady_clock::now()),
+        std::memory_order_relaxed);
+    return data;
+  }
+
+  // time spent in `BlockPush` is the time the block is backpressured by the next one. In
+  // `cover_oldest` mode the push never waits, the oldest package is evicted instead
+  bool PushAndRecord(IPipelineQueue<InnerParsingType> &bq,
+                     const InnerParsingType           &obj,
+                     PipelineBlockRecorder            *recorder,
+                     bool                              cover_oldest = false) noexcept
+  {
+    if (cover_oldest || cover_oldest_)
+    {
+      std::optional<InnerParsingType> evicted;
+      const bool                      ret = bq.CoverPush(obj, evicted);
+      if (evicted.has_value())
+      {
+        OnEvicted(std::move(evicted.value()));
+      }
+      return ret;
+    }
+    if (recorder == nullptr)
+    {
+      return bq.BlockPush(obj);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const bool ret   = bq.BlockPush(obj);
+    recorder->push_wait_ns.fetch_add(
+        PipelineBlockRecorder::ElapsedNs(start, std::chrono::steady_clock::now()),
+        std::memory_order_relaxed);
+    return ret;
+  }
+
 private:
   Context_t context_;
 
+  // recycles the `_InnerPackage`s, shared by the packages in flight
+  std::shared_ptr<RecyclingBlockPool> inner_package_pool_ = std::make_shared<RecyclingBlockPool>();
+
   InnerContext_t inner_context_;
 
-  std::vector<std::shared_ptr<BlockQueue<InnerParsingType>>> block_queue_;
+  std::vector<std::shared_ptr<IPipelineQueue<InnerParsingType>>> block_queue_;
   std::vector<std::future<bool>>                             async_futures_;
 
+  // only touched by the output thread
+  bool                               reorder_output_  = false;
+  size_t                             next_output_seq_ = 0;
+  std::map<size_t, InnerParsingType> reorder_buffer_;
+  std::atomic<size_t>                push_seq_{0};
+
+  // set before the block threads start, read-only while running
+  bool                                     cover_oldest_ = false;
+  std::chrono::microseconds                latency_target_{0};
+  size_t                                   block_num_ = 0;
+  std::unique_ptr<std::atomic<uint64_t>[]> block_cost_ns_;
+
+  // seqs of the evicted packages the reorder stage has not skipped yet
+  static constexpr std::chrono::milliseconds kEvictedRecheckInterval{1};
+  std::mutex                                 evicted_seq_mutex_;
+  std::set<size_t>                           evicted_seqs_;
+
+  // guards `block_queue_` and `block_recorders_` against `GetMetrics`
+  std::mutex                                          metrics_mutex_;
+  std::vector<std::shared_ptr<PipelineBlockRecorder>> block_recorders_;
+  std::atomic<uint64_t>                               pushed_count_{0};
+  std::atomic<uint64_t>                               output_count_{0};
+  std::atomic<uint64_t>                               dropped_count_{0};
+  std::atomic<uint64_t>                               evicted_count_{0};
+  std::atomic<uint64_t>                               timeout_count_{0};
+  std::shared_ptr<LatencyHistogram>                   end_to_end_latency_;
+
+  // `RUN_TO_COMPLETION` execution, the slots admit at most `worker_num` workers into a block
+  struct _BlockSlots {
+    std::mutex              mutex;
+    std::condition_variable cv;
+    int                     free = 1;
+  };
+  struct _BlockSlotGuard {
+    explicit _BlockSlotGuard(_BlockSlots &slots) : slots_(slots)
+    {
+      std::unique_lock<std::mutex> lck(slots_.mutex);
+      slots_.cv.wait(lck, [this]() { return slots_.free > 0; });
+      --slots_.free;
+    }
+    ~_BlockSlotGuard()
+    {
+      {
+        std::lock_guard<std::mutex> lck(slots_.mutex);
+        ++slots_.free;
+      }
+      slots_.cv.notify_one();
+    }
+    _BlockSlots &slots_;
+  };
+  std::vector<InnerBlock_t>                           rtc_blocks_;
+  std::vector<std::shared_ptr<PipelineBlockRecorder>> rtc_recorders_;
+  std::vector<std::unique_ptr<_BlockSlots>>           rtc_block_slots_;
+
+  // `SHARED_THREAD_POOL` execution, the stage of index `block_num_` is the output stage
+  struct _PoolStage {
+    InnerBlock_t                           block;
+    std::shared_ptr<PipelineBlockRecorder> recorder;
+    int                                    max_active = 1;
+    std::atomic<int>                       active{0};
+  };
+  static constexpr size_t                  kPoolTaskQuota = 16;
+  std::shared_ptr<WorkStealingThreadPool>  thread_pool_;
+  std::vector<std::unique_ptr<_PoolStage>> pool_stages_;
+  size_t                                   max_inflight_ = 0;
+  std::atomic<size_t>                      inflight_{0};
+  std::atomic<bool>                        evicted_since_flush_{false};
+  std::atomic<int>                         running_pool_tasks_{0};
+  std::mutex                               pool_task_mutex_;
+  std::condition_variable                  pool_task_cv_;
+
+  // `DEDICATED_THREADS` execution, runs the helper branches of the fork-join blocks
+  std::shared_ptr<WorkStealingThreadPool> branch_pool_;
+
   std::atomic<bool> pipeline_close_flag_{true};
   std::atomic<bool> pipeline_no_more_input_{true};
   std::atomic<bool> pipeline_initialized_{false};
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "common_utils/latency_histogram.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief Metrics of one pipeline block, accumulated over all its workers since `Init`.
+ *
+ * `take_wait_ns` is the time the workers spent waiting for input (the block is starved),
+ * `push_wait_ns` the time they spent waiting for room in the next queue (the block is
+ * backpressured by the following one).
+ */
+struct PipelineBlockMetrics {
+  std::string              block_name;
+  int                      worker_num      = 1;
+  uint64_t                 processed_count = 0;
+  uint64_t                 failed_count    = 0;
+  uint64_t                 take_wait_ns    = 0;
+  uint64_t                 push_wait_ns    = 0;
+  LatencyHistogramSnapshot latency;
+};
+
+/**
+ * @brief Metrics of the queue feeding block `index`, the last queue feeds the output stage.
+ *
+ */
+struct PipelineQueueMetrics {
+  size_t index           = 0;
+  size_t size            = 0;
+  size_t high_water_mark = 0;
+  size_t capacity        = 0;
+};
+
+/**
+ * @brief Metrics of one pipeline. `evicted_count` counts the packages dropped in favour of newer
+ * ones in `cover_oldest` mode, `timeout_count` the ones which missed their deadline, both are
+ * included in `dropped_count`. `end_to_end_latency` is measured from the capture time to the
+ * output of the delivered packages.
+ *
+ */
+struct PipelineMetricsSnapshot {
+  std::string                       pipeline_name;
+  uint64_t                          pushed_count  = 0;
+  uint64_t                          output_count  = 0;
+  uint64_t                          dropped_count = 0;
+  uint64_t                          evicted_count = 0;
+  uint64_t                          timeout_count = 0;
+  LatencyHistogramSnapshot          end_to_end_latency;
+  std::vector<PipelineBlockMetrics> blocks;
+  std::vector<PipelineQueueMetrics> queues;
+};
+
+/**
+ * @brief Counters updated by the workers of one pipeline block.
+ *
+ */
+struct PipelineBlockRecorder {
+  PipelineBlockRecorder(const std::string &name, int workers) : block_name(name), worker_num(workers)
+  {}
+
+  const std::string block_name;
+  const int         worker_num;
+
+  LatencyHistogram      latency;
+  std::atomic<uint64_t> processed_count{0};
+  std::atomic<uint64_t> failed_count{0};
+  std::atomic<uint64_t> take_wait_ns{0};
+  std::atomic<uint64_t> push_wait_ns{0};
+
+  static uint64_t ElapsedNs(const std::chrono::steady_clock::time_point &start,
+                            const std::chrono::steady_clock::time_point &end) noexcept
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  }
+
+  PipelineBlockMetrics Snapshot() const
+  {
+    PipelineBlockMetrics metrics;
+    metrics.block_name      = block_name;
+    metrics.worker_num      = worker_num;
+    metrics.processed_count = processed_count.load(std::memory_order_relaxed);
+    metrics.failed_count    = failed_count.load(std::memory_order_relaxed);
+    metrics.take_wait_ns    = take_wait_ns.load(std::memory_order_relaxed);
+    metrics.push_wait_ns    = push_wait_ns.load(std::memory_order_relaxed);
+    metrics.latency         = latency.Snapshot();
+    return metrics;
+  }
+};
+
+/**
+ * @brief Render the snapshots in the Prometheus text exposition format. Latencies are exported
+ * as summaries in seconds.
+ *
+ * @param snapshots
+ * @param prefix prepended to every metric name
+ * @return std::string
+ */
+inline std::string PipelineMetricsToPrometheusText(
+    const std::vector<PipelineMetricsSnapshot> &snapshots,
+    const std::string                          &prefix = "easy_deploy_pipeline")
+{
+  std::string ret;
+  char        line[512];
+
+  auto func_header = [&](const std::string &name, const char *type, const char *help) {
+    ret += "# HELP " + prefix + name + " " + help + "\n";
+    ret += "# TYPE " + prefix + name + " " + type + "\n";
+  };
+  auto func_pipeline_value = [&](const std::string &name, const PipelineMetricsSnapshot &s,
+                                 double value) {
+    snprintf(line, sizeof(line), "%s%s{pipeline=\"%s\"} %.9g\n", prefix.c_str(), name.c_str(),
+             s.pipeline_name.c_str(), value);
+    ret += line;
+  };
+  auto func_block_value = [&](const std::string &name, const PipelineMetricsSnapshot &s,
+                              const PipelineBlockMetrics &b, const char *extra_label,
+                              double value) {
+    snprintf(line, sizeof(line), "%s%s{pipeline=\"%s\",block=\"%s\"%s} %.9g\n", prefix.c_str(),
+             name.c_str(), s.pipeline_name.c_str(), b.block_name.c_str(), extra_label, value);
+    ret += line;
+  };
+  auto func_queue_value = [&](const std::string &name, const PipelineMetricsSnapshot &s,
+                              const PipelineQueueMetrics &q, double value) {
+    snprintf(line, sizeof(line), "%s%s{pipeline=\"%s\",queue=\"%zu\"} %.9g\n", prefix.c_str(),
+             name.c_str(), s.pipeline_name.c_str(), q.index, value);
+    ret += line;
+  };
+
+  using PipelineGetter_t = std::function<double(const PipelineMetricsSnapshot &)>;
+  using BlockGetter_t    = std::function<double(const PipelineBlockMetrics &)>;
+  using QueueGetter_t    = std::function<double(const PipelineQueueMetrics &)>;
+
+  auto func_pipeline_metric = [&](const std::string &name, const char *type, const char *help,
+                                  const PipelineGetter_t &getter) {
+    func_header(name, type, help);
+    for (const auto &s : snapshots)
+    {
+      func_pipeline_value(name, s, getter(s));
+    }
+  };
+  auto func_block_metric = [&](const std::string &name, const char *type, const char *help,
+                               const BlockGetter_t &getter) {
+    func_header(name, type, help);
+    for (const auto &s : snapshots)
+    {
+      for (const auto &b : s.blocks)
+      {
+        func_block_value(name, s, b, "", getter(b));
+      }
+    }
+  };
+  auto func_queue_metric = [&](const std::string &name, const char *type, const char *help,
+                               const QueueGetter_t &getter) {
+    func_header(name, type, help);
+    for (const auto &s : snapshots)
+    {
+      for (const auto &q : s.queues)
+      {
+        func_queue_value(name, s, q, getter(q));
+      }
+    }
+  };
+
+  func_pipeline_metric("_packages_pushed_total", "counter", "Packages pushed into the pipeline.",
+                       [](const PipelineMetricsSnapshot &s) { return s.pushed_count; });
+  func_pipeline_metric("_packages_output_total", "counter", "Packages delivered to the callback.",
+                       [](const PipelineMetricsSnapshot &s) { return s.output_count; });
+  func_pipeline_metric("_packages_dropped_total", "counter",
+                       "Packages failed by a block or never delivered.",
+                       [](const PipelineMetricsSnapshot &s) { return s.dropped_count; });
+  func_pipeline_metric("_packages_evicted_total", "counter",
+                       "Packages dropped from a full queue in favour of newer ones.",
+                       [](const PipelineMetricsSnapshot &s) { return s.evicted_count; });
+  func_pipeline_metric("_packages_timeout_total", "counter",
+                       "Packages skipped because they could not meet their deadline.",
+                       [](const PipelineMetricsSnapshot &s) { return s.timeout_count; });
+
+  func_header("_end_to_end_latency_seconds", "summary",
+              "Time from capture to output of the delivered packages.");
+  for (const auto &s : snapshots)
+  {
+    for (const double q : {0.5, 0.9, 0.99, 0.999})
+    {
+      snprintf(line, sizeof(line),
+               "%s_end_to_end_latency_seconds{pipeline=\"%s\",quantile=\"%g\"} %.9g\n",
+               prefix.c_str(), s.pipeline_name.c_str(), q,
+               s.end_to_end_latency.PercentileNs(q) * 1e-9);
+      ret += line;
+    }
+    func_pipeline_value("_end_to_end_latency_seconds_sum", s, s.end_to_end_latency.sum_ns * 1e-9);
+    func_pipeline_value("_end_to_end_latency_seconds_count", s, s.end_to_end_latency.count);
+  }
+
+  func_header("_block_latency_seconds", "summary", "Execution time of the block function.");
+  for (const auto &s : snapshots)
+  {
+    for (const auto &b : s.blocks)
+    {
+      for (const double q : {0.5, 0.9, 0.99, 0.999})
+      {
+        char quantile_label[32];
+        snprintf(quantile_label, sizeof(quantile_label), ",quantile=\"%g\"", q);
+        func_block_value("_block_latency_seconds", s, b, quantile_label,
+                         b.latency.PercentileNs(q) * 1e-9);
+      }
+      func_block_value("_block_latency_seconds_sum", s, b, "", b.latency.sum_ns * 1e-9);
+      func_block_value("_block_latency_seconds_count", s, b, "", b.latency.count);
+    }
+  }
+
+  func_block_metric("_block_processed_total", "counter", "Packages processed by the block.",
+                    [](const PipelineBlockMetrics &b) { return b.processed_count; });
+  func_block_metric("_block_failed_total", "counter", "Packages the block function failed on.",
+                    [](const PipelineBlockMetrics &b) { return b.failed_count; });
+  func_block_metric("_block_take_wait_seconds_total", "counter",
+                    "Time the block workers waited for input (starved).",
+                    [](const PipelineBlockMetrics &b) { return b.take_wait_ns * 1e-9; });
+  func_block_metric("_block_push_wait_seconds_total", "counter",
+                    "Time the block workers waited for the next queue (backpressured).",
+                    [](const PipelineBlockMetrics &b) { return b.push_wait_ns * 1e-9; });
+  func_block_metric("_block_workers", "gauge", "Worker threads of the block.",
+                    [](const PipelineBlockMetrics &b) { return b.worker_num; });
+
+  func_queue_metric("_queue_size", "gauge", "Current size of the queue.",
+                    [](const PipelineQueueMetrics &q) { return q.size; });
+  func_queue_metric("_queue_high_water_mark", "gauge", "Largest size the queue has reached.",
+                    [](const PipelineQueueMetrics &q) { return q.high_water_mark; });
+  func_queue_metric("_queue_capacity", "gauge", "Capacity of the queue.",
+                    [](const PipelineQueueMetrics &q) { return q.capacity; });
+
+  return ret;
+}
+
+/**
+ * @brief Write the snapshots in Prometheus text format to `file_path`, e.g. for the textfile
+ * collector of node_exporter. The file is replaced atomically.
+ *
+ * @return true
+ * @return false if the file could not be written.
+ */
+inline bool ExportPipelineMetrics(const std::vector<PipelineMetricsSnapshot> &snapshots,
+                                  const std::string                          &file_path,
+                                  const std::string &prefix = "easy_deploy_pipeline")
+{
+  const std::string temp_path = file_path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::trunc);
+    if (!file.is_open())
+    {
+      return false;
+    }
+    file << PipelineMetricsToPrometheusText(snapshots, prefix);
+    if (!file.good())
+    {
+      return false;
+    }
+  }
+  return std::rename(temp_path.c_str(), file_path.c_str()) == 0;
+}
+
+} // namespace easy_deploy
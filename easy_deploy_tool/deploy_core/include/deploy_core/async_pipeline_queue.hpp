@@ -0,0 +1,202 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include "common_utils/block_queue.hpp"
+#include "common_utils/spsc_queue.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief The queue implementation used to connect pipeline blocks.
+ *
+ * `BLOCK_QUEUE` : mutex/condition-variable queue, safe with any number of producers/consumers.
+ * `SPSC_QUEUE`  : lock-free single-producer/single-consumer ring queue. Only used on links which
+ *                 have exactly one producer thread and one consumer thread, the other links fall
+ *                 back to `BLOCK_QUEUE`.
+ */
+enum PipelineQueueType { BLOCK_QUEUE = 0, SPSC_QUEUE = 1 };
+
+/**
+ * @brief How the blocks of a pipeline are executed.
+ *
+ * `DEDICATED_THREADS`  : every block worker and the output stage run on a thread of their own.
+ *                        The branches of a fork-join block from `AsyncPipelineGraph` run on
+ *                        helper threads owned by the pipeline.
+ * `SHARED_THREAD_POOL` : the blocks are scheduled as tasks on the process-wide
+ *                        `WorkStealingThreadPool`, shared by all the pipelines using it. A block
+ *                        still runs on at most `worker_num` tasks at once and the output order is
+ *                        kept. Producers block on the bounded input queue as before, and at most
+ *                        `queue_max_size` packages are between the first block and the output, so
+ *                        the pool threads never wait on a full queue. Blocking block functions
+ *                        occupy a pool thread while they wait. Batching blocks take what is
+ *                        queued without waiting for the batch timeout.
+ * `RUN_TO_COMPLETION`  : each of `run_to_completion_workers` threads takes a package and runs all
+ *                        the blocks on it back to back, there is no hand-off between the blocks.
+ *                        A block still runs on at most `worker_num` threads at once, so blocks
+ *                        which are not thread-safe stay safe. The output order is kept. Batching
+ *                        blocks get one package per call.
+ */
+enum PipelineExecution { DEDICATED_THREADS = 0, SHARED_THREAD_POOL = 1, RUN_TO_COMPLETION = 2 };
+
+/**
+ * @brief Options of a pipeline instance, passed to `InitPipeline`.
+ *
+ */
+struct PipelineOptions {
+  size_t            queue_max_size = 100;
+  PipelineQueueType queue_type     = PipelineQueueType::BLOCK_QUEUE;
+  // overrides the worker number of the blocks with the given names, e.g. "[StereoPostProcess]"
+  std::unordered_map<std::string, int> block_worker_num;
+  // record per-block latency, wait times and queue high-water marks, see `GetPipelineMetrics`
+  bool enable_metrics = true;
+  // "latest frame wins" streaming mode : a full queue drops its oldest package instead of
+  // blocking the producer, the dropped package reports `PIPELINE_DROPPED`. All the links use
+  // `BLOCK_QUEUE` then.
+  bool cover_oldest = false;
+  // end-to-end latency target, 0 for none. Packages without an own deadline get their capture
+  // time plus the target as deadline, the blocks are skipped for packages which can not make it
+  // any more and they report `PIPELINE_TIMEOUT`
+  std::chrono::microseconds latency_target{0};
+  // remove the trivial blocks and merge adjacent fusable ones, see `AsyncPipelineBlock::SetTrivial`
+  bool optimize_blocks = true;
+  // run the blocks on their own threads, on the process-wide thread pool or run-to-completion
+  PipelineExecution execution = PipelineExecution::DEDICATED_THREADS;
+  // `RUN_TO_COMPLETION` only : the number of workers, 0 for the sum of the block worker numbers,
+  // and whether to pin worker `i` to core `i`
+  int  run_to_completion_workers = 0;
+  bool pin_threads               = false;
+};
+
+/**
+ * @brief The queue interface between two pipeline blocks.
+ *
+ * @tparam T
+ */
+template <typename T>
+class IPipelineQueue {
+public:
+  virtual bool BlockPush(const T &obj) noexcept = 0;
+
+  /**
+   * @brief Push without blocking, the oldest element is moved into `evicted` if the queue is
+   * full. Only supported by `BLOCK_QUEUE`, the other queues block instead.
+   */
+  virtual bool CoverPush(const T &obj, std::optional<T> &evicted) noexcept = 0;
+
+  virtual std::optional<T> Take() noexcept = 0;
+
+  /**
+   * @brief Take without blocking. Safe from any thread for `BLOCK_QUEUE` only.
+   */
+  virtual std::optional<T> TryTake() noexcept = 0;
+
+  virtual std::optional<T> TakeUntil(std::chrono::steady_clock::time_point deadline) noexcept = 0;
+
+  virtual void SetNoMoreInput() noexcept = 0;
+
+  /**
+   * @brief Disable the queue and drop the queued elements. Threads blocked on the queue are woken
+   * up, the elements are dropped before the call returns.
+   */
+  virtual void DisableAndClear() noexcept = 0;
+
+  virtual size_t Size() noexcept = 0;
+
+  virtual size_t GetMaxSize() noexcept = 0;
+
+  virtual size_t GetHighWaterMark() noexcept = 0;
+
+  virtual ~IPipelineQueue() = default;
+};
+
+template <typename T, template <typename> class QueueImpl>
+class PipelineQueueAdaptor : public IPipelineQueue<T> {
+public:
+  explicit PipelineQueueAdaptor(size_t max_size) : queue_(max_size)
+  {}
+
+  bool BlockPush(const T &obj) noexcept override
+  {
+    return queue_.BlockPush(obj);
+  }
+
+  bool CoverPush(const T &obj, std::optional<T> &evicted) noexcept override
+  {
+    if constexpr (std::is_same<QueueImpl<T>, BlockQueue<T>>::value)
+    {
+      return queue_.CoverPush(obj, evicted);
+    } else
+    {
+      // evicting would make the producer a second consumer
+      return queue_.BlockPush(obj);
+    }
+  }
+
+  std::optional<T> Take() noexcept override
+  {
+    return queue_.Take();
+  }
+
+  std::optional<T> TryTake() noexcept override
+  {
+    return queue_.TryTake();
+  }
+
+  std::optional<T> TakeUntil(std::chrono::steady_clock::time_point deadline) noexcept override
+  {
+    return queue_.TakeUntil(deadline);
+  }
+
+  void SetNoMoreInput() noexcept override
+  {
+    queue_.SetNoMoreInput();
+  }
+
+  void DisableAndClear() noexcept override
+  {
+    queue_.DisableAndClear();
+  }
+
+  size_t Size() noexcept override
+  {
+    return queue_.Size();
+  }
+
+  size_t GetMaxSize() noexcept override
+  {
+    return queue_.GetMaxSize();
+  }
+
+  size_t GetHighWaterMark() noexcept override
+  {
+    return queue_.GetHighWaterMark();
+  }
+
+private:
+  QueueImpl<T> queue_;
+};
+
+/**
+ * @brief Create a queue for one pipeline link. `single_producer_consumer` tells if the link has
+ * exactly one producer thread and one consumer thread.
+ *
+ */
+template <typename T>
+std::shared_ptr<IPipelineQueue<T>> CreatePipelineQueue(PipelineQueueType type,
+                                                       size_t            max_size,
+                                                       bool              single_producer_consumer)
+{
+  if (type == PipelineQueueType::SPSC_QUEUE && single_producer_consumer)
+  {
+    return std::make_shared<PipelineQueueAdaptor<T, SpscQueue>>(max_size);
+  }
+  return std::make_shared<PipelineQueueAdaptor<T, BlockQueue>>(max_size);
+}
+
+} // namespace easy_deploy
@@ -142,6 +142,27 @@ public:
                                                              bool           isRGB = false,
                                                              bool cover_oldest    = false) noexcept;
 
+  /**
+   * @brief Run the detection processing in asynchronous mode, `on_done` is called with the
+   * results and their status on the pipeline output thread, or through `executor` if provided.
+   *
+   * @param input_image input image in cv::Mat format.
+   * @param conf_thresh confidence threshold
+   * @param on_done completion callback, called exactly once if this returns true.
+   * @param isRGB if the input is rgb format. Will flip channels if `isRGB` == false. default=false.
+   * @param cover_oldest whether cover the oldest package if the pipeline queue is full.
+   * default=false.
+   * @param executor runs `on_done` instead of the output thread. default=nullptr.
+   * @return true
+   * @return false if the request could not be pushed, `on_done` is not called then.
+   */
+  bool DetectAsync(const cv::Mat                        &input_image,
+                   float                                 conf_thresh,
+                   PipelineCallback<std::vector<BBox2D>> on_done,
+                   bool                                  isRGB        = false,
+                   bool                                  cover_oldest = false,
+                   std::shared_ptr<IPipelineExecutor>    executor     = nullptr) noexcept;
+
 protected:
   // forbidden the access from outside to `BaseAsyncPipeline::PushPipeline`
   using BaseAsyncPipeline::PushPipeline;
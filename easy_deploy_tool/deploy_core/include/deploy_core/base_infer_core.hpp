@@ -7,12 +7,38 @@
 
 #include "common_utils/block_queue.hpp"
 #include "common_utils/log.hpp"
+#include "common_utils/object_pool.hpp"
 #include "deploy_core/async_pipeline.hpp"
 
 namespace easy_deploy {
 
 enum InferCoreType { ONNXRUNTIME, TENSORRT, RKNN, OM, NOT_PROVIDED };
 
+/**
+ * @brief A model input size an inference core with a dynamic height and width model runs at.
+ *
+ */
+struct ShapeBucket {
+  int height = 0;
+  int width  = 0;
+};
+
+/**
+ * @brief Pick the shape bucket for an `image_height x image_width` image. The image is scaled to
+ * fit the largest bucket, the smallest bucket which holds the scaled image is returned, so images
+ * which do not have the aspect ratio of the largest bucket carry less padding.
+ *
+ * @param buckets
+ * @param image_height
+ * @param image_width
+ * @param fallback returned if `buckets` is empty
+ * @return ShapeBucket
+ */
+ShapeBucket SelectShapeBucket(const std::vector<ShapeBucket> &buckets,
+                              int                             image_height,
+                              int                             image_width,
+                              const ShapeBucket              &fallback);
+
 /**
  * @brief `IRotInferCore` is abstract interface class which defines all pure virtual functions
  * that the derived class should implement, e.g., `PreProcess`, `Inference` and `PostProcess`.
@@ -51,6 +77,32 @@ public:
     return "";
   }
 
+  /**
+   * @brief The input sizes the core runs at if its model has a dynamic height and width. Empty
+   * for fixed-shape models.
+   *
+   * @return std::vector<ShapeBucket>
+   */
+  virtual std::vector<ShapeBucket> GetShapeBuckets()
+  {
+    return {};
+  }
+
+  /**
+   * @brief Set the shapes of the blobs in `buffer` to run at `bucket`, one of `GetShapeBuckets`.
+   * The buffers are allocated for the largest bucket and return to it when they are recycled, so
+   * call this for every package before its preprocessing.
+   *
+   * @param buffer
+   * @param bucket
+   * @return true
+   * @return false if the core has no shape buckets or `bucket` is not one of them.
+   */
+  virtual bool ApplyShapeBucket(BlobsTensor * /*buffer*/, const ShapeBucket & /*bucket*/)
+  {
+    return false;
+  }
+
 protected:
   virtual ~IRotInferCore() = default;
 
@@ -84,6 +136,35 @@ protected:
    * @return false
    */
   virtual bool PostProcess(std::shared_ptr<IPipelinePackage> buffer) = 0;
+
+  /**
+   * @brief `Inference` stage on multiple packages at once, used when dynamic batching is enabled.
+   * The default implementation calls `Inference` on each package. Return false if the whole batch
+   * went wrong, the pipeline will drop every package of it.
+   *
+   * @param buffers common "pipeline" package ptrs.
+   * @param results one result per package, preset to true. The pipeline only drops the packages
+   * whose result is set to false.
+   * @return true
+   * @return false
+   */
+  virtual bool BatchInference(const std::vector<std::shared_ptr<IPipelinePackage>> &buffers,
+                              std::vector<bool>                                   &results)
+  {
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+      try
+      {
+        results[i] = Inference(buffers[i]);
+      } catch (const std::exception &e)
+      {
+        LOG_ERROR("[BaseInferCore] BatchInference got exception on package %ld : %s", i,
+                  e.what());
+        results[i] = false;
+      }
+    }
+    return true;
+  }
 };
 
 /**
@@ -97,7 +178,9 @@ protected:
 class MemBufferPool {
 public:
   MemBufferPool(IRotInferCore *infer_core, const size_t pool_size)
-      : pool_size_(pool_size), dynamic_pool_(pool_size)
+      : pool_size_(pool_size),
+        dynamic_pool_(pool_size),
+        ctrl_pool_(std::make_shared<RecyclingBlockPool>())
   {
     for (size_t i = 0; i < pool_size; ++i)
     {
@@ -116,7 +199,10 @@ public:
     };
 
     auto buf = block ? dynamic_pool_.Take() : dynamic_pool_.TryTake();
-    return buf.has_value() ? std::shared_ptr<BlobsTensor>(buf.value(), func_dealloc) : nullptr;
+    // the control block is recycled as well
+    return buf.has_value() ? std::shared_ptr<BlobsTensor>(buf.value(), func_dealloc,
+                                                          PoolAllocator<BlobsTensor>(ctrl_pool_))
+                           : nullptr;
   }
 
   void Release()
@@ -133,6 +219,11 @@ public:
     return dynamic_pool_.Size();
   }
 
+  size_t PoolSize() const noexcept
+  {
+    return pool_size_;
+  }
+
   ~MemBufferPool()
   {
     Release();
@@ -142,6 +233,7 @@ private:
   const size_t                                     pool_size_;
   BlockQueue<BlobsTensor *>                        dynamic_pool_;
   std::unordered_set<std::unique_ptr<BlobsTensor>> static_pool_;
+  std::shared_ptr<RecyclingBlockPool>              ctrl_pool_;
 };
 
 /**
@@ -199,6 +291,20 @@ public:
    */
   std::shared_ptr<BlobsTensor> GetBuffer(bool block);
 
+  /**
+   * @brief Enable micro-batching in the async pipeline. The inference stage collects up to
+   * `max_batch_size` packages, waiting at most `timeout` after the first one arrived, and runs
+   * them with one `BatchInference` call. Inference cores which can not run a real batch fall back
+   * to one `Inference` call per package.
+   *
+   * @warning Call this before the inference core is used to construct an algorithm, since the
+   * algorithm copies the pipeline context of the inference core in its construct function.
+   *
+   * @param max_batch_size
+   * @param timeout
+   */
+  void EnableDynamicBatching(size_t max_batch_size, std::chrono::microseconds timeout);
+
   /**
    * @brief Release the sources in base class.
    *
@@ -224,8 +330,45 @@ protected:
    */
   void Init(size_t mem_buf_size = 5);
 
+  /**
+   * @brief Tell the async pipeline that `PreProcess` and/or `PostProcess` of the derived class
+   * only `return true`. Their blocks are removed when the pipeline is initialized, which saves a
+   * thread and a queue hand-off per stage. The sync inference still calls them.
+   *
+   * @warning Call this in the derived class construct function, for the same reason as
+   * `EnableDynamicBatching`.
+   *
+   * @param preprocess_trivial
+   * @param postprocess_trivial
+   */
+  void SetTrivialStages(bool preprocess_trivial, bool postprocess_trivial);
+
+  /**
+   * @brief Run the `Inference` stage of the async pipeline on `worker_num` threads. Only for
+   * derived classes whose `Inference` is thread-safe and scales, e.g. over several replicas.
+   *
+   * @warning Call this in the derived class construct function, for the same reason as
+   * `EnableDynamicBatching`.
+   *
+   * @param worker_num
+   */
+  void SetInferenceWorkerNum(int worker_num);
+
+private:
+  // runs the stages of the replicas and shares their buffers
+  friend class InferCorePool;
+
+  void ConfigInferCorePipeline();
+
 private:
   std::unique_ptr<MemBufferPool> mem_buf_pool_{nullptr};
+
+  size_t                    max_batch_size_ = 1;
+  std::chrono::microseconds batch_timeout_{0};
+
+  bool preprocess_trivial_   = false;
+  bool postprocess_trivial_  = false;
+  int  inference_worker_num_ = 1;
 };
 
 /**
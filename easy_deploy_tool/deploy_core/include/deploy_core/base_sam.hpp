@@ -230,10 +230,64 @@ public:
                                                        bool                       isRGB = false,
                                                        bool cover_oldest                = false);
 
+  /**
+   * @brief Generate the mask with points as prompts in async mode, `on_done` is called with the
+   * mask and its status on the pipeline output thread, or through `executor` if provided.
+   *
+   * @param image input image
+   * @param points points coords
+   * @param labels points labels, 0 - background; 1 - foreground
+   * @param on_done completion callback, called exactly once if this returns true.
+   * @param isRGB if the input image is RGB format. default=false
+   * @param cover_oldest whether cover the oldest package if the pipeline queue is full.
+   * default=false.
+   * @param executor runs `on_done` instead of the output thread. default=nullptr.
+   * @return false if the request could not be pushed, `on_done` is not called then.
+   */
+  bool GenerateMaskAsync(const cv::Mat                          &image,
+                         const std::vector<std::pair<int, int>> &points,
+                         const std::vector<int>                 &labels,
+                         PipelineCallback<cv::Mat>               on_done,
+                         bool                                    isRGB        = false,
+                         bool                                    cover_oldest = false,
+                         std::shared_ptr<IPipelineExecutor>      executor     = nullptr);
+
+  /**
+   * @brief Generate the mask with boxes as prompts in async mode, `on_done` is called with the
+   * mask and its status on the pipeline output thread, or through `executor` if provided.
+   *
+   * @param image input image
+   * @param boxes boxes coords
+   * @param on_done completion callback, called exactly once if this returns true.
+   * @param isRGB if the input image is RGB format. default=false
+   * @param cover_oldest whether cover the oldest package if the pipeline queue is full.
+   * default=false.
+   * @param executor runs `on_done` instead of the output thread. default=nullptr.
+   * @return false if the request could not be pushed, `on_done` is not called then.
+   */
+  bool GenerateMaskAsync(const cv::Mat                     &image,
+                         const std::vector<BBox2D>         &boxes,
+                         PipelineCallback<cv::Mat>          on_done,
+                         bool                               isRGB        = false,
+                         bool                               cover_oldest = false,
+                         std::shared_ptr<IPipelineExecutor> executor     = nullptr);
+
 private:
   // forbidden the access from outside to `BaseAsyncPipeline::PushPipeline`
   using BaseAsyncPipeline::PushPipeline;
 
+  // check the arguments and build the package of an asynchronous request, nullptr if invalid
+  ParsingType CreatePointsPackage(const cv::Mat                          &image,
+                                  const std::vector<std::pair<int, int>> &points,
+                                  const std::vector<int>                 &labels,
+                                  bool                                    isRGB,
+                                  bool                                    cover_oldest);
+
+  ParsingType CreateBoxesPackage(const cv::Mat             &image,
+                                 const std::vector<BBox2D> &boxes,
+                                 bool                       isRGB,
+                                 bool                       cover_oldest);
+
   void ConfigureBoxPipeline();
 
   void ConfigurePointPipeline();
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "deploy_core/base_infer_core.hpp"
+#include "deploy_core/debug_tap.hpp"
+#include "deploy_core/mat_buffer_pool.hpp"
+#include "deploy_core/stereo_postprocess.hpp"
+#include "common_utils/object_pool.hpp"
 #include "common_utils/pipeline_image.hpp"
 
 //#include <opencv2/opencv.hpp>
@@ -19,6 +23,13 @@ struct StereoPipelinePackage : public IPipelinePackage {
   float conf_thresh;
   // record the transform factor during image preprocess
   float transform_scale;
+  // the area of the model input which holds the resized image, recorded during image preprocess
+  cv::Rect valid_roi;
+  // the model input size of this frame, differs per frame if the inference core has shape buckets
+  int input_height = 0;
+  int input_width  = 0;
+  // the debug tap sampling decision of this frame
+  DebugTapFrame debug_frame;
 
   //
   cv::Mat disp;
@@ -58,23 +69,124 @@ protected:
   BaseStereoMatchingModel(const std::shared_ptr<BaseInferCore> &inference_core);
 
 public:
+  /**
+   * @brief Compute the disparity of the original image size. If `disp_output` is already a
+   * CV_32FC1 Mat of that size it is written in place, otherwise it is replaced by a Mat leased
+   * from the model's disparity buffer pool.
+   */
   bool ComputeDisp(const cv::Mat &left_image, const cv::Mat &right_image, cv::Mat &disp_output);
 
+  /**
+   * @brief The returned disparity is leased from the model's disparity buffer pool, the buffer
+   * is recycled once the caller releases the Mat.
+   *
+   * @note For live streams, initialize the pipeline with `PipelineOptions::cover_oldest`. The
+   * async calls then never wait behind stale frames : the oldest frames which have not been
+   * processed yet are dropped, their buffers are reused and their results report
+   * `PIPELINE_DROPPED` (a `PipelineDropped` exception for the future-based calls).
+   */
   [[nodiscard]] std::future<cv::Mat> ComputeDispAsync(const cv::Mat &left_image,
                                                       const cv::Mat &right_image);
 
+  /**
+   * @brief Write the disparity into `disp_output`, a CV_32FC1 Mat of the original image size
+   * allocated by the caller. The returned Mat shares its buffer. `disp_output` must not be
+   * touched until the future is ready.
+   *
+   * @return std::future<cv::Mat> Invalid if `disp_output` does not match.
+   */
+  [[nodiscard]] std::future<cv::Mat> ComputeDispAsync(const cv::Mat &left_image,
+                                                      const cv::Mat &right_image,
+                                                      cv::Mat       &disp_output);
+
+  /**
+   * @brief Call `on_done` with the disparity and its status once it is computed, on the pipeline
+   * output thread or through `executor`. Avoids a future per frame and a thread waiting on it.
+   *
+   * @return false if the inputs are invalid or the pipeline is not initialized, `on_done` is not
+   * called then.
+   */
+  bool ComputeDispAsync(const cv::Mat                     &left_image,
+                        const cv::Mat                     &right_image,
+                        PipelineCallback<cv::Mat>          on_done,
+                        std::shared_ptr<IPipelineExecutor> executor = nullptr);
+
+  /**
+   * @brief Compute the disparity of a high-resolution pair at full resolution. The rectified pair
+   * is cut into overlapping tiles, see `StereoTilingOptions`, each tile runs through the model
+   * like a frame of its own and the tile disparities are blended back with feathered seams.
+   * `disp_output` is handled as in `ComputeDisp`.
+   *
+   * If the pipeline is initialized, the tiles of the pair are pushed together, so they run
+   * concurrently on the inference workers, e.g. the replicas of an inference core pool, and fill
+   * the batches of dynamic batching. The pipeline should not be in `cover_oldest` mode then, which
+   * would drop tiles. Otherwise the tiles are inferred one after another.
+   *
+   * The crops and disparities of all the tiles are alive during the call, about 1.3 MB per
+   * 256x512 tile of a BGR pair, plus a full-resolution weight map. At most
+   * `kMaxCachedTileBuffers` of these buffers stay cached for the next call.
+   *
+   * @return false if the inputs are invalid or a tile failed. Throws if `options` is invalid.
+   */
+  bool ComputeDispTiled(const cv::Mat             &left_image,
+                        const cv::Mat             &right_image,
+                        cv::Mat                   &disp_output,
+                        const StereoTilingOptions &options = {});
+
+  /**
+   * @brief Set how many released disparity buffers the model keeps for reuse. Should cover the
+   * number of results the caller holds at the same time plus the packages in flight.
+   */
+  void SetDispBufferPoolSize(size_t max_cached_buffers);
+
 protected:
   virtual bool PreProcess(std::shared_ptr<IPipelinePackage> pipeline_unit) = 0;
 
   virtual bool PostProcess(std::shared_ptr<IPipelinePackage> pipeline_unit) = 0;
 
+  /**
+   * @brief Set `input_height` and `input_width` of the package to the model input size of the
+   * frame. That is the smallest shape bucket of the inference core which holds the image, applied
+   * to the blobs buffer of the package, or `default_height x default_width` for fixed-shape cores.
+   * Call it at the beginning of `PreProcess`.
+   *
+   * @return false if the bucket could not be applied.
+   */
+  bool SelectInputShape(StereoPipelinePackage &package, int default_height, int default_width);
+
 private:
   using BaseAsyncPipeline::PushPipeline;
 
+  std::shared_ptr<StereoPipelinePackage> CreatePackage(const cv::Mat               &left_image,
+                                                       const cv::Mat               &right_image,
+                                                       std::shared_ptr<BlobsTensor> infer_buffer);
+
+  // drops stale frames instead of waiting for a buffer in `cover_oldest` mode
+  std::shared_ptr<BlobsTensor> AcquireAsyncInferBuffer();
+
+  // runs the tiles through the model, `tile_disps` gets their disparities in the same order
+  bool InferStereoTiles(const cv::Mat                 &left_image,
+                        const cv::Mat                 &right_image,
+                        const std::vector<StereoTile> &tiles,
+                        std::vector<cv::Mat>          &tile_disps);
+
 protected:
   std::shared_ptr<BaseInferCore> inference_core_;
 
+  // recycles the full-resolution disparity outputs
+  std::shared_ptr<MatBufferPool> disp_buffer_pool_;
+  // recycles the image crops and disparities of the tiles
+  std::shared_ptr<MatBufferPool> tile_buffer_pool_;
+  // recycles the memory of the packages and their image wrappers
+  std::shared_ptr<RecyclingBlockPool> package_pool_;
+  // the shape buckets of the inference core, empty for fixed shapes
+  std::vector<ShapeBucket> shape_buckets_;
+
   static const std::string stereo_pipeline_name_;
+
+  // caps the tile buffers kept between `ComputeDispTiled` calls, the tile count of a 4K pair
+  // would otherwise keep a few hundred buffers alive
+  static constexpr size_t kMaxCachedTileBuffers = 48;
 };
 
 struct MonoStereoPipelinePackage : public IPipelinePackage {
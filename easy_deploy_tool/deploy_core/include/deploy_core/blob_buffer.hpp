@@ -81,6 +81,8 @@ public:
     }
   }
 
+  virtual ~BlobsTensor() = default;
+
 private:
   std::unordered_map<std::string, std::unique_ptr<ITensor>> tensor_map_;
 };
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <opencv2/core/core.hpp>
+
+namespace easy_deploy {
+
+struct DebugTapOptions {
+  // directory the captures are written to, created if missing
+  std::string output_dir = "debug_tap";
+  // capture one frame out of `sample_interval`, 0 captures only the triggered frames
+  uint64_t sample_interval = 1000;
+  // captures waiting for the writer thread, the oldest ones are dropped beyond it
+  size_t ring_capacity = 32;
+};
+
+/**
+ * @brief The sampling decision of one frame, taken once when the frame enters the model so all
+ * the stages of a sampled frame are captured together.
+ *
+ */
+struct DebugTapFrame {
+  uint64_t id      = 0;
+  bool     capture = false;
+};
+
+/**
+ * @brief A process-wide tap to capture intermediate images and tensors for field diagnostics.
+ *
+ * Stages call `DebugTap::Publish(name, mat)` while a `DebugTapFrameScope` of the frame they
+ * process is active. Only the sampled frames are copied into a bounded ring, the copies are
+ * encoded and written to `<output_dir>/<frame_id>_<name>.<ext>` by a background thread. 8-bit
+ * and 16-bit images are written as png, other depths as tiff.
+ *
+ * While the tap is disabled (the default), `NewFrame` and `Publish` cost one relaxed atomic load
+ * and one thread-local read respectively.
+ */
+class DebugTap {
+public:
+  static DebugTap &Instance();
+
+  /**
+   * @brief Start capturing with `options`, restart the writer if the tap is already enabled.
+   *
+   * @return false if `output_dir` could not be created.
+   */
+  bool Enable(const DebugTapOptions &options);
+
+  /**
+   * @brief Stop capturing, the captures already in the ring are still written.
+   */
+  void Disable();
+
+  bool IsEnabled() const noexcept
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Capture the next `frame_num` frames regardless of the sample interval.
+   */
+  void Trigger(uint64_t frame_num = 1) noexcept
+  {
+    triggered_frames_.fetch_add(frame_num, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Assign an id to a new frame and decide whether it is captured.
+   */
+  DebugTapFrame NewFrame() noexcept
+  {
+    if (!IsEnabled())
+    {
+      return {};
+    }
+    return SampleFrame();
+  }
+
+  /**
+   * @brief The frame of the active `DebugTapFrameScope` on the calling thread.
+   */
+  static const DebugTapFrame &CurrentFrame() noexcept
+  {
+    return current_frame_;
+  }
+
+  /**
+   * @brief Copy `mat` into the ring if the current frame is sampled. `mat` may wrap a tensor
+   * buffer, it is not referenced after the call.
+   */
+  static void Publish(const char *name, const cv::Mat &mat)
+  {
+    if (current_frame_.capture)
+    {
+      Instance().Enqueue(current_frame_.id, name, mat);
+    }
+  }
+
+  /**
+   * @brief Same as above, the capture is named `<scope>_<name>`, e.g. to tell the two views of a
+   * stereo pair apart.
+   */
+  static void Publish(const char *scope, const char *name, const cv::Mat &mat)
+  {
+    if (current_frame_.capture)
+    {
+      Instance().Enqueue(current_frame_.id, std::string(scope) + "_" + name, mat);
+    }
+  }
+
+  /**
+   * @brief Captures dropped because the ring was full.
+   */
+  uint64_t GetDroppedCount() const noexcept
+  {
+    return dropped_count_.load(std::memory_order_relaxed);
+  }
+
+  DebugTap(const DebugTap &)            = delete;
+  DebugTap &operator=(const DebugTap &) = delete;
+
+private:
+  friend class DebugTapFrameScope;
+
+  struct Capture {
+    uint64_t    frame_id;
+    std::string name;
+    cv::Mat     mat;
+  };
+
+  DebugTap() = default;
+
+  ~DebugTap();
+
+  DebugTapFrame SampleFrame() noexcept;
+
+  void Enqueue(uint64_t frame_id, std::string name, const cv::Mat &mat);
+
+  void WriterEntry(const std::string &output_dir);
+
+  void StopWriter();
+
+private:
+  static thread_local DebugTapFrame current_frame_;
+
+  std::atomic<bool>     enabled_{false};
+  std::atomic<uint64_t> sample_interval_{0};
+  std::atomic<uint64_t> frame_counter_{0};
+  std::atomic<uint64_t> triggered_frames_{0};
+  std::atomic<uint64_t> dropped_count_{0};
+
+  // serializes `Enable` and `Disable`
+  std::mutex control_mtx_;
+
+  // guards `ring_capacity_`, `ring_` and `writer_running_`, `writer_` is only touched by the
+  // control thread
+  std::mutex              mtx_;
+  std::condition_variable cv_;
+  size_t                  ring_capacity_{0};
+  std::deque<Capture>     ring_;
+  bool                    writer_running_{false};
+  std::thread             writer_;
+};
+
+/**
+ * @brief Make `frame` the current frame of the calling thread during the scope.
+ *
+ */
+class DebugTapFrameScope {
+public:
+  explicit DebugTapFrameScope(const DebugTapFrame &frame) noexcept
+      : prev_frame_(DebugTap::current_frame_)
+  {
+    DebugTap::current_frame_ = frame;
+  }
+
+  ~DebugTapFrameScope()
+  {
+    DebugTap::current_frame_ = prev_frame_;
+  }
+
+  DebugTapFrameScope(const DebugTapFrameScope &)            = delete;
+  DebugTapFrameScope &operator=(const DebugTapFrameScope &) = delete;
+
+private:
+  const DebugTapFrame prev_frame_;
+};
+
+} // namespace easy_deploy
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "deploy_core/base_infer_core.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief Create an inference core which owns `replica_num` inner cores built by `factory` and runs
+ * the inference stage of each package on the least-loaded one. It exposes the usual single
+ * pipeline context, so algorithms take it in place of a plain core. The inference block runs on
+ * `replica_num` workers.
+ *
+ * Several small replicas, e.g. onnxruntime sessions with fewer intra-op threads each, usually
+ * give more throughput than one session using all the cores. Let the replicas share weights and
+ * thread pools through the options of the factory where the core supports it.
+ *
+ * @param factory builds the replicas, they must all load the same model.
+ * @param replica_num
+ * @return std::shared_ptr<BaseInferCore>
+ */
+std::shared_ptr<BaseInferCore> CreateInferCorePool(std::shared_ptr<BaseInferCoreFactory> factory,
+                                                   size_t replica_num);
+
+std::shared_ptr<BaseInferCoreFactory> CreateInferCorePoolFactory(
+    std::shared_ptr<BaseInferCoreFactory> factory,
+    size_t                                replica_num);
+
+} // namespace easy_deploy
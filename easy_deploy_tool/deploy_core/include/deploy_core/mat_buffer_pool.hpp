@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace easy_deploy {
+
+/**
+ * @brief A `cv::MatAllocator` which recycles released buffers of the same byte size instead of
+ * returning them to the heap. Used to keep large per-frame outputs (e.g. full-resolution
+ * disparity maps) out of malloc and away from fresh page faults in steady state.
+ *
+ * `Lease` returns an ordinary `cv::Mat`, its buffer goes back to the pool when the last
+ * reference to it is released. Outstanding buffers keep the pool alive, so leased Mats may
+ * outlive the owner of the pool.
+ */
+class MatBufferPool : public cv::MatAllocator,
+                      public std::enable_shared_from_this<MatBufferPool> {
+public:
+  /**
+   * @brief Create a pool which caches up to `max_cached_buffers` released buffers.
+   */
+  static std::shared_ptr<MatBufferPool> Create(size_t max_cached_buffers);
+
+  /**
+   * @brief Get a `rows x cols` Mat of `type` backed by a pooled buffer. The content is not
+   * initialized.
+   */
+  cv::Mat Lease(int rows, int cols, int type);
+
+  /**
+   * @brief Change the number of cached buffers, the extra ones are freed.
+   */
+  void SetMaxCachedBuffers(size_t max_cached_buffers);
+
+  size_t GetCachedBufferNum();
+
+  ~MatBufferPool() override;
+
+  cv::UMatData *allocate(int                 dims,
+                         const int          *sizes,
+                         int                 type,
+                         void               *data,
+                         size_t             *step,
+                         cv::AccessFlag      flags,
+                         cv::UMatUsageFlags  usage_flags) const override;
+
+  bool allocate(cv::UMatData      *data,
+                cv::AccessFlag     access_flags,
+                cv::UMatUsageFlags usage_flags) const override;
+
+  void deallocate(cv::UMatData *data) const override;
+
+private:
+  explicit MatBufferPool(size_t max_cached_buffers);
+
+  uchar *AcquireBuffer(size_t size) const;
+
+  void RecycleBuffer(uchar *buffer, size_t size) const;
+
+private:
+  // `allocate` and `deallocate` are const in `cv::MatAllocator`
+  mutable std::mutex                                      mtx_;
+  mutable std::unordered_map<size_t, std::vector<uchar *>> free_buffers_;
+  mutable size_t                                          cached_buffer_num_{0};
+  size_t                                                  max_cached_buffers_;
+};
+
+} // namespace easy_deploy
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace easy_deploy {
+
+/**
+ * @brief Map a disparity map predicted on the model input back to the original image in a
+ * single pass : crop `valid_roi` (the area of the model input holding the resized image),
+ * bilinearly resize it to `dst_height x dst_width` with the same sampling as
+ * `cv::resize(..., cv::INTER_LINEAR)`, and multiply the disparities by the horizontal scale
+ * factor `dst_width / valid_roi.width` so they are expressed in pixels of the original image.
+ *
+ * `disp` is read in place, no intermediate image is materialized. `dst` is reallocated only if
+ * its size or type does not match, so a caller-provided buffer is written in place.
+ *
+ * @param disp row-major float disparity map of `disp_height x disp_width`
+ * @param disp_height
+ * @param disp_width
+ * @param valid_roi the valid area in `disp`, empty means the whole map
+ * @param dst_height
+ * @param dst_width
+ * @param dst CV_32FC1 output
+ * @param rescale_disp if false, the disparity values are kept at the model resolution
+ */
+void StereoDispToOriginal(const float    *disp,
+                          int             disp_height,
+                          int             disp_width,
+                          const cv::Rect &valid_roi,
+                          int             dst_height,
+                          int             dst_width,
+                          cv::Mat        &dst,
+                          bool            rescale_disp = true);
+
+/**
+ * @brief Geometry of the tiled stereo mode, in pixels of the original images. See
+ * `BaseStereoMatchingModel::ComputeDispTiled`.
+ *
+ */
+struct StereoTilingOptions {
+  // size of the crops fed to the model, the model input size gives full-resolution disparity
+  int tile_height = 256;
+  int tile_width  = 512;
+  // overlap of the disparities of neighbouring tiles, blended with linear feathering
+  int overlap = 32;
+  // the largest disparity to find. The tiles besides the first column reach this far to the left
+  // of the area they provide disparities for, so the matching pixels of the right view are inside
+  // the crop. Their disparities in the margin are not used.
+  int max_disparity = 192;
+};
+
+/**
+ * @brief One tile of a tiled stereo inference.
+ *
+ */
+struct StereoTile {
+  // the area of the original images fed to the model
+  cv::Rect crop;
+  // the area inside `crop` whose disparities are used, in image coordinates
+  cv::Rect valid;
+  // width of the borders of `valid` shared with the neighbouring tiles, feathered when blending
+  int feather_left   = 0;
+  int feather_right  = 0;
+  int feather_top    = 0;
+  int feather_bottom = 0;
+};
+
+/**
+ * @brief Cut an `image_height x image_width` pair into a grid of overlapping tiles whose `valid`
+ * areas cover the whole image. Throws if `tile_width` does not leave room for the overlap besides
+ * the disparity margin.
+ *
+ * @return std::vector<StereoTile> row-major
+ */
+std::vector<StereoTile> BuildStereoTiles(int                        image_height,
+                                         int                        image_width,
+                                         const StereoTilingOptions &options);
+
+/**
+ * @brief Add the `valid` area of a tile disparity, `tile.crop` sized CV_32FC1 in pixels of the
+ * original image, to the weighted sums. Inside the shared borders the weight ramps linearly
+ * towards the neighbour, so the seams blend smoothly. Divide `disp_sum` by `weight_sum` once all
+ * the tiles are added.
+ *
+ * @param tile_disp
+ * @param tile
+ * @param disp_sum CV_32FC1 of the image size
+ * @param weight_sum CV_32FC1 of the image size
+ */
+void AccumulateStereoDispTile(const cv::Mat    &tile_disp,
+                              const StereoTile &tile,
+                              cv::Mat          &disp_sum,
+                              cv::Mat          &weight_sum);
+
+} // namespace easy_deploy
@@ -100,8 +100,10 @@ std::future<std::vector<BBox2D>> BaseDetectionModel::DetectAsync(const cv::Mat &
     return std::future<std::vector<BBox2D>>();
   }
 
-  // 2. get blob buffer
-  auto blob_buffers = infer_core_->GetBuffer(true);
+  // 2. get blob buffer, stale packages are dropped instead of waiting with `cover_oldest`
+  auto blob_buffers = AcquireForPush<BlobsTensor>(
+      detection_pipeline_name_, cover_oldest,
+      [this](bool block) { return infer_core_->GetBuffer(block); });
   if (blob_buffers == nullptr)
   {
     LOG_ERROR("[BaseDetectionModel] Failed to get buffer from inference core!!!");
@@ -112,7 +114,39 @@ std::future<std::vector<BBox2D>> BaseDetectionModel::DetectAsync(const cv::Mat &
   auto package = CreateDetectionPipelineUnit(input_image, conf_thresh, isRGB, blob_buffers);
 
   // 4. push package into pipeline and return `std::future`
-  return PushPipeline(detection_pipeline_name_, package);
+  return PushPipeline(detection_pipeline_name_, package, cover_oldest);
+}
+
+bool BaseDetectionModel::DetectAsync(const cv::Mat                        &input_image,
+                                     float                                 conf_thresh,
+                                     PipelineCallback<std::vector<BBox2D>> on_done,
+                                     bool                                  isRGB,
+                                     bool                                  cover_oldest,
+                                     std::shared_ptr<IPipelineExecutor>    executor) noexcept
+{
+  // 1. check if the pipeline is initialized
+  if (!IsPipelineInitialized(detection_pipeline_name_))
+  {
+    LOG_ERROR("[BaseDetectionModel] Async Pipeline is not init yet!!!");
+    return false;
+  }
+
+  // 2. get blob buffer, stale packages are dropped instead of waiting with `cover_oldest`
+  auto blob_buffers = AcquireForPush<BlobsTensor>(
+      detection_pipeline_name_, cover_oldest,
+      [this](bool block) { return infer_core_->GetBuffer(block); });
+  if (blob_buffers == nullptr)
+  {
+    LOG_ERROR("[BaseDetectionModel] Failed to get buffer from inference core!!!");
+    return false;
+  }
+
+  // 3. create a pipeline package
+  auto package = CreateDetectionPipelineUnit(input_image, conf_thresh, isRGB, blob_buffers);
+
+  // 4. push package into pipeline, `on_done` is called once it comes out
+  return PushPipeline(detection_pipeline_name_, package, std::move(on_done), std::move(executor),
+                      cover_oldest);
 }
 
 BaseDetectionModel::~BaseDetectionModel()
@@ -1,7 +1,44 @@
 #include "deploy_core/base_infer_core.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace easy_deploy {
 
+ShapeBucket SelectShapeBucket(const std::vector<ShapeBucket> &buckets,
+                              int                             image_height,
+                              int                             image_width,
+                              const ShapeBucket              &fallback)
+{
+  if (buckets.empty() || image_height <= 0 || image_width <= 0)
+  {
+    return fallback;
+  }
+
+  auto func_area = [](const ShapeBucket &bucket) {
+    return static_cast<int64_t>(bucket.height) * bucket.width;
+  };
+  const auto largest = *std::max_element(
+      buckets.begin(), buckets.end(),
+      [&](const ShapeBucket &a, const ShapeBucket &b) { return func_area(a) < func_area(b); });
+
+  const float scale         = std::min(static_cast<float>(largest.height) / image_height,
+                                       static_cast<float>(largest.width) / image_width);
+  const int   scaled_height = static_cast<int>(std::lround(image_height * scale));
+  const int   scaled_width  = static_cast<int>(std::lround(image_width * scale));
+
+  ShapeBucket ret = largest;
+  for (const auto &bucket : buckets)
+  {
+    if (bucket.height >= scaled_height && bucket.width >= scaled_width &&
+        func_area(bucket) < func_area(ret))
+    {
+      ret = bucket;
+    }
+  }
+  return ret;
+}
+
 // used in sync infer
 struct _InnerSyncInferPackage : public IPipelinePackage {
 public:
@@ -13,16 +50,65 @@ public:
 };
 
 BaseInferCore::BaseInferCore()
+{
+  ConfigInferCorePipeline();
+}
+
+void BaseInferCore::ConfigInferCorePipeline()
 {
   auto preprocess_block = BuildPipelineBlock(
       [&](ParsingType unit) -> bool { return PreProcess(unit); }, "BaseInferCore PreProcess");
   auto inference_block = BuildPipelineBlock(
-      [&](ParsingType unit) -> bool { return Inference(unit); }, "BaseInferCore Inference");
+      [&](ParsingType unit) -> bool { return Inference(unit); }, "BaseInferCore Inference",
+      inference_worker_num_);
   auto postprocess_block = BuildPipelineBlock(
       [&](ParsingType unit) -> bool { return PostProcess(unit); }, "BaseInferCore PostProcess");
+  if (max_batch_size_ > 1)
+  {
+    inference_block.SetBatchFunc(
+        [&](const std::vector<ParsingType> &units, std::vector<bool> &results) -> bool {
+          return BatchInference(units, results);
+        },
+        max_batch_size_, batch_timeout_);
+  }
+  preprocess_block.SetTrivial(preprocess_trivial_);
+  postprocess_block.SetTrivial(postprocess_trivial_);
   ConfigPipeline("InferCore Pipieline", {preprocess_block, inference_block, postprocess_block});
 }
 
+void BaseInferCore::EnableDynamicBatching(size_t max_batch_size, std::chrono::microseconds timeout)
+{
+  max_batch_size_ = max_batch_size < 1 ? 1 : max_batch_size;
+  batch_timeout_  = timeout;
+  ConfigInferCorePipeline();
+
+  // a batch can only be filled if enough blobs buffers are in flight
+  if (mem_buf_pool_ != nullptr && mem_buf_pool_->PoolSize() < 2 * max_batch_size_)
+  {
+    if (mem_buf_pool_->RemainSize() == static_cast<int>(mem_buf_pool_->PoolSize()))
+    {
+      Init(std::min<size_t>(2 * max_batch_size_, 100));
+    } else
+    {
+      LOG_WARN("[BaseInferCore] mem buf pool size {%ld} is too small for batch size {%ld}",
+               mem_buf_pool_->PoolSize(), max_batch_size_);
+    }
+  }
+}
+
+void BaseInferCore::SetTrivialStages(bool preprocess_trivial, bool postprocess_trivial)
+{
+  preprocess_trivial_  = preprocess_trivial;
+  postprocess_trivial_ = postprocess_trivial;
+  ConfigInferCorePipeline();
+}
+
+void BaseInferCore::SetInferenceWorkerNum(int worker_num)
+{
+  inference_worker_num_ = worker_num < 1 ? 1 : worker_num;
+  ConfigInferCorePipeline();
+}
+
 bool BaseInferCore::SyncInfer(BlobsTensor *tensors, const int batch_size)
 {
   auto inner_package    = std::make_shared<_InnerSyncInferPackage>();
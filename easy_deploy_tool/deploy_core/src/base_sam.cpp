@@ -246,27 +246,32 @@ bool BaseSamModel::GenerateMask(const cv::Mat             &image,
   return true;
 }
 
-std::future<cv::Mat> BaseSamModel::GenerateMaskAsync(const cv::Mat                          &image,
-                                                     const std::vector<std::pair<int, int>> &points,
-                                                     const std::vector<int>                 &labels,
-                                                     bool                                    isRGB,
-                                                     bool cover_oldest)
+BaseSamModel::ParsingType BaseSamModel::CreatePointsPackage(
+    const cv::Mat                          &image,
+    const std::vector<std::pair<int, int>> &points,
+    const std::vector<int>                 &labels,
+    bool                                    isRGB,
+    bool                                    cover_oldest)
 {
   // 0. Check
   if (!CheckValidArguments(image, mask_points_decoder_core_, points, labels))
   {
     LOG_ERROR("[BaseSamModel] `GenerateMask` with points got invalid arguments");
-    return std::future<cv::Mat>();
+    return nullptr;
   }
   if (!BaseAsyncPipeline::IsPipelineInitialized(point_pipeline_name_))
   {
     LOG_ERROR("[BaseSamModel] Async pipeline with points as prompt is not initialized yet!!!");
-    return std::future<cv::Mat>();
+    return nullptr;
   }
 
-  // 1. Get blobs buffers
-  auto encoder_blob_buffers = image_encoder_core_->GetBuffer(true);
-  auto decoder_blob_buffers = mask_points_decoder_core_->GetBuffer(true);
+  // 1. Get blobs buffers, stale packages are dropped instead of waiting with `cover_oldest`
+  auto encoder_blob_buffers = AcquireForPush<BlobsTensor>(
+      point_pipeline_name_, cover_oldest,
+      [this](bool block) { return image_encoder_core_->GetBuffer(block); });
+  auto decoder_blob_buffers = AcquireForPush<BlobsTensor>(
+      point_pipeline_name_, cover_oldest,
+      [this](bool block) { return mask_points_decoder_core_->GetBuffer(block); });
 
   // 2. Construct `SamPipelinePackage`
   auto package                        = std::make_shared<SamPipelinePackage>();
@@ -275,32 +280,34 @@ std::future<cv::Mat> BaseSamModel::GenerateMaskAsync(const cv::Mat
   package->labels                     = labels;
   package->image_encoder_blobs_buffer = encoder_blob_buffers;
   package->mask_decoder_blobs_buffer  = decoder_blob_buffers;
-
-  // 3. return `std::future` instance
-  return BaseAsyncPipeline::PushPipeline(point_pipeline_name_, package);
+  return package;
 }
 
-std::future<cv::Mat> BaseSamModel::GenerateMaskAsync(const cv::Mat             &image,
-                                                     const std::vector<BBox2D> &boxes,
-                                                     bool                       isRGB,
-                                                     bool                       cover_oldest)
+BaseSamModel::ParsingType BaseSamModel::CreateBoxesPackage(const cv::Mat             &image,
+                                                           const std::vector<BBox2D> &boxes,
+                                                           bool                       isRGB,
+                                                           bool                       cover_oldest)
 {
   // 0. check
   if (!CheckValidArguments(image, mask_boxes_decoder_core_, boxes))
   {
     LOG_ERROR("[BaseSamModel] `GenerateMask` with boxes got invalid arguments");
-    return std::future<cv::Mat>();
+    return nullptr;
   }
 
   if (!BaseAsyncPipeline::IsPipelineInitialized(box_pipeline_name_))
   {
     LOG_ERROR("[BaseSamModel] Async pipeline with boxes as prompt is not initialized yet!!!");
-    return std::future<cv::Mat>();
+    return nullptr;
   }
 
-  // 1. Get blobs buffers
-  auto encoder_blob_buffers = image_encoder_core_->GetBuffer(true);
-  auto decoder_blob_buffers = mask_boxes_decoder_core_->GetBuffer(true);
+  // 1. Get blobs buffers, stale packages are dropped instead of waiting with `cover_oldest`
+  auto encoder_blob_buffers = AcquireForPush<BlobsTensor>(
+      box_pipeline_name_, cover_oldest,
+      [this](bool block) { return image_encoder_core_->GetBuffer(block); });
+  auto decoder_blob_buffers = AcquireForPush<BlobsTensor>(
+      box_pipeline_name_, cover_oldest,
+      [this](bool block) { return mask_boxes_decoder_core_->GetBuffer(block); });
 
   // 2. Construct `SamPipelinePackage`
   auto package                        = std::make_shared<SamPipelinePackage>();
@@ -308,9 +315,73 @@ std::future<cv::Mat> BaseSamModel::GenerateMaskAsync(const cv::Mat             &
   package->boxes                      = boxes;
   package->image_encoder_blobs_buffer = encoder_blob_buffers;
   package->mask_decoder_blobs_buffer  = decoder_blob_buffers;
+  return package;
+}
+
+std::future<cv::Mat> BaseSamModel::GenerateMaskAsync(const cv::Mat                          &image,
+                                                     const std::vector<std::pair<int, int>> &points,
+                                                     const std::vector<int>                 &labels,
+                                                     bool                                    isRGB,
+                                                     bool cover_oldest)
+{
+  auto package = CreatePointsPackage(image, points, labels, isRGB, cover_oldest);
+  if (package == nullptr)
+  {
+    return std::future<cv::Mat>();
+  }
+
+  // return `std::future` instance
+  return BaseAsyncPipeline::PushPipeline(point_pipeline_name_, package, cover_oldest);
+}
+
+std::future<cv::Mat> BaseSamModel::GenerateMaskAsync(const cv::Mat             &image,
+                                                     const std::vector<BBox2D> &boxes,
+                                                     bool                       isRGB,
+                                                     bool                       cover_oldest)
+{
+  auto package = CreateBoxesPackage(image, boxes, isRGB, cover_oldest);
+  if (package == nullptr)
+  {
+    return std::future<cv::Mat>();
+  }
+
+  // return `std::future` instance
+  return BaseAsyncPipeline::PushPipeline(box_pipeline_name_, package, cover_oldest);
+}
+
+bool BaseSamModel::GenerateMaskAsync(const cv::Mat                          &image,
+                                     const std::vector<std::pair<int, int>> &points,
+                                     const std::vector<int>                 &labels,
+                                     PipelineCallback<cv::Mat>               on_done,
+                                     bool                                    isRGB,
+                                     bool                                    cover_oldest,
+                                     std::shared_ptr<IPipelineExecutor>      executor)
+{
+  auto package = CreatePointsPackage(image, points, labels, isRGB, cover_oldest);
+  if (package == nullptr)
+  {
+    return false;
+  }
+
+  return BaseAsyncPipeline::PushPipeline(point_pipeline_name_, package, std::move(on_done),
+                                         std::move(executor), cover_oldest);
+}
+
+bool BaseSamModel::GenerateMaskAsync(const cv::Mat                     &image,
+                                     const std::vector<BBox2D>         &boxes,
+                                     PipelineCallback<cv::Mat>          on_done,
+                                     bool                               isRGB,
+                                     bool                               cover_oldest,
+                                     std::shared_ptr<IPipelineExecutor> executor)
+{
+  auto package = CreateBoxesPackage(image, boxes, isRGB, cover_oldest);
+  if (package == nullptr)
+  {
+    return false;
+  }
 
-  // 3. return `std::future` instance
-  return BaseAsyncPipeline::PushPipeline(box_pipeline_name_, package);
+  return BaseAsyncPipeline::PushPipeline(box_pipeline_name_, package, std::move(on_done),
+                                         std::move(executor), cover_oldest);
 }
 
 } // namespace easy_deploy
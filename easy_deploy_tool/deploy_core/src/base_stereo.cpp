@@ -7,7 +7,11 @@ const std::string BaseStereoMatchingModel::stereo_pipeline_name_ = "stereo_pipel
 
 BaseStereoMatchingModel::BaseStereoMatchingModel(
     const std::shared_ptr<BaseInferCore> &inference_core)
-    : inference_core_(inference_core)
+    : inference_core_(inference_core),
+      disp_buffer_pool_(MatBufferPool::Create(4)),
+      tile_buffer_pool_(MatBufferPool::Create(4)),
+      package_pool_(std::make_shared<RecyclingBlockPool>()),
+      shape_buckets_(inference_core->GetShapeBuckets())
 {
   auto preprocess_block = BaseAsyncPipeline::BuildPipelineBlock(
       [&](ParsingType unit) -> bool { return PreProcess(unit); }, "[StereoPreProcess]");
@@ -21,6 +25,26 @@ BaseStereoMatchingModel::BaseStereoMatchingModel(
                                     {preprocess_block, inference_core_context, postprocess_block});
 }
 
+std::shared_ptr<StereoPipelinePackage> BaseStereoMatchingModel::CreatePackage(
+    const cv::Mat               &left_image,
+    const cv::Mat               &right_image,
+    std::shared_ptr<BlobsTensor> infer_buffer)
+{
+  auto package              = MakePooledShared<StereoPipelinePackage>(package_pool_);
+  package->left_image_data  = MakePooledShared<PipelineCvImageWrapper>(package_pool_, left_image);
+  package->right_image_data = MakePooledShared<PipelineCvImageWrapper>(package_pool_, right_image);
+  package->infer_buffer     = std::move(infer_buffer);
+  package->debug_frame      = DebugTap::Instance().NewFrame();
+  return package;
+}
+
+std::shared_ptr<BlobsTensor> BaseStereoMatchingModel::AcquireAsyncInferBuffer()
+{
+  return AcquireForPush<BlobsTensor>(stereo_pipeline_name_, false, [this](bool block) {
+    return inference_core_->GetBuffer(block);
+  });
+}
+
 bool BaseStereoMatchingModel::ComputeDisp(const cv::Mat &left_image,
                                           const cv::Mat &right_image,
                                           cv::Mat       &disp_output)
@@ -28,13 +52,20 @@ bool BaseStereoMatchingModel::ComputeDisp(const cv::Mat &left_image,
   CHECK_STATE(!left_image.empty() && !right_image.empty(),
               "[BaseStereoMatchingModel] `ComputeDisp` Got invalid input images !!!");
 
-  auto package              = std::make_shared<StereoPipelinePackage>();
-  package->left_image_data  = std::make_shared<PipelineCvImageWrapper>(left_image);
-  package->right_image_data = std::make_shared<PipelineCvImageWrapper>(right_image);
-  package->infer_buffer     = inference_core_->GetBuffer(true);
+  auto package = CreatePackage(left_image, right_image, inference_core_->GetBuffer(true));
   CHECK_STATE(package->infer_buffer != nullptr,
               "[BaseStereoMatchingModel] `ComputeDisp` Got invalid inference core buffer ptr !!!");
 
+  // `PostProcess` writes in place into a disparity of the right size and type
+  if (disp_output.rows == left_image.rows && disp_output.cols == left_image.cols &&
+      disp_output.type() == CV_32FC1)
+  {
+    package->disp = disp_output;
+  } else
+  {
+    package->disp = disp_buffer_pool_->Lease(left_image.rows, left_image.cols, CV_32FC1);
+  }
+
   MESSURE_DURATION_AND_CHECK_STATE(
       PreProcess(package), "[BaseStereoMatchingModel] `ComputeDisp` Failed execute PreProcess !!!");
   MESSURE_DURATION_AND_CHECK_STATE(
@@ -58,18 +89,209 @@ std::future<cv::Mat> BaseStereoMatchingModel::ComputeDispAsync(const cv::Mat &le
     return std::future<cv::Mat>();
   }
 
-  auto package              = std::make_shared<StereoPipelinePackage>();
-  package->left_image_data  = std::make_shared<PipelineCvImageWrapper>(left_image);
-  package->right_image_data = std::make_shared<PipelineCvImageWrapper>(right_image);
-  package->infer_buffer     = inference_core_->GetBuffer(true);
+  auto package = CreatePackage(left_image, right_image, AcquireAsyncInferBuffer());
+  if (package->infer_buffer == nullptr)
+  {
+    LOG_ERROR(
+        "[BaseStereoMatchingModel] `ComputeDispAsync` Got invalid inference core buffer ptr !!!");
+    return std::future<cv::Mat>();
+  }
+  package->disp = disp_buffer_pool_->Lease(left_image.rows, left_image.cols, CV_32FC1);
+
+  return BaseAsyncPipeline::PushPipeline(stereo_pipeline_name_, package);
+}
+
+std::future<cv::Mat> BaseStereoMatchingModel::ComputeDispAsync(const cv::Mat &left_image,
+                                                               const cv::Mat &right_image,
+                                                               cv::Mat       &disp_output)
+{
+  if (left_image.empty() || right_image.empty())
+  {
+    LOG_ERROR("[BaseStereoMatchingModel] `ComputeDispAsync` Got invalid input images !!!");
+    return std::future<cv::Mat>();
+  }
+  if (disp_output.rows != left_image.rows || disp_output.cols != left_image.cols ||
+      disp_output.type() != CV_32FC1)
+  {
+    LOG_ERROR("[BaseStereoMatchingModel] `ComputeDispAsync` expects a CV_32FC1 %d x %d output, "
+              "but got a %d x %d Mat of type %d !!!",
+              left_image.rows, left_image.cols, disp_output.rows, disp_output.cols,
+              disp_output.type());
+    return std::future<cv::Mat>();
+  }
+
+  auto package = CreatePackage(left_image, right_image, AcquireAsyncInferBuffer());
   if (package->infer_buffer == nullptr)
   {
     LOG_ERROR(
         "[BaseStereoMatchingModel] `ComputeDispAsync` Got invalid inference core buffer ptr !!!");
     return std::future<cv::Mat>();
   }
+  package->disp = disp_output;
 
   return BaseAsyncPipeline::PushPipeline(stereo_pipeline_name_, package);
 }
 
+bool BaseStereoMatchingModel::ComputeDispAsync(const cv::Mat                     &left_image,
+                                               const cv::Mat                     &right_image,
+                                               PipelineCallback<cv::Mat>          on_done,
+                                               std::shared_ptr<IPipelineExecutor> executor)
+{
+  if (left_image.empty() || right_image.empty())
+  {
+    LOG_ERROR("[BaseStereoMatchingModel] `ComputeDispAsync` Got invalid input images !!!");
+    return false;
+  }
+
+  auto package = CreatePackage(left_image, right_image, AcquireAsyncInferBuffer());
+  if (package->infer_buffer == nullptr)
+  {
+    LOG_ERROR(
+        "[BaseStereoMatchingModel] `ComputeDispAsync` Got invalid inference core buffer ptr !!!");
+    return false;
+  }
+  package->disp = disp_buffer_pool_->Lease(left_image.rows, left_image.cols, CV_32FC1);
+
+  return BaseAsyncPipeline::PushPipeline(stereo_pipeline_name_, package, std::move(on_done),
+                                         std::move(executor));
+}
+
+bool BaseStereoMatchingModel::ComputeDispTiled(const cv::Mat             &left_image,
+                                               const cv::Mat             &right_image,
+                                               cv::Mat                   &disp_output,
+                                               const StereoTilingOptions &options)
+{
+  CHECK_STATE(!left_image.empty() && !right_image.empty() &&
+                  left_image.size() == right_image.size() &&
+                  left_image.type() == right_image.type(),
+              "[BaseStereoMatchingModel] `ComputeDispTiled` Got invalid input images !!!");
+
+  const auto tiles = BuildStereoTiles(left_image.rows, left_image.cols, options);
+  // the crops and disparities of all the tiles are alive at once, the weight map comes on top
+  tile_buffer_pool_->SetMaxCachedBuffers(std::min(3 * tiles.size() + 1, kMaxCachedTileBuffers));
+
+  std::vector<cv::Mat> tile_disps(tiles.size());
+  MESSURE_DURATION_AND_CHECK_STATE(
+      InferStereoTiles(left_image, right_image, tiles, tile_disps),
+      "[BaseStereoMatchingModel] `ComputeDispTiled` Failed to infer the tiles !!!");
+
+  cv::Mat disp_sum;
+  if (disp_output.rows == left_image.rows && disp_output.cols == left_image.cols &&
+      disp_output.type() == CV_32FC1)
+  {
+    disp_sum = disp_output;
+  } else
+  {
+    disp_sum = disp_buffer_pool_->Lease(left_image.rows, left_image.cols, CV_32FC1);
+  }
+  cv::Mat weight_sum = tile_buffer_pool_->Lease(left_image.rows, left_image.cols, CV_32FC1);
+  disp_sum.setTo(0);
+  weight_sum.setTo(0);
+  for (size_t i = 0; i < tiles.size(); ++i)
+  {
+    AccumulateStereoDispTile(tile_disps[i], tiles[i], disp_sum, weight_sum);
+  }
+  // the valid areas of the tiles cover the image, every weight is positive
+  cv::divide(disp_sum, weight_sum, disp_sum);
+
+  disp_output = std::move(disp_sum);
+  return true;
+}
+
+bool BaseStereoMatchingModel::InferStereoTiles(const cv::Mat                 &left_image,
+                                               const cv::Mat                 &right_image,
+                                               const std::vector<StereoTile> &tiles,
+                                               std::vector<cv::Mat>          &tile_disps)
+{
+  // the image wrappers describe continuous images only, the crops are copied
+  auto func_create_tile_package = [&](const StereoTile &tile) {
+    const auto &crop       = tile.crop;
+    cv::Mat     left_tile  = tile_buffer_pool_->Lease(crop.height, crop.width, left_image.type());
+    cv::Mat     right_tile = tile_buffer_pool_->Lease(crop.height, crop.width, right_image.type());
+    left_image(crop).copyTo(left_tile);
+    right_image(crop).copyTo(right_tile);
+
+    auto package  = CreatePackage(left_tile, right_tile, inference_core_->GetBuffer(true));
+    package->disp = tile_buffer_pool_->Lease(crop.height, crop.width, CV_32FC1);
+    return package;
+  };
+
+  if (!IsPipelineInitialized(stereo_pipeline_name_))
+  {
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+      auto package = func_create_tile_package(tiles[i]);
+      CHECK_STATE(package->infer_buffer != nullptr,
+                  "[BaseStereoMatchingModel] Got invalid inference core buffer ptr !!!");
+      CHECK_STATE(PreProcess(package), "[BaseStereoMatchingModel] Failed execute PreProcess !!!");
+      CHECK_STATE(inference_core_->SyncInfer(package->infer_buffer.get()),
+                  "[BaseStereoMatchingModel] Failed execute inference sync infer !!!");
+      CHECK_STATE(PostProcess(package), "[BaseStereoMatchingModel] Failed execute PostProcess !!!");
+      tile_disps[i] = std::move(package->disp);
+    }
+    return true;
+  }
+
+  struct TileResults {
+    std::mutex              mtx;
+    std::condition_variable cv;
+    size_t                  done        = 0;
+    bool                    all_success = true;
+  } results;
+
+  // all the tiles are pushed before waiting, the pipeline runs them concurrently
+  size_t pushed = 0;
+  for (; pushed < tiles.size(); ++pushed)
+  {
+    auto package = func_create_tile_package(tiles[pushed]);
+    if (package->infer_buffer == nullptr)
+    {
+      LOG_ERROR("[BaseStereoMatchingModel] Got invalid inference core buffer ptr !!!");
+      break;
+    }
+    auto on_done = [&results, &tile_disps, i = pushed](PipelineStatus status, cv::Mat disp) {
+      std::lock_guard<std::mutex> lck(results.mtx);
+      results.all_success &= status == PIPELINE_SUCCESS;
+      tile_disps[i] = std::move(disp);
+      ++results.done;
+      // notify under the lock, `results` is gone once the waiting thread gets it
+      results.cv.notify_all();
+    };
+    if (!BaseAsyncPipeline::PushPipeline(stereo_pipeline_name_, package, std::move(on_done)))
+    {
+      LOG_ERROR("[BaseStereoMatchingModel] Failed to push tile %ld !!!", pushed);
+      break;
+    }
+  }
+
+  // the pushed tiles reference `results`, wait for them even if a push failed
+  std::unique_lock<std::mutex> lck(results.mtx);
+  results.cv.wait(lck, [&]() { return results.done == pushed; });
+  return pushed == tiles.size() && results.all_success;
+}
+
+bool BaseStereoMatchingModel::SelectInputShape(StereoPipelinePackage &package,
+                                               int                    default_height,
+                                               int                    default_width)
+{
+  const auto &image_info = package.left_image_data->GetImageDataInfo();
+  const auto  bucket     =
+      SelectShapeBucket(shape_buckets_, image_info.image_height, image_info.image_width,
+                        {default_height, default_width});
+  if (!shape_buckets_.empty())
+  {
+    CHECK_STATE(inference_core_->ApplyShapeBucket(package.GetInferBuffer(), bucket),
+                "[BaseStereoMatchingModel] Failed to apply shape bucket %d x %d !!!",
+                bucket.height, bucket.width);
+  }
+  package.input_height = bucket.height;
+  package.input_width  = bucket.width;
+  return true;
+}
+
+void BaseStereoMatchingModel::SetDispBufferPoolSize(size_t max_cached_buffers)
+{
+  disp_buffer_pool_->SetMaxCachedBuffers(max_cached_buffers);
+}
+
 } // namespace easy_deploy
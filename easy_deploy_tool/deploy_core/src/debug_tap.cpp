@@ -0,0 +1,148 @@
+#include "deploy_core/debug_tap.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <filesystem>
+
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+#include "common_utils/log.hpp"
+
+namespace easy_deploy {
+
+thread_local DebugTapFrame DebugTap::current_frame_;
+
+DebugTap &DebugTap::Instance()
+{
+  static DebugTap inst;
+  return inst;
+}
+
+DebugTap::~DebugTap()
+{
+  Disable();
+}
+
+bool DebugTap::Enable(const DebugTapOptions &options)
+{
+  std::lock_guard<std::mutex> control_lk(control_mtx_);
+  enabled_.store(false, std::memory_order_relaxed);
+  StopWriter();
+
+  std::error_code ec;
+  std::filesystem::create_directories(options.output_dir, ec);
+  if (ec)
+  {
+    LOG_ERROR("[DebugTap] Failed to create output dir %s : %s", options.output_dir.c_str(),
+              ec.message().c_str());
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    ring_capacity_  = std::max<size_t>(options.ring_capacity, 1);
+    writer_running_ = true;
+    writer_ = std::thread([this, output_dir = options.output_dir]() { WriterEntry(output_dir); });
+  }
+  sample_interval_.store(options.sample_interval, std::memory_order_relaxed);
+  enabled_.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+void DebugTap::Disable()
+{
+  std::lock_guard<std::mutex> control_lk(control_mtx_);
+  enabled_.store(false, std::memory_order_relaxed);
+  StopWriter();
+}
+
+DebugTapFrame DebugTap::SampleFrame() noexcept
+{
+  DebugTapFrame frame;
+  frame.id = frame_counter_.fetch_add(1, std::memory_order_relaxed);
+
+  const uint64_t interval = sample_interval_.load(std::memory_order_relaxed);
+  frame.capture           = interval != 0 && frame.id % interval == 0;
+
+  uint64_t triggered = triggered_frames_.load(std::memory_order_relaxed);
+  while (!frame.capture && triggered > 0)
+  {
+    frame.capture = triggered_frames_.compare_exchange_weak(triggered, triggered - 1,
+                                                            std::memory_order_relaxed);
+  }
+  return frame;
+}
+
+void DebugTap::Enqueue(uint64_t frame_id, std::string name, const cv::Mat &mat)
+{
+  if (mat.empty())
+  {
+    return;
+  }
+  Capture capture{frame_id, std::move(name), mat.clone()};
+
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!writer_running_)
+  {
+    return;
+  }
+  if (ring_.size() >= ring_capacity_)
+  {
+    ring_.pop_front();
+    dropped_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  ring_.push_back(std::move(capture));
+  cv_.notify_one();
+}
+
+void DebugTap::WriterEntry(const std::string &output_dir)
+{
+  while (true)
+  {
+    Capture capture;
+    {
+      std::unique_lock<std::mutex> lk(mtx_);
+      cv_.wait(lk, [this] { return !ring_.empty() || !writer_running_; });
+      if (ring_.empty())
+      {
+        break;
+      }
+      capture = std::move(ring_.front());
+      ring_.pop_front();
+    }
+
+    const int   depth = capture.mat.depth();
+    const char *ext   = (depth == CV_8U || depth == CV_16U) ? "png" : "tiff";
+    char        file_name[256];
+    snprintf(file_name, sizeof(file_name), "%08" PRIu64 "_%s.%s", capture.frame_id,
+             capture.name.c_str(), ext);
+    const std::string file_path = (std::filesystem::path(output_dir) / file_name).string();
+
+    try
+    {
+      if (!cv::imwrite(file_path, capture.mat))
+      {
+        LOG_WARN("[DebugTap] Failed to write %s", file_path.c_str());
+      }
+    } catch (const cv::Exception &e)
+    {
+      LOG_WARN("[DebugTap] Failed to encode %s : %s", file_path.c_str(), e.what());
+    }
+  }
+}
+
+void DebugTap::StopWriter()
+{
+  if (!writer_.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    writer_running_ = false;
+  }
+  cv_.notify_all();
+  writer_.join();
+}
+
+} // namespace easy_deploy
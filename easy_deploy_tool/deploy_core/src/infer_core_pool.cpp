@@ -0,0 +1,186 @@
+#include "deploy_core/infer_core_pool.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace easy_deploy {
+
+class InferCorePool : public BaseInferCore {
+public:
+  InferCorePool(std::shared_ptr<BaseInferCoreFactory> factory, size_t replica_num)
+  {
+    CHECK_STATE_THROW(factory != nullptr, "[InferCorePool] Got invalid factory: nullptr !");
+    CHECK_STATE_THROW(replica_num > 0, "[InferCorePool] replica_num should be positive !");
+    for (size_t i = 0; i < replica_num; ++i)
+    {
+      auto replica = factory->Create();
+      CHECK_STATE_THROW(replica != nullptr, "[InferCorePool] Failed to create replica %ld !", i);
+      // the packages carry the buffers of the pool, the replicas do not need their own
+      replica->mem_buf_pool_.reset();
+      replicas_.push_back(std::move(replica));
+    }
+    replica_load_.resize(replica_num, 0);
+
+    const auto &first = replicas_.front();
+    SetTrivialStages(first->preprocess_trivial_, first->postprocess_trivial_);
+    SetInferenceWorkerNum(static_cast<int>(replica_num));
+
+    // enough buffers to keep all the replicas busy while the other stages work on more packages
+    BaseInferCore::Init(std::min<size_t>(std::max<size_t>(5, 2 * replica_num), 100));
+    LOG_DEBUG("[InferCorePool] created %ld replicas of %s", replica_num,
+              first->GetName().c_str());
+  }
+
+  ~InferCorePool() override
+  {
+    // the buffers were allocated by a replica, release them first
+    BaseInferCore::Release();
+  }
+
+  std::unique_ptr<BlobsTensor> AllocBlobsBuffer() override
+  {
+    return replicas_.front()->AllocBlobsBuffer();
+  }
+
+  InferCoreType GetType() override
+  {
+    return replicas_.front()->GetType();
+  }
+
+  std::string GetName() override
+  {
+    return "infer_core_pool";
+  }
+
+  std::vector<ShapeBucket> GetShapeBuckets() override
+  {
+    return replicas_.front()->GetShapeBuckets();
+  }
+
+  bool ApplyShapeBucket(BlobsTensor *buffer, const ShapeBucket &bucket) override
+  {
+    // the replicas run the same model, the shapes of a buffer suit all of them
+    return replicas_.front()->ApplyShapeBucket(buffer, bucket);
+  }
+
+private:
+  bool PreProcess(std::shared_ptr<IPipelinePackage> buffer) override
+  {
+    return replicas_.front()->PreProcess(buffer);
+  }
+
+  bool Inference(std::shared_ptr<IPipelinePackage> buffer) override
+  {
+    CHECK_STATE(buffer != nullptr, "[InferCorePool] Inference got invalid pipeline_unit!");
+    ReplicaGuard guard(*this, buffer->GetInferBuffer());
+    return replicas_[guard.index]->Inference(buffer);
+  }
+
+  bool PostProcess(std::shared_ptr<IPipelinePackage> buffer) override
+  {
+    return replicas_.front()->PostProcess(buffer);
+  }
+
+  bool BatchInference(const std::vector<std::shared_ptr<IPipelinePackage>> &buffers,
+                      std::vector<bool>                                   &results) override
+  {
+    CHECK_STATE(!buffers.empty() && buffers.front() != nullptr,
+                "[InferCorePool] BatchInference got invalid pipeline_unit!");
+    ReplicaGuard guard(*this, buffers.front()->GetInferBuffer());
+    return replicas_[guard.index]->BatchInference(buffers, results);
+  }
+
+private:
+  /**
+   * @brief Pick the replica with the fewest running calls. On a tie the replica which ran the
+   * buffer last is preferred, its binding of the buffer is surely up to date and still warm.
+   *
+   */
+  size_t AcquireReplica(BlobsTensor *buffer)
+  {
+    std::lock_guard<std::mutex> lck(mutex_);
+    size_t                      index = 0;
+    for (size_t i = 1; i < replica_load_.size(); ++i)
+    {
+      if (replica_load_[i] < replica_load_[index])
+      {
+        index = i;
+      }
+    }
+    auto iter = map_buffer2replica_.find(buffer);
+    if (iter != map_buffer2replica_.end() && replica_load_[iter->second] == replica_load_[index])
+    {
+      index = iter->second;
+    }
+
+    // buffers which are not from the pool could make the map grow without bound
+    if (map_buffer2replica_.size() > kMaxTrackedBuffers)
+    {
+      map_buffer2replica_.clear();
+    }
+    map_buffer2replica_[buffer] = index;
+    ++replica_load_[index];
+    return index;
+  }
+
+  void ReleaseReplica(size_t index)
+  {
+    std::lock_guard<std::mutex> lck(mutex_);
+    --replica_load_[index];
+  }
+
+  struct ReplicaGuard {
+    ReplicaGuard(InferCorePool &pool, BlobsTensor *buffer)
+        : pool(pool), index(pool.AcquireReplica(buffer))
+    {}
+
+    ~ReplicaGuard()
+    {
+      pool.ReleaseReplica(index);
+    }
+
+    InferCorePool &pool;
+    const size_t   index;
+  };
+
+private:
+  static constexpr size_t kMaxTrackedBuffers = 1024;
+
+  std::vector<std::shared_ptr<BaseInferCore>> replicas_;
+
+  std::mutex                                mutex_;
+  std::vector<int>                          replica_load_;
+  std::unordered_map<BlobsTensor *, size_t> map_buffer2replica_;
+};
+
+class InferCorePoolFactory : public BaseInferCoreFactory {
+public:
+  InferCorePoolFactory(std::shared_ptr<BaseInferCoreFactory> factory, size_t replica_num)
+      : factory_(factory), replica_num_(replica_num)
+  {}
+
+  std::shared_ptr<BaseInferCore> Create() override
+  {
+    return CreateInferCorePool(factory_, replica_num_);
+  }
+
+private:
+  const std::shared_ptr<BaseInferCoreFactory> factory_;
+  const size_t                                replica_num_;
+};
+
+std::shared_ptr<BaseInferCore> CreateInferCorePool(std::shared_ptr<BaseInferCoreFactory> factory,
+                                                   size_t replica_num)
+{
+  return std::make_shared<InferCorePool>(factory, replica_num);
+}
+
+std::shared_ptr<BaseInferCoreFactory> CreateInferCorePoolFactory(
+    std::shared_ptr<BaseInferCoreFactory> factory,
+    size_t                                replica_num)
+{
+  return std::make_shared<InferCorePoolFactory>(factory, replica_num);
+}
+
+} // namespace easy_deploy
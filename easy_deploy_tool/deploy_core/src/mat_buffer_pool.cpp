@@ -0,0 +1,164 @@
+#include "deploy_core/mat_buffer_pool.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief Keeps the pool alive while one of its buffers is referenced by a Mat.
+ *
+ */
+struct PooledUMatData : public cv::UMatData {
+  explicit PooledUMatData(std::shared_ptr<const MatBufferPool> _pool)
+      : cv::UMatData(_pool.get()), pool(std::move(_pool))
+  {}
+
+  std::shared_ptr<const MatBufferPool> pool;
+};
+
+std::shared_ptr<MatBufferPool> MatBufferPool::Create(size_t max_cached_buffers)
+{
+  return std::shared_ptr<MatBufferPool>(new MatBufferPool(max_cached_buffers));
+}
+
+MatBufferPool::MatBufferPool(size_t max_cached_buffers) : max_cached_buffers_(max_cached_buffers)
+{}
+
+MatBufferPool::~MatBufferPool()
+{
+  for (auto &p : free_buffers_)
+  {
+    for (uchar *buffer : p.second)
+    {
+      cv::fastFree(buffer);
+    }
+  }
+}
+
+cv::Mat MatBufferPool::Lease(int rows, int cols, int type)
+{
+  cv::Mat mat;
+  mat.allocator = this;
+  mat.create(rows, cols, type);
+  // the buffer returns through `UMatData::currAllocator`, later `create` calls on the Mat
+  // should not go through the pool
+  mat.allocator = nullptr;
+  return mat;
+}
+
+void MatBufferPool::SetMaxCachedBuffers(size_t max_cached_buffers)
+{
+  std::lock_guard<std::mutex> lk(mtx_);
+  max_cached_buffers_ = max_cached_buffers;
+  for (auto iter = free_buffers_.begin();
+       iter != free_buffers_.end() && cached_buffer_num_ > max_cached_buffers_;)
+  {
+    auto &buffers = iter->second;
+    while (!buffers.empty() && cached_buffer_num_ > max_cached_buffers_)
+    {
+      cv::fastFree(buffers.back());
+      buffers.pop_back();
+      --cached_buffer_num_;
+    }
+    iter = buffers.empty() ? free_buffers_.erase(iter) : std::next(iter);
+  }
+}
+
+size_t MatBufferPool::GetCachedBufferNum()
+{
+  std::lock_guard<std::mutex> lk(mtx_);
+  return cached_buffer_num_;
+}
+
+uchar *MatBufferPool::AcquireBuffer(size_t size) const
+{
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto                        iter = free_buffers_.find(size);
+    if (iter != free_buffers_.end() && !iter->second.empty())
+    {
+      uchar *buffer = iter->second.back();
+      iter->second.pop_back();
+      --cached_buffer_num_;
+      return buffer;
+    }
+  }
+  return static_cast<uchar *>(cv::fastMalloc(size));
+}
+
+void MatBufferPool::RecycleBuffer(uchar *buffer, size_t size) const
+{
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (cached_buffer_num_ < max_cached_buffers_)
+    {
+      free_buffers_[size].push_back(buffer);
+      ++cached_buffer_num_;
+      return;
+    }
+  }
+  cv::fastFree(buffer);
+}
+
+cv::UMatData *MatBufferPool::allocate(int                dims,
+                                      const int         *sizes,
+                                      int                type,
+                                      void              *data,
+                                      size_t            *step,
+                                      cv::AccessFlag,
+                                      cv::UMatUsageFlags) const
+{
+  // same layout as the default allocator : continuous, rows packed
+  size_t total = CV_ELEM_SIZE(type);
+  for (int i = dims - 1; i >= 0; --i)
+  {
+    if (step)
+    {
+      if (data && step[i] != cv::Mat::AUTO_STEP)
+      {
+        total = step[i];
+      } else
+      {
+        step[i] = total;
+      }
+    }
+    total *= sizes[i];
+  }
+
+  auto *u = new PooledUMatData(shared_from_this());
+  if (data)
+  {
+    u->data = u->origdata = static_cast<uchar *>(data);
+    u->flags |= cv::UMatData::USER_ALLOCATED;
+  } else
+  {
+    u->data = u->origdata = AcquireBuffer(total);
+  }
+  u->size = total;
+  return u;
+}
+
+bool MatBufferPool::allocate(cv::UMatData *u, cv::AccessFlag, cv::UMatUsageFlags) const
+{
+  return u != nullptr;
+}
+
+void MatBufferPool::deallocate(cv::UMatData *u) const
+{
+  if (u == nullptr)
+  {
+    return;
+  }
+  CV_Assert(u->urefcount == 0);
+  CV_Assert(u->refcount == 0);
+
+  auto *pooled_u = static_cast<PooledUMatData *>(u);
+  // `this` may be released together with the last buffer
+  std::shared_ptr<const MatBufferPool> keep_alive = std::move(pooled_u->pool);
+  if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+  {
+    RecycleBuffer(u->origdata, u->size);
+    u->origdata = nullptr;
+  }
+  delete pooled_u;
+}
+
+} // namespace easy_deploy
@@ -0,0 +1,318 @@
+#include "deploy_core/stereo_postprocess.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "common_utils/log.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief Source index pair and weight of each destination coordinate along one axis, with the
+ * half-pixel mapping and border clamping of `cv::resize(..., cv::INTER_LINEAR)`.
+ *
+ */
+struct DispAxisSampleTable {
+  std::vector<int>   index0;
+  std::vector<int>   index1;
+  std::vector<float> weight;
+};
+
+/**
+ * @brief Sample tables of the calling thread, reused by the next call on the same thread. The
+ * stripe workers keep their cached rows in thread_local vectors of their own.
+ *
+ */
+struct DispToOriginalScratch {
+  DispAxisSampleTable x_table;
+  DispAxisSampleTable y_table;
+};
+
+static void BuildDispAxisSampleTable(int src_len, int dst_len, DispAxisSampleTable &table)
+{
+  table.index0.resize(dst_len);
+  table.index1.resize(dst_len);
+  table.weight.resize(dst_len);
+
+  const float src_per_dst = static_cast<float>(src_len) / dst_len;
+  for (int d = 0; d < dst_len; ++d)
+  {
+    const float f  = (d + 0.5f) * src_per_dst - 0.5f;
+    int         i0 = static_cast<int>(std::floor(f));
+    float       w  = f - i0;
+    if (i0 < 0)
+    {
+      i0 = 0;
+      w  = 0.f;
+    }
+    if (i0 >= src_len - 1)
+    {
+      i0 = src_len - 1;
+      w  = 0.f;
+    }
+    table.index0[d] = i0;
+    table.index1[d] = std::min(i0 + 1, src_len - 1);
+    table.weight[d] = w;
+  }
+}
+
+static void InterpolateDispRowHorizontal(const float               *src_row,
+                                         const DispAxisSampleTable &x_table,
+                                         int                        dst_width,
+                                         float                     *dst_row)
+{
+  for (int x = 0; x < dst_width; ++x)
+  {
+    const float v0 = src_row[x_table.index0[x]];
+    const float v1 = src_row[x_table.index1[x]];
+    dst_row[x]     = v0 + x_table.weight[x] * (v1 - v0);
+  }
+}
+
+/**
+ * @brief dst = (row0 * (1 - w) + row1 * w) * scale
+ *
+ */
+static void BlendDispRowsVertical(const float *row0,
+                                  const float *row1,
+                                  float        w,
+                                  float        scale,
+                                  float       *dst,
+                                  int          len)
+{
+  const float w0 = (1.f - w) * scale;
+  const float w1 = w * scale;
+
+  int x = 0;
+#if CV_SIMD
+  using namespace cv;
+  const v_float32 v_w0 = vx_setall_f32(w0);
+  const v_float32 v_w1 = vx_setall_f32(w1);
+  for (; x <= len - v_float32::nlanes; x += v_float32::nlanes)
+  {
+    v_store(dst + x, v_muladd(vx_load(row0 + x), v_w0, vx_load(row1 + x) * v_w1));
+  }
+#endif
+  for (; x < len; ++x)
+  {
+    dst[x] = row0[x] * w0 + row1[x] * w1;
+  }
+}
+
+void StereoDispToOriginal(const float    *disp,
+                          int             disp_height,
+                          int             disp_width,
+                          const cv::Rect &valid_roi,
+                          int             dst_height,
+                          int             dst_width,
+                          cv::Mat        &dst,
+                          bool            rescale_disp)
+{
+  CHECK_STATE_THROW(disp != nullptr, "[StereoDispToOriginal] Got invalid disp ptr!");
+  CHECK_STATE_THROW(dst_height > 0 && dst_width > 0,
+                    "[StereoDispToOriginal] Got invalid dst size : %d x %d", dst_height, dst_width);
+
+  const cv::Rect roi = valid_roi.empty() ? cv::Rect(0, 0, disp_width, disp_height) : valid_roi;
+  CHECK_STATE_THROW((roi & cv::Rect(0, 0, disp_width, disp_height)) == roi,
+                    "[StereoDispToOriginal] valid roi {%d, %d, %d, %d} exceeds the %d x %d disp",
+                    roi.x, roi.y, roi.width, roi.height, disp_width, disp_height);
+
+  dst.create(dst_height, dst_width, CV_32FC1);
+
+  const float value_scale = rescale_disp ? static_cast<float>(dst_width) / roi.width : 1.f;
+  const float *src        = disp + static_cast<size_t>(roi.y) * disp_width + roi.x;
+
+  static thread_local DispToOriginalScratch scratch;
+  BuildDispAxisSampleTable(roi.width, dst_width, scratch.x_table);
+  BuildDispAxisSampleTable(roi.height, dst_height, scratch.y_table);
+  // the stripes run on other threads, they must see the tables of this one
+  const DispAxisSampleTable &x_table = scratch.x_table;
+  const DispAxisSampleTable &y_table = scratch.y_table;
+
+  // each stripe keeps two horizontally interpolated source rows, consecutive output rows of an
+  // upsampling mostly share them
+  auto func_process_rows = [&](const cv::Range &range) {
+    static thread_local std::vector<float> cached_rows;
+    cached_rows.resize(2 * static_cast<size_t>(dst_width));
+    int cached_row_idx[2] = {-1, -1};
+
+    auto func_get_row = [&](int src_y, int keep_slot) -> int {
+      for (int slot = 0; slot < 2; ++slot)
+      {
+        if (cached_row_idx[slot] == src_y)
+        {
+          return slot;
+        }
+      }
+      const int slot = keep_slot == 0 ? 1 : 0;
+      InterpolateDispRowHorizontal(src + static_cast<size_t>(src_y) * disp_width, x_table,
+                                   dst_width, cached_rows.data() + slot * dst_width);
+      cached_row_idx[slot] = src_y;
+      return slot;
+    };
+
+    for (int y = range.start; y < range.end; ++y)
+    {
+      const int y0 = y_table.index0[y];
+      const int y1 = y_table.index1[y];
+      // do not evict `y1` while fetching `y0`
+      const int keep  = cached_row_idx[0] == y1 ? 0 : (cached_row_idx[1] == y1 ? 1 : -1);
+      const int slot0 = func_get_row(y0, keep);
+      const int slot1 = func_get_row(y1, slot0);
+      BlendDispRowsVertical(cached_rows.data() + slot0 * dst_width,
+                            cached_rows.data() + slot1 * dst_width, y_table.weight[y],
+                            value_scale, dst.ptr<float>(y), dst_width);
+    }
+  };
+
+  // stripes of at least 64 rows, so the cached rows are reused enough
+  const double stripe_num = std::max(1, dst_height / 64);
+  cv::parallel_for_(cv::Range(0, dst_height), func_process_rows, stripe_num);
+}
+
+/**
+ * @brief One tile position along an axis, `margin` leading pixels of the crop are context only.
+ *
+ */
+struct StereoTileSpan {
+  int crop_start;
+  int crop_length;
+  int valid_start;
+  int valid_end;
+  int feather_begin;
+  int feather_end;
+};
+
+static std::vector<StereoTileSpan> BuildStereoTileSpans(int length,
+                                                        int tile,
+                                                        int overlap,
+                                                        int margin)
+{
+  std::vector<StereoTileSpan> spans;
+  if (length <= tile)
+  {
+    spans.push_back({0, length, 0, length, 0, 0});
+    return spans;
+  }
+
+  int crop_start = 0;
+  while (true)
+  {
+    // the last tile is moved back inside the image, it overlaps its neighbour more
+    crop_start            = std::min(crop_start, length - tile);
+    const int valid_start = crop_start == 0 ? 0 : crop_start + margin;
+    const int valid_end   = crop_start + tile;
+    spans.push_back({crop_start, tile, valid_start, valid_end, 0, 0});
+    if (valid_end >= length)
+    {
+      break;
+    }
+    crop_start = valid_end - overlap - margin;
+  }
+
+  for (size_t i = 1; i < spans.size(); ++i)
+  {
+    const int shared         = std::max(0, spans[i - 1].valid_end - spans[i].valid_start);
+    spans[i - 1].feather_end = std::min(shared, spans[i - 1].valid_end - spans[i - 1].valid_start);
+    spans[i].feather_begin   = std::min(shared, spans[i].valid_end - spans[i].valid_start);
+  }
+  return spans;
+}
+
+std::vector<StereoTile> BuildStereoTiles(int                        image_height,
+                                         int                        image_width,
+                                         const StereoTilingOptions &options)
+{
+  CHECK_STATE_THROW(image_height > 0 && image_width > 0,
+                    "[BuildStereoTiles] Got invalid image size : %d x %d", image_height,
+                    image_width);
+  CHECK_STATE_THROW(options.overlap >= 0 && options.max_disparity >= 0,
+                    "[BuildStereoTiles] Got negative overlap or max disparity");
+  CHECK_STATE_THROW(options.tile_width - options.max_disparity - options.overlap > 0 &&
+                        options.tile_height - options.overlap > 0,
+                    "[BuildStereoTiles] tile %d x %d is too small for overlap %d and max "
+                    "disparity %d",
+                    options.tile_height, options.tile_width, options.overlap,
+                    options.max_disparity);
+
+  const auto rows = BuildStereoTileSpans(image_height, options.tile_height, options.overlap, 0);
+  const auto cols = BuildStereoTileSpans(image_width, options.tile_width, options.overlap,
+                                         options.max_disparity);
+
+  std::vector<StereoTile> tiles;
+  tiles.reserve(rows.size() * cols.size());
+  for (const auto &row : rows)
+  {
+    for (const auto &col : cols)
+    {
+      StereoTile tile;
+      tile.crop  = cv::Rect(col.crop_start, row.crop_start, col.crop_length, row.crop_length);
+      tile.valid = cv::Rect(col.valid_start, row.valid_start, col.valid_end - col.valid_start,
+                            row.valid_end - row.valid_start);
+      tile.feather_left   = col.feather_begin;
+      tile.feather_right  = col.feather_end;
+      tile.feather_top    = row.feather_begin;
+      tile.feather_bottom = row.feather_end;
+      tiles.push_back(tile);
+    }
+  }
+  return tiles;
+}
+
+// weights of the `length` positions of a span, ramping over the feathered borders
+static void BuildStereoFeatherWeights(int                 length,
+                                      int                 feather_begin,
+                                      int                 feather_end,
+                                      std::vector<float> &weights)
+{
+  weights.assign(length, 1.f);
+  for (int i = 0; i < feather_begin; ++i)
+  {
+    weights[i] = (i + 0.5f) / feather_begin;
+  }
+  for (int i = 0; i < feather_end; ++i)
+  {
+    float &w = weights[length - 1 - i];
+    w        = std::min(w, (i + 0.5f) / feather_end);
+  }
+}
+
+void AccumulateStereoDispTile(const cv::Mat    &tile_disp,
+                              const StereoTile &tile,
+                              cv::Mat          &disp_sum,
+                              cv::Mat          &weight_sum)
+{
+  CHECK_STATE_THROW(tile_disp.type() == CV_32FC1 && tile_disp.rows == tile.crop.height &&
+                        tile_disp.cols == tile.crop.width,
+                    "[AccumulateStereoDispTile] expects a CV_32FC1 %d x %d tile disparity",
+                    tile.crop.height, tile.crop.width);
+  CHECK_STATE_THROW(disp_sum.type() == CV_32FC1 && weight_sum.type() == CV_32FC1 &&
+                        disp_sum.size() == weight_sum.size() &&
+                        (tile.valid & cv::Rect(0, 0, disp_sum.cols, disp_sum.rows)) == tile.valid,
+                    "[AccumulateStereoDispTile] Got invalid sum buffers");
+
+  std::vector<float> x_weights, y_weights;
+  BuildStereoFeatherWeights(tile.valid.width, tile.feather_left, tile.feather_right, x_weights);
+  BuildStereoFeatherWeights(tile.valid.height, tile.feather_top, tile.feather_bottom, y_weights);
+
+  const int offset_x = tile.valid.x - tile.crop.x;
+  const int offset_y = tile.valid.y - tile.crop.y;
+  for (int y = 0; y < tile.valid.height; ++y)
+  {
+    const float *src      = tile_disp.ptr<float>(offset_y + y) + offset_x;
+    float       *dst      = disp_sum.ptr<float>(tile.valid.y + y) + tile.valid.x;
+    float       *dst_w    = weight_sum.ptr<float>(tile.valid.y + y) + tile.valid.x;
+    const float  y_weight = y_weights[y];
+    for (int x = 0; x < tile.valid.width; ++x)
+    {
+      const float w = x_weights[x] * y_weight;
+      dst[x] += src[x] * w;
+      dst_w[x] += w;
+    }
+  }
+}
+
+} // namespace easy_deploy
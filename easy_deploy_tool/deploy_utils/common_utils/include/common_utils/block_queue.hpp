@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <optional>
@@ -34,12 +36,26 @@ public:
   template <typename U>
   bool CoverPush(U &&obj) noexcept;
 
+  /**
+   * @brief Same as above, the removed oldest element is moved into `evicted` instead of being
+   * destroyed under the lock of the queue.
+   */
+  template <typename U>
+  bool CoverPush(U &&obj, std::optional<T> &evicted) noexcept;
+
   /**
    * @brief Remove and return the front element. Will block if empty and not disabled/no more input.
    * Return std::nullopt if take is disabled, or no more input and queue is empty.
    */
   std::optional<T> Take() noexcept;
 
+  /**
+   * @brief Same as `Take`, but gives up at `deadline`.
+   * Return std::nullopt on timeout, if take is disabled, or no more input and queue is empty.
+   */
+  template <typename Clock, typename Duration>
+  std::optional<T> TakeUntil(const std::chrono::time_point<Clock, Duration> &deadline) noexcept;
+
   /**
    * @brief Remove and return front element if any; else return std::nullopt.
    */
@@ -98,6 +114,11 @@ public:
     return max_size_;
   }
 
+  /**
+   * @brief Return the largest size the queue has reached.
+   */
+  size_t GetHighWaterMark() noexcept;
+
   ~BlockQueue() noexcept
   {
     Disable();
@@ -106,6 +127,7 @@ public:
 private:
   size_t                  max_size_;
   std::queue<T>           q_;
+  size_t                  high_water_mark_{0};
   bool                    push_enabled_{true};
   bool                    take_enabled_{true};
   bool                    no_more_input_{false};
@@ -125,6 +147,7 @@ bool BlockQueue<T>::BlockPush(U &&obj) noexcept
   if (!push_enabled_)
     return false;
   q_.push(std::forward<U>(obj));
+  high_water_mark_ = std::max(high_water_mark_, q_.size());
   cv_consumer_.notify_one();
   return true;
 }
@@ -132,13 +155,25 @@ bool BlockQueue<T>::BlockPush(U &&obj) noexcept
 template <typename T>
 template <typename U>
 bool BlockQueue<T>::CoverPush(U &&obj) noexcept
+{
+  std::optional<T> evicted;
+  return CoverPush(std::forward<U>(obj), evicted);
+}
+
+template <typename T>
+template <typename U>
+bool BlockQueue<T>::CoverPush(U &&obj, std::optional<T> &evicted) noexcept
 {
   std::unique_lock<std::mutex> lk(mtx_);
   if (!push_enabled_)
     return false;
-  if (q_.size() == max_size_)
+  if (q_.size() >= max_size_ && !q_.empty())
+  {
+    evicted.emplace(std::move(q_.front()));
     q_.pop();
+  }
   q_.push(std::forward<U>(obj));
+  high_water_mark_ = std::max(high_water_mark_, q_.size());
   cv_consumer_.notify_one();
   return true;
 }
@@ -156,6 +191,22 @@ std::optional<T> BlockQueue<T>::Take() noexcept
   return obj;
 }
 
+template <typename T>
+template <typename Clock, typename Duration>
+std::optional<T> BlockQueue<T>::TakeUntil(
+    const std::chrono::time_point<Clock, Duration> &deadline) noexcept
+{
+  std::unique_lock<std::mutex> lk(mtx_);
+  cv_consumer_.wait_until(lk, deadline,
+                          [this] { return !q_.empty() || !take_enabled_ || no_more_input_; });
+  if (!take_enabled_ || q_.empty())
+    return std::nullopt;
+  T obj = std::move(q_.front());
+  q_.pop();
+  cv_producer_.notify_one();
+  return obj;
+}
+
 template <typename T>
 std::optional<T> BlockQueue<T>::TryTake() noexcept
 {
@@ -175,6 +226,13 @@ size_t BlockQueue<T>::Size() noexcept
   return q_.size();
 }
 
+template <typename T>
+size_t BlockQueue<T>::GetHighWaterMark() noexcept
+{
+  std::lock_guard<std::mutex> lk(mtx_);
+  return high_water_mark_;
+}
+
 template <typename T>
 bool BlockQueue<T>::Empty() noexcept
 {
@@ -196,11 +254,13 @@ void BlockQueue<T>::Disable() noexcept
 template <typename T>
 void BlockQueue<T>::DisableAndClear() noexcept
 {
+  // the elements are released after the lock, their destructors may touch the queue again
+  std::queue<T>               cleared;
   std::lock_guard<std::mutex> lk(mtx_);
   push_enabled_  = false;
   take_enabled_  = false;
   no_more_input_ = true;
-  while (!q_.empty()) q_.pop();
+  std::swap(cleared, q_);
   cv_producer_.notify_all();
   cv_consumer_.notify_all();
 }
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace easy_deploy {
+
+/**
+ * @brief A copy of the `LatencyHistogram` counters taken at one moment.
+ *
+ */
+struct LatencyHistogramSnapshot {
+  uint64_t              count  = 0;
+  uint64_t              sum_ns = 0;
+  uint64_t              min_ns = 0;
+  uint64_t              max_ns = 0;
+  std::vector<uint64_t> buckets;
+
+  double MeanNs() const noexcept
+  {
+    return count == 0 ? 0. : static_cast<double>(sum_ns) / count;
+  }
+
+  /**
+   * @brief Return the value at quantile `q` in [0, 1], within the relative error of the
+   * histogram.
+   */
+  uint64_t PercentileNs(double q) const noexcept;
+};
+
+/**
+ * @brief A lock-free log-linear latency histogram in the style of HdrHistogram. Values below
+ * `2^kSubBucketBits` ns are exact. Each power-of-two range above is split into
+ * `2^kSubBucketBits` linear sub-buckets, so recorded values keep a relative error below 1/16.
+ * Values beyond `2^kMaxExponent` ns (~18 min) fall into the last bucket.
+ *
+ * `Record` costs a few relaxed atomic operations and may be called from any number of threads.
+ */
+class LatencyHistogram {
+public:
+  static constexpr int    kSubBucketBits  = 4;
+  static constexpr int    kSubBucketCount = 1 << kSubBucketBits;
+  static constexpr int    kMaxExponent    = 40;
+  static constexpr size_t kBucketCount    = (kMaxExponent - kSubBucketBits + 2) * kSubBucketCount;
+
+  LatencyHistogram() = default;
+
+  LatencyHistogram(const LatencyHistogram &)            = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  void Record(uint64_t value_ns) noexcept
+  {
+    buckets_[BucketIndex(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(value_ns, std::memory_order_relaxed);
+
+    uint64_t cur_min = min_ns_.load(std::memory_order_relaxed);
+    while (value_ns < cur_min &&
+           !min_ns_.compare_exchange_weak(cur_min, value_ns, std::memory_order_relaxed))
+    {
+    }
+    uint64_t cur_max = max_ns_.load(std::memory_order_relaxed);
+    while (value_ns > cur_max &&
+           !max_ns_.compare_exchange_weak(cur_max, value_ns, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  /**
+   * @brief The counters are read one by one while writers may still record, so the snapshot is
+   * consistent only up to the records racing with it.
+   */
+  LatencyHistogramSnapshot Snapshot() const
+  {
+    LatencyHistogramSnapshot snapshot;
+    snapshot.buckets.resize(kBucketCount);
+    for (size_t i = 0; i < kBucketCount; ++i)
+    {
+      snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count  = count_.load(std::memory_order_relaxed);
+    snapshot.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+    snapshot.max_ns = max_ns_.load(std::memory_order_relaxed);
+    snapshot.min_ns = snapshot.count == 0 ? 0 : min_ns_.load(std::memory_order_relaxed);
+    return snapshot;
+  }
+
+  static size_t BucketIndex(uint64_t value) noexcept
+  {
+    if (value < static_cast<uint64_t>(kSubBucketCount))
+    {
+      return static_cast<size_t>(value);
+    }
+    const int exponent = 63 - __builtin_clzll(value);
+    if (exponent > kMaxExponent)
+    {
+      return kBucketCount - 1;
+    }
+    const size_t sub_index = (value >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+    return (exponent - kSubBucketBits + 1) * kSubBucketCount + sub_index;
+  }
+
+  /**
+   * @brief The largest value which falls into bucket `index`.
+   */
+  static uint64_t BucketUpperBound(size_t index) noexcept
+  {
+    if (index < static_cast<size_t>(kSubBucketCount))
+    {
+      return index;
+    }
+    const int      exponent  = index / kSubBucketCount + kSubBucketBits - 1;
+    const uint64_t sub_index = index % kSubBucketCount;
+    const uint64_t width     = uint64_t(1) << (exponent - kSubBucketBits);
+    return ((kSubBucketCount + sub_index) << (exponent - kSubBucketBits)) + width - 1;
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+  std::atomic<uint64_t>                           count_{0};
+  std::atomic<uint64_t>                           sum_ns_{0};
+  std::atomic<uint64_t>                           min_ns_{std::numeric_limits<uint64_t>::max()};
+  std::atomic<uint64_t>                           max_ns_{0};
+};
+
+inline uint64_t LatencyHistogramSnapshot::PercentileNs(double q) const noexcept
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+  q                     = std::min(std::max(q, 0.), 1.);
+  const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(q * count + 0.5));
+  uint64_t       acc    = 0;
+  for (size_t i = 0; i < buckets.size(); ++i)
+  {
+    acc += buckets[i];
+    if (acc >= target)
+    {
+      return std::min(std::max(LatencyHistogram::BucketUpperBound(i), min_ns), max_ns);
+    }
+  }
+  return max_ns;
+}
+
+} // namespace easy_deploy
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace easy_deploy {
+
+/**
+ * @brief A thread-safe cache of raw memory blocks, one free list per block size. Released blocks
+ * are kept for the next allocation of the same size instead of going back to the heap, so a
+ * steady per-frame allocation pattern stops hitting malloc after the first frames.
+ *
+ * A handful of distinct sizes is expected (one per pooled type), the lookup is linear.
+ */
+class RecyclingBlockPool {
+public:
+  /**
+   * @param max_cached_blocks the free blocks kept per size, the extra ones are freed
+   */
+  explicit RecyclingBlockPool(size_t max_cached_blocks = 256)
+      : max_cached_blocks_(max_cached_blocks)
+  {}
+
+  RecyclingBlockPool(const RecyclingBlockPool &)            = delete;
+  RecyclingBlockPool &operator=(const RecyclingBlockPool &) = delete;
+
+  void *Allocate(size_t size)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      auto                       *free_list = FindFreeList(size);
+      if (free_list != nullptr && !free_list->blocks.empty())
+      {
+        void *block = free_list->blocks.back();
+        free_list->blocks.pop_back();
+        return block;
+      }
+    }
+    return ::operator new(size);
+  }
+
+  void Deallocate(void *block, size_t size)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      auto                       *free_list = FindFreeList(size);
+      if (free_list == nullptr)
+      {
+        free_lists_.push_back({size, {}});
+        free_list = &free_lists_.back();
+        free_list->blocks.reserve(max_cached_blocks_);
+      }
+      if (free_list->blocks.size() < max_cached_blocks_)
+      {
+        free_list->blocks.push_back(block);
+        return;
+      }
+    }
+    ::operator delete(block);
+  }
+
+  ~RecyclingBlockPool()
+  {
+    for (auto &free_list : free_lists_)
+    {
+      for (void *block : free_list.blocks)
+      {
+        ::operator delete(block);
+      }
+    }
+  }
+
+private:
+  struct FreeList {
+    size_t              size;
+    std::vector<void *> blocks;
+  };
+
+  FreeList *FindFreeList(size_t size) noexcept
+  {
+    for (auto &free_list : free_lists_)
+    {
+      if (free_list.size == size)
+      {
+        return &free_list;
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  const size_t          max_cached_blocks_;
+  std::mutex            mtx_;
+  std::vector<FreeList> free_lists_;
+};
+
+/**
+ * @brief A standard allocator drawing single objects from a `RecyclingBlockPool`. Copies share
+ * the pool and keep it alive, so objects allocated through it may outlive their creator. Arrays
+ * fall back to the heap.
+ *
+ * Works with `std::allocate_shared`, `std::shared_ptr`'s allocator constructor and the
+ * `std::allocator_arg` constructor of `std::promise`.
+ */
+template <typename T>
+class PoolAllocator {
+public:
+  using value_type = T;
+
+  template <typename U>
+  friend class PoolAllocator;
+
+  explicit PoolAllocator(std::shared_ptr<RecyclingBlockPool> pool) noexcept
+      : pool_(std::move(pool))
+  {}
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U> &other) noexcept : pool_(other.pool_)
+  {}
+
+  T *allocate(size_t n)
+  {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "over-aligned types are not supported by PoolAllocator");
+    if (n != 1)
+    {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T *>(pool_->Allocate(sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t n) noexcept
+  {
+    if (n != 1)
+    {
+      ::operator delete(p);
+      return;
+    }
+    pool_->Deallocate(p, sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U> &other) const noexcept
+  {
+    return pool_ == other.pool_;
+  }
+
+  template <typename U>
+  bool operator!=(const PoolAllocator<U> &other) const noexcept
+  {
+    return pool_ != other.pool_;
+  }
+
+private:
+  std::shared_ptr<RecyclingBlockPool> pool_;
+};
+
+/**
+ * @brief `std::make_shared` with the object and its control block placed in a block recycled by
+ * `pool`. The object is constructed in place on every call and destroyed when the last
+ * reference is gone, so its constructor and destructor act as the acquire / reset hooks while
+ * the memory itself is reused.
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> MakePooledShared(const std::shared_ptr<RecyclingBlockPool> &pool,
+                                    Args &&...args)
+{
+  return std::allocate_shared<T>(PoolAllocator<T>(pool), std::forward<Args>(args)...);
+}
+
+} // namespace easy_deploy
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace easy_deploy {
+
+template <typename Signature, size_t kCapacity = 64>
+class SmallFunction;
+
+/**
+ * @brief A `std::function` replacement which stores callables up to `kCapacity` bytes inline.
+ * Larger callables fall back to the heap. Used on per-frame paths, where the small buffer of
+ * `std::function` (16 bytes in libstdc++) is too small for typical captures. Move-only callables
+ * are accepted too, copying a `SmallFunction` holding one throws `std::logic_error`.
+ *
+ * @tparam R
+ * @tparam Args
+ * @tparam kCapacity
+ */
+template <typename R, typename... Args, size_t kCapacity>
+class SmallFunction<R(Args...), kCapacity> {
+public:
+  SmallFunction() noexcept = default;
+
+  SmallFunction(std::nullptr_t) noexcept
+  {}
+
+  template <typename F,
+            typename = std::enable_if_t<!std::is_same<std::decay_t<F>, SmallFunction>::value &&
+                                        std::is_invocable_r<R, std::decay_t<F> &, Args...>::value>>
+  SmallFunction(F &&func)
+  {
+    using Functor_t = std::decay_t<F>;
+    if constexpr (std::is_pointer<Functor_t>::value ||
+                  std::is_member_pointer<Functor_t>::value)
+    {
+      if (func == nullptr)
+      {
+        return;
+      }
+    }
+    if constexpr (IsStoredInline<Functor_t>())
+    {
+      ::new (static_cast<void *>(&storage_)) Functor_t(std::forward<F>(func));
+      ops_ = &InlineOps<Functor_t>::kOps;
+    } else
+    {
+      *reinterpret_cast<Functor_t **>(&storage_) = new Functor_t(std::forward<F>(func));
+      ops_ = &HeapOps<Functor_t>::kOps;
+    }
+  }
+
+  SmallFunction(const SmallFunction &other)
+  {
+    if (other.ops_ != nullptr)
+    {
+      other.ops_->copy(&other.storage_, &storage_);
+      ops_ = other.ops_;
+    }
+  }
+
+  SmallFunction(SmallFunction &&other) noexcept
+  {
+    if (other.ops_ != nullptr)
+    {
+      other.ops_->move(&other.storage_, &storage_);
+      ops_       = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+
+  SmallFunction &operator=(const SmallFunction &other)
+  {
+    if (this != &other)
+    {
+      SmallFunction tmp(other);
+      *this = std::move(tmp);
+    }
+    return *this;
+  }
+
+  SmallFunction &operator=(SmallFunction &&other) noexcept
+  {
+    if (this != &other)
+    {
+      Reset();
+      if (other.ops_ != nullptr)
+      {
+        other.ops_->move(&other.storage_, &storage_);
+        ops_       = other.ops_;
+        other.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  SmallFunction &operator=(std::nullptr_t) noexcept
+  {
+    Reset();
+    return *this;
+  }
+
+  ~SmallFunction()
+  {
+    Reset();
+  }
+
+  R operator()(Args... args) const
+  {
+    if (ops_ == nullptr)
+    {
+      throw std::bad_function_call();
+    }
+    return ops_->invoke(&storage_, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return ops_ != nullptr;
+  }
+
+  friend bool operator==(const SmallFunction &func, std::nullptr_t) noexcept
+  {
+    return !func;
+  }
+
+  friend bool operator!=(const SmallFunction &func, std::nullptr_t) noexcept
+  {
+    return static_cast<bool>(func);
+  }
+
+private:
+  using Storage_t = std::aligned_storage_t<kCapacity, alignof(std::max_align_t)>;
+
+  struct Ops {
+    R (*invoke)(const Storage_t *, Args &&...);
+    void (*copy)(const Storage_t *, Storage_t *);
+    void (*move)(Storage_t *, Storage_t *) noexcept;
+    void (*destroy)(Storage_t *) noexcept;
+  };
+
+  template <typename Functor_t>
+  static constexpr bool IsStoredInline() noexcept
+  {
+    return sizeof(Functor_t) <= kCapacity && alignof(Functor_t) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible<Functor_t>::value;
+  }
+
+  template <typename Functor_t>
+  struct InlineOps {
+    static Functor_t *Get(const Storage_t *storage) noexcept
+    {
+      return const_cast<Functor_t *>(reinterpret_cast<const Functor_t *>(storage));
+    }
+    static R Invoke(const Storage_t *storage, Args &&...args)
+    {
+      return std::invoke(*Get(storage), std::forward<Args>(args)...);
+    }
+    static void Copy(const Storage_t *src, Storage_t *dst)
+    {
+      if constexpr (std::is_copy_constructible<Functor_t>::value)
+      {
+        ::new (static_cast<void *>(dst)) Functor_t(*Get(src));
+      } else
+      {
+        throw std::logic_error("[SmallFunction] the stored callable is move-only");
+      }
+    }
+    static void Move(Storage_t *src, Storage_t *dst) noexcept
+    {
+      ::new (static_cast<void *>(dst)) Functor_t(std::move(*Get(src)));
+      Get(src)->~Functor_t();
+    }
+    static void Destroy(Storage_t *storage) noexcept
+    {
+      Get(storage)->~Functor_t();
+    }
+    static constexpr Ops kOps{&Invoke, &Copy, &Move, &Destroy};
+  };
+
+  template <typename Functor_t>
+  struct HeapOps {
+    static Functor_t *Get(const Storage_t *storage) noexcept
+    {
+      return *reinterpret_cast<Functor_t *const *>(storage);
+    }
+    static R Invoke(const Storage_t *storage, Args &&...args)
+    {
+      return std::invoke(*Get(storage), std::forward<Args>(args)...);
+    }
+    static void Copy(const Storage_t *src, Storage_t *dst)
+    {
+      if constexpr (std::is_copy_constructible<Functor_t>::value)
+      {
+        *reinterpret_cast<Functor_t **>(dst) = new Functor_t(*Get(src));
+      } else
+      {
+        throw std::logic_error("[SmallFunction] the stored callable is move-only");
+      }
+    }
+    static void Move(Storage_t *src, Storage_t *dst) noexcept
+    {
+      *reinterpret_cast<Functor_t **>(dst) = Get(src);
+    }
+    static void Destroy(Storage_t *storage) noexcept
+    {
+      delete Get(storage);
+    }
+    static constexpr Ops kOps{&Invoke, &Copy, &Move, &Destroy};
+  };
+
+  void Reset() noexcept
+  {
+    if (ops_ != nullptr)
+    {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+private:
+  mutable Storage_t storage_;
+  const Ops        *ops_ = nullptr;
+};
+
+} // namespace easy_deploy
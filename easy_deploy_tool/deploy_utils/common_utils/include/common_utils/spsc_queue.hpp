@@ -0,0 +1,500 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace easy_deploy {
+
+namespace spsc_detail {
+
+constexpr size_t kCacheLineSize = 64;
+
+inline void CpuRelax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief Spin-then-sleep waiter. The waiting side spins for a short while and then sleeps on a
+ * futex, the notifying side only issues a syscall when someone is actually sleeping.
+ *
+ */
+class alignas(kCacheLineSize) HybridWaiter {
+public:
+  template <typename Pred>
+  void Wait(Pred &&pred) noexcept
+  {
+    // spinning only pays off when the other side runs on another core
+    static const bool multi_core = std::thread::hardware_concurrency() > 1;
+    for (int i = 0; multi_core && i < kSpinCount; ++i)
+    {
+      if (pred())
+        return;
+      CpuRelax();
+    }
+    for (int i = 0; multi_core && i < kYieldCount; ++i)
+    {
+      if (pred())
+        return;
+      std::this_thread::yield();
+    }
+    while (true)
+    {
+      const uint32_t seq = seq_.load(std::memory_order_seq_cst);
+      sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      if (pred())
+      {
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        return;
+      }
+      Sleep(seq);
+      sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+  }
+
+  /**
+   * @brief Same as `Wait`, but gives up at `deadline`. Return the last result of `pred`.
+   */
+  template <typename Pred>
+  bool WaitUntil(Pred &&pred, std::chrono::steady_clock::time_point deadline) noexcept
+  {
+    while (true)
+    {
+      const uint32_t seq = seq_.load(std::memory_order_seq_cst);
+      sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      if (pred())
+      {
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        return true;
+      }
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+      {
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        return false;
+      }
+      Sleep(seq, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now));
+      sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+  }
+
+  void Notify() noexcept
+  {
+    if (sleepers_.load(std::memory_order_seq_cst) > 0)
+    {
+      seq_.fetch_add(1, std::memory_order_seq_cst);
+      Wake();
+    }
+  }
+
+private:
+  void Sleep(uint32_t                 seq,
+             std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max()) noexcept
+  {
+#if defined(__linux__)
+    struct timespec ts;
+    const bool      has_timeout = timeout != std::chrono::nanoseconds::max();
+    if (has_timeout)
+    {
+      ts.tv_sec  = static_cast<time_t>(timeout.count() / 1000000000);
+      ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    }
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq_), FUTEX_WAIT_PRIVATE, seq,
+            has_timeout ? &ts : nullptr, nullptr, 0);
+#else
+    const auto start = std::chrono::steady_clock::now();
+    while (seq_.load(std::memory_order_seq_cst) == seq &&
+           std::chrono::steady_clock::now() - start < timeout)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+#endif
+  }
+
+  void Wake() noexcept
+  {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq_), FUTEX_WAKE_PRIVATE, INT32_MAX,
+            nullptr, nullptr, 0);
+#endif
+  }
+
+private:
+  static constexpr int kSpinCount  = 256;
+  static constexpr int kYieldCount = 16;
+
+  std::atomic<uint32_t> seq_{0};
+  std::atomic<int>      sleepers_{0};
+};
+
+/**
+ * @brief Marks one side of the queue as inside a call for its lifetime.
+ *
+ */
+class SideGuard {
+public:
+  explicit SideGuard(std::atomic<bool> &inside) noexcept : inside_(inside)
+  {
+    inside_.store(true, std::memory_order_seq_cst);
+  }
+
+  ~SideGuard()
+  {
+    inside_.store(false, std::memory_order_release);
+  }
+
+private:
+  std::atomic<bool> &inside_;
+};
+
+} // namespace spsc_detail
+
+/**
+ * @brief A bounded lock-free single-producer/single-consumer ring queue. It offers the same
+ * blocking semantics as `BlockQueue` for the subset of operations which make sense with exactly
+ * one producer thread and one consumer thread. The producer and consumer indices live on
+ * separate cache lines, and blocked sides spin briefly before sleeping on a futex.
+ *
+ * @note `BlockPush`/`TryPush` must only be called from one thread, `Take`/`TryTake` from one
+ * (other) thread. The control methods (`Disable*`, `SetNoMoreInput`) are safe from any thread.
+ * Every push/take call marks its side as inside the queue and checks the enable flag first, so
+ * `DisableAndClear` knows when nobody touches the slots any more.
+ */
+template <typename T>
+class SpscQueue {
+public:
+  explicit SpscQueue(size_t max_size) : max_size_(max_size == 0 ? 1 : max_size)
+  {
+    capacity_ = 1;
+    while (capacity_ < max_size_) capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    slots_.resize(capacity_);
+  }
+
+  SpscQueue(const SpscQueue &)            = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  /**
+   * @brief Push a obj into the queue. Will block the thread if the queue is full.
+   * Return false if push is disabled.
+   */
+  template <typename U>
+  bool BlockPush(U &&obj) noexcept
+  {
+    spsc_detail::SideGuard guard(producer_inside_);
+    if (!push_enabled_.load(std::memory_order_seq_cst))
+      return false;
+
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ >= max_size_)
+    {
+      not_full_.Wait([&]() {
+        cached_head_ = head_.load(std::memory_order_seq_cst);
+        return tail - cached_head_ < max_size_ || !push_enabled_.load(std::memory_order_acquire);
+      });
+    }
+    if (!push_enabled_.load(std::memory_order_acquire))
+      return false;
+
+    slots_[tail & mask_] = std::forward<U>(obj);
+    tail_.store(tail + 1, std::memory_order_seq_cst);
+    UpdateHighWaterMark(tail + 1 - cached_head_);
+    not_empty_.Notify();
+    return true;
+  }
+
+  /**
+   * @brief Push a obj into the queue if there is room for it.
+   * Return false if the queue is full or push is disabled.
+   */
+  template <typename U>
+  bool TryPush(U &&obj) noexcept
+  {
+    spsc_detail::SideGuard guard(producer_inside_);
+    if (!push_enabled_.load(std::memory_order_seq_cst))
+      return false;
+
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ >= max_size_)
+    {
+      cached_head_ = head_.load(std::memory_order_seq_cst);
+      if (tail - cached_head_ >= max_size_)
+        return false;
+    }
+    if (!push_enabled_.load(std::memory_order_acquire))
+      return false;
+
+    slots_[tail & mask_] = std::forward<U>(obj);
+    tail_.store(tail + 1, std::memory_order_seq_cst);
+    UpdateHighWaterMark(tail + 1 - cached_head_);
+    not_empty_.Notify();
+    return true;
+  }
+
+  /**
+   * @brief Remove and return the front element. Will block if empty and not disabled/no more input.
+   * Return std::nullopt if take is disabled, or no more input and queue is empty.
+   */
+  std::optional<T> Take() noexcept
+  {
+    spsc_detail::SideGuard guard(consumer_inside_);
+    if (!take_enabled_.load(std::memory_order_seq_cst))
+      return std::nullopt;
+
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ == head)
+    {
+      not_empty_.Wait([&]() {
+        if (!take_enabled_.load(std::memory_order_acquire))
+          return true;
+        // load the flag before the index, so the last element pushed before `SetNoMoreInput` is
+        // always observed
+        const bool no_more_input = no_more_input_.load(std::memory_order_seq_cst);
+        cached_tail_             = tail_.load(std::memory_order_seq_cst);
+        return cached_tail_ != head || no_more_input;
+      });
+    }
+    if (!take_enabled_.load(std::memory_order_acquire) || cached_tail_ == head)
+      return std::nullopt;
+
+    return PopFront(head);
+  }
+
+  /**
+   * @brief Same as `Take`, but gives up at `deadline`.
+   * Return std::nullopt on timeout, if take is disabled, or no more input and queue is empty.
+   */
+  template <typename Clock, typename Duration>
+  std::optional<T> TakeUntil(const std::chrono::time_point<Clock, Duration> &deadline) noexcept
+  {
+    spsc_detail::SideGuard guard(consumer_inside_);
+    if (!take_enabled_.load(std::memory_order_seq_cst))
+      return std::nullopt;
+
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ == head)
+    {
+      const auto steady_deadline = std::chrono::steady_clock::now() + (deadline - Clock::now());
+      not_empty_.WaitUntil(
+          [&]() {
+            if (!take_enabled_.load(std::memory_order_acquire))
+              return true;
+            const bool no_more_input = no_more_input_.load(std::memory_order_seq_cst);
+            cached_tail_             = tail_.load(std::memory_order_seq_cst);
+            return cached_tail_ != head || no_more_input;
+          },
+          std::chrono::time_point_cast<std::chrono::steady_clock::duration>(steady_deadline));
+    }
+    if (!take_enabled_.load(std::memory_order_acquire) || cached_tail_ == head)
+      return std::nullopt;
+
+    return PopFront(head);
+  }
+
+  /**
+   * @brief Remove and return front element if any; else return std::nullopt.
+   * Return std::nullopt as well if take is disabled.
+   */
+  std::optional<T> TryTake() noexcept
+  {
+    spsc_detail::SideGuard guard(consumer_inside_);
+    if (!take_enabled_.load(std::memory_order_seq_cst))
+      return std::nullopt;
+
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ == head)
+    {
+      cached_tail_ = tail_.load(std::memory_order_seq_cst);
+      if (cached_tail_ == head)
+        return std::nullopt;
+    }
+    return PopFront(head);
+  }
+
+  /**
+   * @brief Return current queue size.
+   */
+  size_t Size() const noexcept
+  {
+    const size_t head = head_.load(std::memory_order_acquire);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    return tail - head;
+  }
+
+  /**
+   * @brief Return if queue is empty.
+   */
+  bool Empty() const noexcept
+  {
+    return Size() == 0;
+  }
+
+  /**
+   * @brief Disable both push and take. Wake up all threads.
+   */
+  void Disable() noexcept
+  {
+    push_enabled_.store(false, std::memory_order_seq_cst);
+    take_enabled_.store(false, std::memory_order_seq_cst);
+    no_more_input_.store(true, std::memory_order_seq_cst);
+    NotifyAll();
+  }
+
+  /**
+   * @brief Disable both push/take and drop the queued elements. Wake up all threads. A producer
+   * or consumer which is inside a call leaves it without touching the slots, the elements are
+   * released once both sides are out.
+   */
+  void DisableAndClear() noexcept
+  {
+    Disable();
+    while (producer_inside_.load(std::memory_order_seq_cst) ||
+           consumer_inside_.load(std::memory_order_seq_cst))
+    {
+      std::this_thread::yield();
+    }
+
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    for (size_t head = head_.load(std::memory_order_acquire); head != tail; ++head)
+    {
+      slots_[head & mask_] = T();
+      head_.store(head + 1, std::memory_order_release);
+    }
+    cached_tail_ = tail;
+    cached_head_ = tail;
+  }
+
+  /**
+   * @brief Disable push only. Wake up producers.
+   */
+  void DisablePush() noexcept
+  {
+    push_enabled_.store(false, std::memory_order_seq_cst);
+    NotifyAll();
+  }
+
+  /**
+   * @brief Re-enable push.
+   */
+  void EnablePush() noexcept
+  {
+    push_enabled_.store(true, std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief Disable take only. Wake up consumers.
+   */
+  void DisableTake() noexcept
+  {
+    take_enabled_.store(false, std::memory_order_seq_cst);
+    NotifyAll();
+  }
+
+  /**
+   * @brief Re-enable take.
+   */
+  void EnableTake() noexcept
+  {
+    take_enabled_.store(true, std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief Set "NoMoreInput", consumer returns std::nullopt once the queue is drained.
+   */
+  void SetNoMoreInput() noexcept
+  {
+    no_more_input_.store(true, std::memory_order_seq_cst);
+    NotifyAll();
+  }
+
+  /**
+   * @brief Get max size.
+   */
+  size_t GetMaxSize() const noexcept
+  {
+    return max_size_;
+  }
+
+  /**
+   * @brief Return the largest size the queue has reached. Measured against the head index cached
+   * by the producer, so it may overestimate the real peak, never beyond `GetMaxSize()`.
+   */
+  size_t GetHighWaterMark() const noexcept
+  {
+    return high_water_mark_.load(std::memory_order_relaxed);
+  }
+
+  ~SpscQueue() noexcept
+  {
+    Disable();
+  }
+
+private:
+  std::optional<T> PopFront(size_t head) noexcept
+  {
+    T obj                = std::move(slots_[head & mask_]);
+    slots_[head & mask_] = T();
+    head_.store(head + 1, std::memory_order_seq_cst);
+    not_full_.Notify();
+    return obj;
+  }
+
+  // only called by the producer
+  void UpdateHighWaterMark(size_t size) noexcept
+  {
+    if (size > high_water_mark_.load(std::memory_order_relaxed))
+    {
+      high_water_mark_.store(size, std::memory_order_relaxed);
+    }
+  }
+
+  void NotifyAll() noexcept
+  {
+    not_empty_.Notify();
+    not_full_.Notify();
+  }
+
+private:
+  size_t         max_size_;
+  size_t         capacity_;
+  size_t         mask_;
+  std::vector<T> slots_;
+
+  // consumer side
+  alignas(spsc_detail::kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t            cached_tail_{0};
+  std::atomic<bool> consumer_inside_{false};
+
+  // producer side
+  alignas(spsc_detail::kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t              cached_head_{0};
+  std::atomic<size_t> high_water_mark_{0};
+  std::atomic<bool>   producer_inside_{false};
+
+  alignas(spsc_detail::kCacheLineSize) std::atomic<bool> push_enabled_{true};
+  std::atomic<bool> take_enabled_{true};
+  std::atomic<bool> no_more_input_{false};
+
+  spsc_detail::HybridWaiter not_empty_;
+  spsc_detail::HybridWaiter not_full_;
+};
+
+} // namespace easy_deploy
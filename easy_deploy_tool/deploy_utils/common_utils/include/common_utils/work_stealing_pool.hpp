@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common_utils/log.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief A fixed-size thread pool where every worker owns a task deque. A worker runs the tasks
+ * it submitted itself newest first, which keeps a chain of follow-up tasks on one warm core, and
+ * steals the oldest tasks of the other workers when it runs dry. Tasks submitted from outside the
+ * pool are spread round-robin. Exceptions thrown by a task are logged and swallowed.
+ *
+ * `Global()` returns the process-wide pool sized to the hardware, shared by all the pipelines
+ * which run on a thread pool.
+ *
+ */
+class WorkStealingThreadPool {
+public:
+  explicit WorkStealingThreadPool(size_t thread_num = 0)
+  {
+    if (thread_num == 0)
+    {
+      thread_num = std::thread::hardware_concurrency();
+    }
+    thread_num = thread_num == 0 ? 1 : thread_num;
+    for (size_t i = 0; i < thread_num; ++i)
+    {
+      worker_queues_.emplace_back(std::make_unique<WorkerQueue>());
+    }
+    workers_.reserve(thread_num);
+    for (size_t i = 0; i < thread_num; ++i)
+    {
+      workers_.emplace_back([this, i]() { WorkerEntry(i); });
+    }
+  }
+
+  WorkStealingThreadPool(const WorkStealingThreadPool &)            = delete;
+  WorkStealingThreadPool &operator=(const WorkStealingThreadPool &) = delete;
+
+  ~WorkStealingThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lck(sleep_mutex_);
+      stop_.store(true);
+    }
+    sleep_cv_.notify_all();
+    for (auto &worker : workers_)
+    {
+      if (worker.joinable())
+      {
+        worker.join();
+      }
+    }
+  }
+
+  /**
+   * @brief The process-wide pool. Users keep the returned pointer, so the pool outlives them
+   * even during static destruction.
+   *
+   * @return std::shared_ptr<WorkStealingThreadPool>
+   */
+  static std::shared_ptr<WorkStealingThreadPool> Global()
+  {
+    static std::shared_ptr<WorkStealingThreadPool> pool =
+        std::make_shared<WorkStealingThreadPool>();
+    return pool;
+  }
+
+  void Submit(std::function<void()> task)
+  {
+    const size_t index = current_pool_ == this
+                             ? current_index_
+                             : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                                   worker_queues_.size();
+    // counted before it becomes visible, a worker taking it right away must not wrap `pending_`
+    pending_.fetch_add(1);
+    {
+      std::lock_guard<std::mutex> lck(worker_queues_[index]->mutex);
+      worker_queues_[index]->tasks.push_back(std::move(task));
+    }
+    if (sleeping_.load() > 0)
+    {
+      std::lock_guard<std::mutex> lck(sleep_mutex_);
+      sleep_cv_.notify_one();
+    }
+  }
+
+  size_t GetThreadNum() const noexcept
+  {
+    return workers_.size();
+  }
+
+private:
+  struct WorkerQueue {
+    std::mutex                        mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  bool TryGetTask(size_t index, std::function<void()> &task)
+  {
+    // own tasks newest first
+    {
+      auto                       &queue = *worker_queues_[index];
+      std::lock_guard<std::mutex> lck(queue.mutex);
+      if (!queue.tasks.empty())
+      {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+      }
+    }
+    // steal the oldest task of the others
+    for (size_t i = 1; i < worker_queues_.size(); ++i)
+    {
+      auto                       &queue = *worker_queues_[(index + i) % worker_queues_.size()];
+      std::lock_guard<std::mutex> lck(queue.mutex);
+      if (!queue.tasks.empty())
+      {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void WorkerEntry(size_t index)
+  {
+    current_pool_  = this;
+    current_index_ = index;
+    while (true)
+    {
+      std::function<void()> task;
+      if (TryGetTask(index, task))
+      {
+        pending_.fetch_sub(1);
+        try
+        {
+          task();
+        } catch (const std::exception &e)
+        {
+          LOG_ERROR("[WorkStealingThreadPool] task threw : %s", e.what());
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lck(sleep_mutex_);
+      sleeping_.fetch_add(1);
+      sleep_cv_.wait(lck, [this]() { return stop_.load() || pending_.load() > 0; });
+      sleeping_.fetch_sub(1);
+      if (stop_.load() && pending_.load() == 0)
+      {
+        break;
+      }
+    }
+  }
+
+private:
+  std::vector<std::unique_ptr<WorkerQueue>> worker_queues_;
+  std::vector<std::thread>                  workers_;
+  std::atomic<size_t>                       next_queue_{0};
+
+  // `pending_` and `sleeping_` are sequentially consistent, a submitter either sees a sleeping
+  // worker or the worker sees the pending task before it goes to sleep
+  std::atomic<size_t>     pending_{0};
+  std::atomic<size_t>     sleeping_{0};
+  std::atomic<bool>       stop_{false};
+  std::mutex              sleep_mutex_;
+  std::condition_variable sleep_cv_;
+
+  static inline thread_local WorkStealingThreadPool *current_pool_  = nullptr;
+  static inline thread_local size_t                  current_index_ = 0;
+};
+
+} // namespace easy_deploy
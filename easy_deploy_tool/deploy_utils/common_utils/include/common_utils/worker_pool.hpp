@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "common_utils/block_queue.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief A small fixed-size pool of persistent worker threads. Tasks are executed in FIFO order.
+ * Useful for fork-join style parallelism inside a pipeline block, where spawning a thread per
+ * call would cost more than the work itself.
+ *
+ */
+class WorkerPool {
+public:
+  explicit WorkerPool(size_t worker_num = 1, size_t max_task_num = 64) : task_queue_(max_task_num)
+  {
+    worker_num = worker_num == 0 ? 1 : worker_num;
+    workers_.reserve(worker_num);
+    for (size_t i = 0; i < worker_num; ++i)
+    {
+      workers_.emplace_back([this]() { WorkerEntry(); });
+    }
+  }
+
+  WorkerPool(const WorkerPool &)            = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  /**
+   * @brief Submit a task to the pool. Exceptions thrown by the task are rethrown by
+   * `std::future::get`.
+   *
+   * @param task
+   * @return std::future<void> Invalid if the pool is already shut down.
+   */
+  std::future<void> Submit(std::function<void()> task)
+  {
+    auto              p_task = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> future = p_task->get_future();
+    if (!task_queue_.BlockPush([p_task]() { (*p_task)(); }))
+    {
+      return {};
+    }
+    return future;
+  }
+
+  size_t GetWorkerNum() const noexcept
+  {
+    return workers_.size();
+  }
+
+  ~WorkerPool()
+  {
+    task_queue_.SetNoMoreInput();
+    for (auto &worker : workers_)
+    {
+      if (worker.joinable())
+      {
+        worker.join();
+      }
+    }
+  }
+
+private:
+  void WorkerEntry()
+  {
+    while (true)
+    {
+      auto task = task_queue_.Take();
+      if (!task.has_value())
+      {
+        break;
+      }
+      task.value()();
+    }
+  }
+
+private:
+  BlockQueue<std::function<void()>> task_queue_;
+  std::vector<std::thread>          workers_;
+};
+
+} // namespace easy_deploy
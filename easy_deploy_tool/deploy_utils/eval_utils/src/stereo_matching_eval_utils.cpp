@@ -4,7 +4,9 @@
 #include "common_utils/progress_bar.hpp"
 #include "common_utils/fs_utils.hpp"
 
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 
 namespace easy_deploy {
 
@@ -103,39 +105,20 @@ void eval_accuracy_sceneflow_stereo_matching(const std::shared_ptr<BaseStereoMat
 
   model->InitPipeline();
 
-  BlockQueue<std::pair<std::shared_future<cv::Mat>, cv::Mat>> bq(100);
+  std::mutex              mtx;
+  std::condition_variable cv_done;
+  size_t                  total_pixels = 0;
+  double                  total_epe    = 0.0;
+  size_t                  done_num     = 0;
+  size_t                  failed_num   = 0;
 
-  auto func_producer = [&]() {
-    for (const auto &pathes : frame_pathes)
+  // the epe of a frame is accumulated on the pipeline output thread as soon as it is ready
+  auto accumulate_epe = [&](const cv::Mat &pred_disp, const cv::Mat &disp_gt) {
+    if (pred_disp.size() != disp_gt.size())
     {
-      const auto &[left_path, right_path, disp_gt_path] = pathes;
-      const auto [left_img, right_img, disp_gt] =
-          read_dataset_frame(left_path, right_path, disp_gt_path);
-
-      std::shared_future<cv::Mat> fut = model->ComputeDispAsync(left_img, right_img);
-      EVAL_STEREO_CHECK(fut.valid(), "Failed to call compute disp async API!");
-
-      bq.BlockPush(std::pair<std::shared_future<cv::Mat>, cv::Mat>{fut, disp_gt});
+      LOG_ERROR("Predicted/GT disp size mismatch!");
+      return false;
     }
-    bq.SetNoMoreInput();
-  };
-
-  std::thread producer_thread(func_producer);
-
-  size_t total_pixels = 0;
-  double total_epe    = 0.0;
-  size_t cur_idx      = 0;
-  while (true)
-  {
-    auto package = bq.Take();
-    if (!package.has_value())
-    {
-      break;
-    }
-
-    auto [fut, disp_gt] = package.value();
-    auto pred_disp      = fut.get();
-    EVAL_STEREO_CHECK(pred_disp.size() == disp_gt.size(), "Predicted/GT disp size mismatch!");
 
     cv::Mat1b mask = (disp_gt > 0) & (disp_gt < 192);
     cv::Mat1f mask_f;
@@ -147,20 +130,58 @@ void eval_accuracy_sceneflow_stereo_matching(const std::shared_ptr<BaseStereoMat
     double sum_epe         = cv::sum(abs_diff.mul(mask_f))[0];
     int    valid_pixel_num = cv::countNonZero(mask);
 
-    if (valid_pixel_num == 0)
-      continue;
-
+    std::lock_guard<std::mutex> lk(mtx);
     total_epe += sum_epe;
     total_pixels += valid_pixel_num;
-    cur_idx++;
-    progress_bar(cur_idx, frame_pathes.size());
+    return true;
+  };
+
+  // the callbacks reference the locals above, wait for the pushed frames even on failure
+  size_t pushed_num    = 0;
+  auto   wait_for_done = [&]() {
+    std::unique_lock<std::mutex> lk(mtx);
+    cv_done.wait(lk, [&]() { return done_num == pushed_num; });
+  };
+
+  try
+  {
+    for (const auto &pathes : frame_pathes)
+    {
+      const auto &[left_path, right_path, disp_gt_path] = pathes;
+      const auto [left_img, right_img, disp_gt] =
+          read_dataset_frame(left_path, right_path, disp_gt_path);
+
+      auto on_done = [&, disp_gt = disp_gt](PipelineStatus status, cv::Mat pred_disp) {
+        bool success = status == PIPELINE_SUCCESS && accumulate_epe(pred_disp, disp_gt);
+
+        std::lock_guard<std::mutex> lk(mtx);
+        failed_num += success ? 0 : 1;
+        progress_bar(++done_num, frame_pathes.size());
+        cv_done.notify_one();
+      };
+      {
+        // `on_done` may already run before `ComputeDispAsync` returns
+        std::lock_guard<std::mutex> lk(mtx);
+        ++pushed_num;
+      }
+      if (!model->ComputeDispAsync(left_img, right_img, std::move(on_done)))
+      {
+        std::lock_guard<std::mutex> lk(mtx);
+        --pushed_num;
+        EVAL_STEREO_CHECK(false, "Failed to call compute disp async API!");
+      }
+    }
+  } catch (...)
+  {
+    wait_for_done();
+    throw;
   }
+  wait_for_done();
+
+  EVAL_STEREO_CHECK(failed_num == 0, "%zu frames failed in the pipeline!", failed_num);
 
   double mean_epe = total_epe / total_pixels;
   std::cout << "\r\nFinished SceneFlow validation, EPE: " << mean_epe << std::endl;
-
-  bq.Disable();
-  producer_thread.join();
 }
 
 } // namespace easy_deploy
@@ -7,12 +7,65 @@ namespace easy_deploy {
 enum ImageProcessingPadMode { LETTER_BOX = 0, BOTTOM_RIGHT = 1, TOP_RIGHT = 2 };
 enum ImageProcessingPadValue { EDGE = 0, CONSTANT = 1 };
 
+/**
+ * @brief The resize/pad geometry which maps a source image into the destination tensor. The
+ * resized image of `fix_height x fix_width` is placed at (`left`, `top`) and the remaining area
+ * is padded.
+ *
+ */
+struct ImageProcessingGeometry {
+  float scale;
+  int   fix_height;
+  int   fix_width;
+  int   top;
+  int   bottom;
+  int   left;
+  int   right;
+};
+
+ImageProcessingGeometry ComputeImageProcessingGeometry(int                    src_height,
+                                                       int                    src_width,
+                                                       int                    dst_height,
+                                                       int                    dst_width,
+                                                       ImageProcessingPadMode pad_mode);
+
 class IImageProcessing {
 public:
+  /**
+   * @brief The geometry `Process` uses to map an image of `src_height x src_width` into a tensor
+   * of `dst_height x dst_width`. Postprocessing uses it to locate the valid area of the model
+   * output.
+   *
+   */
+  virtual ImageProcessingGeometry GetGeometry(int src_height,
+                                              int src_width,
+                                              int dst_height,
+                                              int dst_width) = 0;
+
   virtual float Process(std::shared_ptr<IPipelineImageData> input_image_data,
                         ITensor                            *tensor,
                         int                                 dst_height,
                         int                                 dst_width) = 0;
+
+  /**
+   * @brief Process a stereo pair into two tensors of the same size. Both views must share the
+   * same image size, the geometry of the left view is used for the right one. The default
+   * implementation processes the two views one after the other, implementations may override it
+   * to process them concurrently.
+   *
+   * @return float The transform scale of the pair.
+   */
+  virtual float ProcessPair(std::shared_ptr<IPipelineImageData> left_image_data,
+                            std::shared_ptr<IPipelineImageData> right_image_data,
+                            ITensor                            *left_tensor,
+                            ITensor                            *right_tensor,
+                            int                                 dst_height,
+                            int                                 dst_width)
+  {
+    const float scale = Process(left_image_data, left_tensor, dst_height, dst_width);
+    Process(right_image_data, right_tensor, dst_height, dst_width);
+    return scale;
+  }
 };
 
 class IImageProcessingFactory {
@@ -38,6 +91,30 @@ std::shared_ptr<IImageProcessingFactory> CreateCpuImageProcessingResizePadFactor
     const std::vector<float> &val          = {255, 255, 255},
     const std::vector<float> &pad_color    = {0, 0, 0});
 
+/**
+ * @brief Same behavior as `CreateCpuImageProcessingResizePad`, but resize, pad, channel flip,
+ * normalization and transpose are fused into a single SIMD pass which writes straight into the
+ * tensor buffer. Only 3-channel images are supported.
+ *
+ */
+std::shared_ptr<IImageProcessing> CreateCpuFusedImageProcessingResizePad(
+    ImageProcessingPadMode    pad_mode     = ImageProcessingPadMode::BOTTOM_RIGHT,
+    ImageProcessingPadValue   pad_value    = ImageProcessingPadValue::EDGE,
+    bool                      do_transpose = true,
+    bool                      do_norm      = true,
+    const std::vector<float> &mean         = {0, 0, 0},
+    const std::vector<float> &val          = {255, 255, 255},
+    const std::vector<float> &pad_color    = {0, 0, 0});
+
+std::shared_ptr<IImageProcessingFactory> CreateCpuFusedImageProcessingResizePadFactory(
+    ImageProcessingPadMode    pad_mode     = ImageProcessingPadMode::BOTTOM_RIGHT,
+    ImageProcessingPadValue   pad_value    = ImageProcessingPadValue::EDGE,
+    bool                      do_transpose = true,
+    bool                      do_norm      = true,
+    const std::vector<float> &mean         = {0, 0, 0},
+    const std::vector<float> &val          = {255, 255, 255},
+    const std::vector<float> &pad_color    = {0, 0, 0});
+
 
 std::shared_ptr<IImageProcessing> CreateCudaImageProcessingResizePad(
     ImageProcessingPadMode    pad_mode     = ImageProcessingPadMode::BOTTOM_RIGHT,
@@ -1,8 +1,60 @@
-#include <opencv2/highgui/highgui.hpp>
 #include "image_processing_utils/image_processing_utils.hpp"
+#include "common_utils/worker_pool.hpp"
+#include "deploy_core/debug_tap.hpp"
 
 namespace easy_deploy {
 
+ImageProcessingGeometry ComputeImageProcessingGeometry(int                    src_height,
+                                                       int                    src_width,
+                                                       int                    dst_height,
+                                                       int                    dst_width,
+                                                       ImageProcessingPadMode pad_mode)
+{
+  ImageProcessingGeometry geometry;
+
+  const float s_w = static_cast<float>(dst_width) / src_width;
+  const float s_h = static_cast<float>(dst_height) / src_height;
+
+  if (s_h < s_w)
+  {
+    geometry.fix_height = dst_height;
+    geometry.scale      = s_h;
+    geometry.fix_width  = static_cast<int>(src_width * geometry.scale);
+  } else
+  {
+    geometry.fix_width  = dst_width;
+    geometry.scale      = s_w;
+    geometry.fix_height = static_cast<int>(src_height * geometry.scale);
+  }
+
+  switch (pad_mode)
+  {
+    case LETTER_BOX:
+      geometry.top    = (dst_height - geometry.fix_height) / 2;
+      geometry.bottom = dst_height - geometry.fix_height - geometry.top;
+      geometry.left   = (dst_width - geometry.fix_width) / 2;
+      geometry.right  = dst_width - geometry.fix_width - geometry.left;
+      break;
+    case BOTTOM_RIGHT:
+      geometry.top    = 0;
+      geometry.bottom = dst_height - geometry.fix_height;
+      geometry.left   = 0;
+      geometry.right  = dst_width - geometry.fix_width;
+      break;
+    case TOP_RIGHT:
+      geometry.top    = dst_height - geometry.fix_height;
+      geometry.bottom = 0;
+      geometry.left   = 0;
+      geometry.right  = dst_width - geometry.fix_width;
+      break;
+    default:
+      throw std::runtime_error("[ImageProcessing] Unkown pad mode!");
+      break;
+  }
+
+  return geometry;
+}
+
 class ImageProcessingCpuResizePad : public IImageProcessing {
 public:
   ImageProcessingCpuResizePad(ImageProcessingPadMode    pad_mode,
@@ -13,12 +65,32 @@ public:
                               const std::vector<float> &val          = {255, 255, 255},
                               const std::vector<float> &pad_color    = {0, 0, 0});
 
+  ImageProcessingGeometry GetGeometry(int src_height,
+                                      int src_width,
+                                      int dst_height,
+                                      int dst_width) override
+  {
+    return ComputeImageProcessingGeometry(src_height, src_width, dst_height, dst_width, pad_mode_);
+  }
+
   float Process(std::shared_ptr<IPipelineImageData> input_image_data,
                 ITensor                            *tensor,
                 int                                 dst_height,
                 int                                 dst_width) override;
 
+  float ProcessPair(std::shared_ptr<IPipelineImageData> left_image_data,
+                    std::shared_ptr<IPipelineImageData> right_image_data,
+                    ITensor                            *left_tensor,
+                    ITensor                            *right_tensor,
+                    int                                 dst_height,
+                    int                                 dst_width) override;
+
 private:
+  void ProcessWithGeometry(std::shared_ptr<IPipelineImageData> input_image_data,
+                           ITensor                            *tensor,
+                           const ImageProcessingGeometry      &geometry,
+                           const char                         *debug_tap_scope);
+
   void FlipChannelsWithNorm(const cv::Mat &image, float *dst_ptr, bool flip);
   void FlipChannelsWithoutNorm(const cv::Mat &image, u_char *dst_ptr, bool flip);
   void TransposeAndFilpWithNorm(const cv::Mat &image, float *dst_ptr, bool flip);
@@ -30,6 +102,11 @@ private:
   const std::vector<float> mean_, val_;
   const bool               do_transpose_, do_norm_;
   const std::vector<float> pad_color_;
+
+  // runs the right view of `ProcessPair` while the calling thread processes the left one. Created
+  // by the first pair, the instances which only call `Process` own no thread
+  std::once_flag              worker_pool_once_;
+  std::unique_ptr<WorkerPool> worker_pool_;
 };
 
 ImageProcessingCpuResizePad::ImageProcessingCpuResizePad(ImageProcessingPadMode    pad_mode,
@@ -52,6 +129,65 @@ float ImageProcessingCpuResizePad::Process(std::shared_ptr<IPipelineImageData> i
                                            ITensor                            *tensor,
                                            int                                 dst_height,
                                            int                                 dst_width)
+{
+  const auto &image_data_info = input_image_data->GetImageDataInfo();
+  const auto  geometry =
+      ComputeImageProcessingGeometry(image_data_info.image_height, image_data_info.image_width,
+                                     dst_height, dst_width, pad_mode_);
+  ProcessWithGeometry(input_image_data, tensor, geometry, "preprocess");
+  return geometry.scale;
+}
+
+float ImageProcessingCpuResizePad::ProcessPair(std::shared_ptr<IPipelineImageData> left_image_data,
+                                               std::shared_ptr<IPipelineImageData> right_image_data,
+                                               ITensor                            *left_tensor,
+                                               ITensor                            *right_tensor,
+                                               int                                 dst_height,
+                                               int                                 dst_width)
+{
+  const auto &left_info  = left_image_data->GetImageDataInfo();
+  const auto &right_info = right_image_data->GetImageDataInfo();
+  CHECK_STATE_THROW(left_info.image_height == right_info.image_height &&
+                        left_info.image_width == right_info.image_width,
+                    "[ImageProcessingCpu] `ProcessPair` got views of different size!");
+
+  const auto geometry = ComputeImageProcessingGeometry(
+      left_info.image_height, left_info.image_width, dst_height, dst_width, pad_mode_);
+
+  // the right view runs on the worker thread, carry the debug tap frame over
+  const DebugTapFrame debug_frame        = DebugTap::CurrentFrame();
+  auto                func_process_right = [&]() {
+    DebugTapFrameScope tap_scope(debug_frame);
+    ProcessWithGeometry(right_image_data, right_tensor, geometry, "preprocess_right");
+  };
+  std::call_once(worker_pool_once_, [this]() { worker_pool_ = std::make_unique<WorkerPool>(1); });
+  auto right_future = worker_pool_->Submit(func_process_right);
+  if (!right_future.valid())
+  {
+    // the worker is shut down, process the views one after another
+    func_process_right();
+    ProcessWithGeometry(left_image_data, left_tensor, geometry, "preprocess_left");
+    return geometry.scale;
+  }
+  try
+  {
+    ProcessWithGeometry(left_image_data, left_tensor, geometry, "preprocess_left");
+  } catch (...)
+  {
+    // the right view still references `geometry` and the tensors
+    right_future.wait();
+    throw;
+  }
+  right_future.get();
+
+  return geometry.scale;
+}
+
+void ImageProcessingCpuResizePad::ProcessWithGeometry(
+    std::shared_ptr<IPipelineImageData> input_image_data,
+    ITensor                            *tensor,
+    const ImageProcessingGeometry      &geometry,
+    const char                         *debug_tap_scope)
 {
   // 0. Make sure read/write on the host-side memory buffer
   tensor->SetBufferLocation(DataLocation::HOST);
@@ -59,57 +195,17 @@ float ImageProcessingCpuResizePad::Process(std::shared_ptr<IPipelineImageData> i
   const auto &image_data_info = input_image_data->GetImageDataInfo();
   const int   image_height    = image_data_info.image_height;
   const int   image_width     = image_data_info.image_width;
-  int         fix_height, fix_width;
-  float       scale;
-
-  const float s_w = static_cast<float>(dst_width) / image_width;
-  const float s_h = static_cast<float>(dst_height) / image_height;
-
-  if (s_h < s_w)
-  {
-    fix_height = dst_height;
-    scale      = s_h;
-    fix_width  = static_cast<int>(image_width * scale);
-  } else
-  {
-    fix_width  = dst_width;
-    scale      = s_w;
-    fix_height = static_cast<int>(image_height * scale);
-  }
 
   // 2. rebuild the cv::Mat format image
   cv::Mat input_image(image_height, image_width, CV_8UC3, image_data_info.data_pointer);
-  cv::imwrite("input_image.png", input_image);
+  DebugTap::Publish(debug_tap_scope, "input_image", input_image);
   // 3. resize and padding to the left-top
   cv::Mat resized_image;
-  cv::resize(input_image, resized_image, {fix_width, fix_height});
-  cv::imwrite("resized_image.png", resized_image);
+  cv::resize(input_image, resized_image, {geometry.fix_width, geometry.fix_height});
+  DebugTap::Publish(debug_tap_scope, "resized_image", resized_image);
 
-  int top = 0, bottom = 0, left = 0, right = 0;
-  switch (pad_mode_)
-  {
-    case LETTER_BOX:
-      top    = (dst_height - fix_height) / 2;
-      bottom = dst_height - fix_height - top;
-      left   = (dst_width - fix_width) / 2;
-      right  = dst_width - fix_width - left;
-      break;
-    case BOTTOM_RIGHT:
-      top    = 0;
-      bottom = dst_height - fix_height;
-      left   = 0;
-      right  = dst_width - fix_width;
-      break;
-    case TOP_RIGHT:
-      top    = dst_height - fix_height;
-      bottom = 0;
-      left   = 0;
-      right  = dst_width - fix_width;
-      break;
-    default:
-      throw std::runtime_error("[ImageProcessingCpu] Unkown pad mode!");
-      break;
-  }
+  const int top = geometry.top, bottom = geometry.bottom;
+  const int left = geometry.left, right = geometry.right;
 
   cv::Mat dst_image;
   switch (pad_value_)
@@ -127,7 +223,7 @@ float ImageProcessingCpuResizePad::Process(std::shared_ptr<IPipelineImageData> i
       throw std::runtime_error("[ImageProcessingCpu] Unkown pad value!");
       break;
   }
-  cv::imwrite("dst_image.png", dst_image);
+  DebugTap::Publish(debug_tap_scope, "dst_image", dst_image);
   if (!do_transpose_)
   {
     // 4. flip and norm
@@ -151,8 +247,6 @@ float ImageProcessingCpuResizePad::Process(std::shared_ptr<IPipelineImageData> i
                                   image_data_info.format == ImageDataFormat::BGR);
     }
   }
-
-  return scale;
 }
 
 void ImageProcessingCpuResizePad::FlipChannelsWithNorm(const cv::Mat &image,
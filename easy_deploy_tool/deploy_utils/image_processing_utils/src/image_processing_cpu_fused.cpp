@@ -0,0 +1,507 @@
+#include "image_processing_utils/image_processing_utils.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "common_utils/worker_pool.hpp"
+#include "deploy_core/debug_tap.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief Bilinear sampling table along one axis of the destination tensor. Built with the same
+ * half-pixel mapping as `cv::resize(..., cv::INTER_LINEAR)`, with the padding folded in: a
+ * destination coordinate inside the pad region samples the nearest resized pixel (EDGE) or is
+ * marked as invalid (CONSTANT).
+ *
+ */
+struct FusedAxisSampleTable {
+  std::vector<int>     offset0;
+  std::vector<int>     offset1;
+  std::vector<float>   weight;
+  std::vector<uint8_t> valid;
+};
+
+/**
+ * @brief Per-thread scratch memory of the fused kernel, reused across calls so that the steady
+ * state does not allocate.
+ *
+ */
+struct FusedResizePadScratch {
+  FusedAxisSampleTable x_table;
+  FusedAxisSampleTable y_table;
+  // two cached horizontally interpolated source rows, planar in output channel order
+  std::vector<float> cached_rows;
+  int                cached_row_idx[2];
+  // planar output row used when the destination layout is not CHW float
+  std::vector<float> out_row;
+};
+
+static void BuildFusedAxisSampleTable(int                   src_len,
+                                      int                   resized_len,
+                                      int                   dst_len,
+                                      int                   pad_before,
+                                      bool                  pad_edge,
+                                      int                   offset_stride,
+                                      FusedAxisSampleTable &table)
+{
+  table.offset0.resize(dst_len);
+  table.offset1.resize(dst_len);
+  table.weight.resize(dst_len);
+  table.valid.resize(dst_len);
+
+  const float src_per_resized = static_cast<float>(src_len) / resized_len;
+  for (int d = 0; d < dst_len; ++d)
+  {
+    int        r      = d - pad_before;
+    const bool inside = r >= 0 && r < resized_len;
+    r                 = std::min(std::max(r, 0), resized_len - 1);
+
+    const float f  = (r + 0.5f) * src_per_resized - 0.5f;
+    int         i0 = static_cast<int>(std::floor(f));
+    float       w  = f - i0;
+    if (i0 < 0)
+    {
+      i0 = 0;
+      w  = 0.f;
+    }
+    if (i0 >= src_len - 1)
+    {
+      i0 = src_len - 1;
+      w  = 0.f;
+    }
+
+    table.offset0[d] = i0 * offset_stride;
+    table.offset1[d] = std::min(i0 + 1, src_len - 1) * offset_stride;
+    table.weight[d]  = w;
+    table.valid[d]   = (inside || pad_edge) ? 1 : 0;
+  }
+}
+
+/**
+ * @brief Interpolate one source row horizontally into three planar rows of `dst_width`
+ * elements, reordering channels by `channel_map`.
+ *
+ */
+static void InterpolateRowHorizontal(const u_char               *src_row,
+                                     const FusedAxisSampleTable &x_table,
+                                     const int                   channel_map[3],
+                                     const float                 pad_color[3],
+                                     int                         dst_width,
+                                     float                      *dst_planes)
+{
+  float *plane0 = dst_planes;
+  float *plane1 = dst_planes + dst_width;
+  float *plane2 = dst_planes + 2 * dst_width;
+
+  const int c0 = channel_map[0], c1 = channel_map[1], c2 = channel_map[2];
+  for (int x = 0; x < dst_width; ++x)
+  {
+    if (!x_table.valid[x])
+    {
+      plane0[x] = pad_color[0];
+      plane1[x] = pad_color[1];
+      plane2[x] = pad_color[2];
+      continue;
+    }
+    const u_char *p0 = src_row + x_table.offset0[x];
+    const u_char *p1 = src_row + x_table.offset1[x];
+    const float   w  = x_table.weight[x];
+    plane0[x]        = p0[c0] + w * (p1[c0] - p0[c0]);
+    plane1[x]        = p0[c1] + w * (p1[c1] - p0[c1]);
+    plane2[x]        = p0[c2] + w * (p1[c2] - p0[c2]);
+  }
+}
+
+/**
+ * @brief dst = (row0 * (1 - w) + row1 * w) * scale + bias
+ *
+ */
+static void BlendRowsVerticalWithNorm(const float *row0,
+                                      const float *row1,
+                                      float        w,
+                                      float        scale,
+                                      float        bias,
+                                      float       *dst,
+                                      int          len)
+{
+  int x = 0;
+#if CV_SIMD
+  using namespace cv;
+  const v_float32 v_w0    = vx_setall_f32(1.f - w);
+  const v_float32 v_w1    = vx_setall_f32(w);
+  const v_float32 v_scale = vx_setall_f32(scale);
+  const v_float32 v_bias  = vx_setall_f32(bias);
+  for (; x <= len - v_float32::nlanes; x += v_float32::nlanes)
+  {
+    const v_float32 v = v_muladd(vx_load(row0 + x), v_w0, vx_load(row1 + x) * v_w1);
+    v_store(dst + x, v_muladd(v, v_scale, v_bias));
+  }
+#endif
+  for (; x < len; ++x)
+  {
+    dst[x] = (row0[x] * (1.f - w) + row1[x] * w) * scale + bias;
+  }
+}
+
+static void InterleaveRowFloat(const float *planes, int width, float *dst)
+{
+  const float *plane0 = planes;
+  const float *plane1 = planes + width;
+  const float *plane2 = planes + 2 * width;
+
+  int x = 0;
+#if CV_SIMD
+  using namespace cv;
+  for (; x <= width - v_float32::nlanes; x += v_float32::nlanes)
+  {
+    v_store_interleave(dst + x * 3, vx_load(plane0 + x), vx_load(plane1 + x), vx_load(plane2 + x));
+  }
+#endif
+  for (; x < width; ++x)
+  {
+    dst[x * 3 + 0] = plane0[x];
+    dst[x * 3 + 1] = plane1[x];
+    dst[x * 3 + 2] = plane2[x];
+  }
+}
+
+/**
+ * @brief A single pass CPU implementation of `resize -> pad -> flip -> norm -> transpose`.
+ *
+ * Unlike `ImageProcessingCpuResizePad` it never materializes the resized or padded image. The
+ * destination tensor is produced row by row: each output row blends two horizontally
+ * interpolated source rows (cached, since consecutive output rows usually share them) and the
+ * vertical blend, the normalization and the planar store are done with OpenCV universal
+ * intrinsics.
+ *
+ */
+class ImageProcessingCpuFusedResizePad : public IImageProcessing {
+public:
+  ImageProcessingCpuFusedResizePad(ImageProcessingPadMode    pad_mode,
+                                   ImageProcessingPadValue   pad_value,
+                                   bool                      do_transpose = true,
+                                   bool                      do_norm      = true,
+                                   const std::vector<float> &mean         = {0, 0, 0},
+                                   const std::vector<float> &val          = {255, 255, 255},
+                                   const std::vector<float> &pad_color    = {0, 0, 0});
+
+  ImageProcessingGeometry GetGeometry(int src_height,
+                                      int src_width,
+                                      int dst_height,
+                                      int dst_width) override
+  {
+    return ComputeImageProcessingGeometry(src_height, src_width, dst_height, dst_width, pad_mode_);
+  }
+
+  float Process(std::shared_ptr<IPipelineImageData> input_image_data,
+                ITensor                            *tensor,
+                int                                 dst_height,
+                int                                 dst_width) override;
+
+  float ProcessPair(std::shared_ptr<IPipelineImageData> left_image_data,
+                    std::shared_ptr<IPipelineImageData> right_image_data,
+                    ITensor                            *left_tensor,
+                    ITensor                            *right_tensor,
+                    int                                 dst_height,
+                    int                                 dst_width) override;
+
+private:
+  void ProcessWithGeometry(std::shared_ptr<IPipelineImageData> input_image_data,
+                           ITensor                            *tensor,
+                           const ImageProcessingGeometry      &geometry,
+                           const char                         *debug_tap_scope);
+
+private:
+  ImageProcessingPadMode  pad_mode_;
+  ImageProcessingPadValue pad_value_;
+  const bool              do_transpose_, do_norm_;
+  float                   mean_[3], val_[3], pad_color_[3];
+
+  // runs the right view of `ProcessPair` while the calling thread processes the left one. Created
+  // by the first pair, the instances which only call `Process` own no thread
+  std::once_flag              worker_pool_once_;
+  std::unique_ptr<WorkerPool> worker_pool_;
+};
+
+ImageProcessingCpuFusedResizePad::ImageProcessingCpuFusedResizePad(
+    ImageProcessingPadMode    pad_mode,
+    ImageProcessingPadValue   pad_value,
+    bool                      do_transpose,
+    bool                      do_norm,
+    const std::vector<float> &mean,
+    const std::vector<float> &val,
+    const std::vector<float> &pad_color)
+    : pad_mode_(pad_mode), pad_value_(pad_value), do_transpose_(do_transpose), do_norm_(do_norm)
+{
+  CHECK_STATE_THROW(mean.size() == 3 && val.size() == 3,
+                    "[ImageProcessingCpuFused] `mean` and `val` should have 3 elements!");
+  for (int i = 0; i < 3; ++i)
+  {
+    CHECK_STATE_THROW(val[i] != 0.f, "[ImageProcessingCpuFused] Got zero `val` at channel %d!", i);
+    mean_[i]      = mean[i];
+    val_[i]       = val[i];
+    pad_color_[i] = pad_color.size() == 3 ? pad_color[i] : (pad_color.empty() ? 0 : pad_color[0]);
+  }
+}
+
+float ImageProcessingCpuFusedResizePad::Process(
+    std::shared_ptr<IPipelineImageData> input_image_data,
+    ITensor                            *tensor,
+    int                                 dst_height,
+    int                                 dst_width)
+{
+  const auto &image_data_info = input_image_data->GetImageDataInfo();
+  const auto  geometry =
+      ComputeImageProcessingGeometry(image_data_info.image_height, image_data_info.image_width,
+                                     dst_height, dst_width, pad_mode_);
+  ProcessWithGeometry(input_image_data, tensor, geometry, "preprocess");
+  return geometry.scale;
+}
+
+float ImageProcessingCpuFusedResizePad::ProcessPair(
+    std::shared_ptr<IPipelineImageData> left_image_data,
+    std::shared_ptr<IPipelineImageData> right_image_data,
+    ITensor                            *left_tensor,
+    ITensor                            *right_tensor,
+    int                                 dst_height,
+    int                                 dst_width)
+{
+  const auto &left_info  = left_image_data->GetImageDataInfo();
+  const auto &right_info = right_image_data->GetImageDataInfo();
+  CHECK_STATE_THROW(left_info.image_height == right_info.image_height &&
+                        left_info.image_width == right_info.image_width,
+                    "[ImageProcessingCpuFused] `ProcessPair` got views of different size!");
+
+  const auto geometry = ComputeImageProcessingGeometry(
+      left_info.image_height, left_info.image_width, dst_height, dst_width, pad_mode_);
+
+  // the right view runs on the worker thread, carry the debug tap frame over
+  const DebugTapFrame debug_frame        = DebugTap::CurrentFrame();
+  auto                func_process_right = [&]() {
+    DebugTapFrameScope tap_scope(debug_frame);
+    ProcessWithGeometry(right_image_data, right_tensor, geometry, "preprocess_right");
+  };
+  std::call_once(worker_pool_once_, [this]() { worker_pool_ = std::make_unique<WorkerPool>(1); });
+  auto right_future = worker_pool_->Submit(func_process_right);
+  if (!right_future.valid())
+  {
+    // the worker is shut down, process the views one after another
+    func_process_right();
+    ProcessWithGeometry(left_image_data, left_tensor, geometry, "preprocess_left");
+    return geometry.scale;
+  }
+  try
+  {
+    ProcessWithGeometry(left_image_data, left_tensor, geometry, "preprocess_left");
+  } catch (...)
+  {
+    // the right view still references `geometry` and the tensors
+    right_future.wait();
+    throw;
+  }
+  right_future.get();
+
+  return geometry.scale;
+}
+
+void ImageProcessingCpuFusedResizePad::ProcessWithGeometry(
+    std::shared_ptr<IPipelineImageData> input_image_data,
+    ITensor                            *tensor,
+    const ImageProcessingGeometry      &geometry,
+    const char                         *debug_tap_scope)
+{
+  // 0. Make sure read/write on the host-side memory buffer
+  tensor->SetBufferLocation(DataLocation::HOST);
+  const auto &image_data_info = input_image_data->GetImageDataInfo();
+  const int   image_height    = image_data_info.image_height;
+  const int   image_width     = image_data_info.image_width;
+  CHECK_STATE_THROW(image_data_info.image_channels == 3,
+                    "[ImageProcessingCpuFused] Only 3-channel images are supported, got %d!",
+                    image_data_info.image_channels);
+  DebugTap::Publish(debug_tap_scope, "input_image",
+                    cv::Mat(image_height, image_width, CV_8UC3, image_data_info.data_pointer));
+
+  // 1. the resize/pad geometry
+  const int  fix_height = geometry.fix_height, fix_width = geometry.fix_width;
+  const int  top = geometry.top, left = geometry.left;
+  const int  dst_height = top + fix_height + geometry.bottom;
+  const int  dst_width  = left + fix_width + geometry.right;
+  const bool pad_edge = pad_value_ == ImageProcessingPadValue::EDGE;
+
+  // 2. channel order and normalization factors, indexed by output channel
+  const bool flip           = image_data_info.format == ImageDataFormat::BGR;
+  const int  channel_map[3] = {flip ? 2 : 0, 1, flip ? 0 : 2};
+  float      norm_scale[3], norm_bias[3], pad_color[3], pad_value_normed[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    const int c         = channel_map[k];
+    norm_scale[k]       = do_norm_ ? 1.f / val_[c] : 1.f;
+    norm_bias[k]        = do_norm_ ? -mean_[c] / val_[c] : 0.f;
+    pad_color[k]        = pad_color_[c];
+    pad_value_normed[k] = pad_color[k] * norm_scale[k] + norm_bias[k];
+  }
+
+  // 3. sampling tables and scratch rows
+  static thread_local FusedResizePadScratch scratch;
+  BuildFusedAxisSampleTable(image_width, fix_width, dst_width, left, pad_edge, 3,
+                            scratch.x_table);
+  BuildFusedAxisSampleTable(image_height, fix_height, dst_height, top, pad_edge, 1,
+                            scratch.y_table);
+  const size_t row_elements = static_cast<size_t>(dst_width) * 3;
+  scratch.cached_rows.resize(row_elements * 2);
+  scratch.out_row.resize(row_elements);
+  scratch.cached_row_idx[0] = scratch.cached_row_idx[1] = -1;
+
+  const u_char *src        = image_data_info.data_pointer;
+  const size_t  src_step   = static_cast<size_t>(image_width) * 3;
+  const size_t  plane_size = static_cast<size_t>(dst_height) * dst_width;
+
+  auto func_get_row = [&](int src_row_idx) -> const float * {
+    for (int i = 0; i < 2; ++i)
+    {
+      if (scratch.cached_row_idx[i] == src_row_idx)
+      {
+        return scratch.cached_rows.data() + i * row_elements;
+      }
+    }
+    // replace the row which is not the most recently used one
+    const int slot = scratch.cached_row_idx[0] < scratch.cached_row_idx[1] ? 0 : 1;
+    float    *row  = scratch.cached_rows.data() + slot * row_elements;
+    InterpolateRowHorizontal(src + src_row_idx * src_step, scratch.x_table, channel_map, pad_color,
+                             dst_width, row);
+    scratch.cached_row_idx[slot] = src_row_idx;
+    return row;
+  };
+
+  // 4. one pass over the destination rows
+  float  *dst_float = tensor->Cast<float>();
+  u_char *dst_uchar = tensor->Cast<u_char>();
+  for (int y = 0; y < dst_height; ++y)
+  {
+    // planar output of this row, either straight into the tensor or into scratch
+    float *planes[3];
+    float *out_row = scratch.out_row.data();
+    for (int k = 0; k < 3; ++k)
+    {
+      planes[k] = (do_transpose_ && do_norm_) ? dst_float + k * plane_size + y * dst_width
+                                              : out_row + k * dst_width;
+    }
+
+    if (!scratch.y_table.valid[y])
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        std::fill(planes[k], planes[k] + dst_width, pad_value_normed[k]);
+      }
+    } else
+    {
+      const float *row0 = func_get_row(scratch.y_table.offset0[y]);
+      const float *row1 = func_get_row(scratch.y_table.offset1[y]);
+      for (int k = 0; k < 3; ++k)
+      {
+        BlendRowsVerticalWithNorm(row0 + k * dst_width, row1 + k * dst_width,
+                                  scratch.y_table.weight[y], norm_scale[k], norm_bias[k],
+                                  planes[k], dst_width);
+      }
+    }
+
+    if (do_transpose_ && do_norm_)
+    {
+      continue;
+    }
+    if (do_norm_)
+    {
+      InterleaveRowFloat(out_row, dst_width, dst_float + y * row_elements);
+    } else if (do_transpose_)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        u_char *dst_plane = dst_uchar + k * plane_size + y * dst_width;
+        for (int x = 0; x < dst_width; ++x)
+        {
+          dst_plane[x] = cv::saturate_cast<u_char>(planes[k][x]);
+        }
+      }
+    } else
+    {
+      u_char *dst_row = dst_uchar + y * row_elements;
+      for (int x = 0; x < dst_width; ++x)
+      {
+        dst_row[x * 3 + 0] = cv::saturate_cast<u_char>(planes[0][x]);
+        dst_row[x * 3 + 1] = cv::saturate_cast<u_char>(planes[1][x]);
+        dst_row[x * 3 + 2] = cv::saturate_cast<u_char>(planes[2][x]);
+      }
+    }
+  }
+
+  // the written tensor, planar layouts are captured with the channel planes stacked vertically
+  const int tensor_depth = do_norm_ ? CV_32F : CV_8U;
+  DebugTap::Publish(debug_tap_scope, "dst_tensor",
+                    do_transpose_ ? cv::Mat(3 * dst_height, dst_width, CV_MAKETYPE(tensor_depth, 1),
+                                            tensor->RawPtr())
+                                  : cv::Mat(dst_height, dst_width, CV_MAKETYPE(tensor_depth, 3),
+                                            tensor->RawPtr()));
+}
+
+std::shared_ptr<IImageProcessing> CreateCpuFusedImageProcessingResizePad(
+    ImageProcessingPadMode    pad_mode,
+    ImageProcessingPadValue   pad_value,
+    bool                      do_transpose,
+    bool                      do_norm,
+    const std::vector<float> &mean,
+    const std::vector<float> &val,
+    const std::vector<float> &pad_color)
+{
+  return std::make_shared<ImageProcessingCpuFusedResizePad>(pad_mode, pad_value, do_transpose,
+                                                            do_norm, mean, val, pad_color);
+}
+
+struct ImageProcessingCpuFusedResizePadParams {
+  ImageProcessingPadMode  pad_mode;
+  ImageProcessingPadValue pad_value;
+  bool                    do_transpose;
+  bool                    do_norm;
+  std::vector<float>      mean;
+  std::vector<float>      val;
+  std::vector<float>      pad_color;
+};
+
+class ImageProcessingCpuFusedResizePadFactory : public IImageProcessingFactory {
+public:
+  ImageProcessingCpuFusedResizePadFactory(const ImageProcessingCpuFusedResizePadParams &params)
+      : params_(params)
+  {}
+
+  std::shared_ptr<IImageProcessing> Create() override
+  {
+    return CreateCpuFusedImageProcessingResizePad(params_.pad_mode, params_.pad_value,
+                                                  params_.do_transpose, params_.do_norm,
+                                                  params_.mean, params_.val, params_.pad_color);
+  }
+
+private:
+  const ImageProcessingCpuFusedResizePadParams params_;
+};
+
+std::shared_ptr<IImageProcessingFactory> CreateCpuFusedImageProcessingResizePadFactory(
+    ImageProcessingPadMode    pad_mode,
+    ImageProcessingPadValue   pad_value,
+    bool                      do_transpose,
+    bool                      do_norm,
+    const std::vector<float> &mean,
+    const std::vector<float> &val,
+    const std::vector<float> &pad_color)
+{
+  ImageProcessingCpuFusedResizePadParams params;
+  params.pad_mode     = pad_mode;
+  params.pad_value    = pad_value;
+  params.do_transpose = do_transpose;
+  params.do_norm      = do_norm;
+  params.mean         = mean;
+  params.val          = val;
+  params.pad_color    = pad_color;
+
+  return std::make_shared<ImageProcessingCpuFusedResizePadFactory>(params);
+}
+
+} // namespace easy_deploy
@@ -39,6 +39,14 @@ public:
                                const std::vector<float> &val          = {255, 255, 255},
                                const std::vector<float> &pad_color    = {0, 0, 0});
 
+  ImageProcessingGeometry GetGeometry(int src_height,
+                                      int src_width,
+                                      int dst_height,
+                                      int dst_width) override
+  {
+    return ComputeImageProcessingGeometry(src_height, src_width, dst_height, dst_width, pad_mode_);
+  }
+
   float Process(std::shared_ptr<IPipelineImageData> input_image_data,
                 ITensor                            *tensor,
                 int                                 dst_height,
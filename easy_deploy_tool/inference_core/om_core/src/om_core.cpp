@@ -153,6 +153,8 @@ namespace easy_deploy {
         ret = aclmdlAddDatasetBuffer(output_dataset_, output_data);
         CHECK_STATE_THROW(ret == ACL_SUCCESS, "[ACL] Add output dataset buffer failed, err: %d", ret);
 
+        // 前处理与后处理均无需额外操作，流水线中跳过这两个阶段
+        SetTrivialStages(true, true);
         BaseInferCore::Init();
         LOG_DEBUG("ACL core initialized successfully");
     }
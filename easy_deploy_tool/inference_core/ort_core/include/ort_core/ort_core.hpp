@@ -3,6 +3,61 @@
 
 namespace easy_deploy {
 
+enum OrtGraphOptLevel {
+  OPT_DISABLE_ALL     = 0,
+  OPT_ENABLE_BASIC    = 1,
+  OPT_ENABLE_EXTENDED = 2,
+  OPT_ENABLE_ALL      = 99
+};
+
+enum OrtExecutionMode { EXECUTION_SEQUENTIAL = 0, EXECUTION_PARALLEL = 1 };
+
+/**
+ * @brief Session options of `OrtInferCore`. The defaults reproduce the behavior of the
+ * `num_threads` constructor.
+ *
+ */
+struct OrtInferCoreOptions {
+  OrtGraphOptLevel graph_opt_level = OrtGraphOptLevel::OPT_ENABLE_EXTENDED;
+  OrtExecutionMode execution_mode  = OrtExecutionMode::EXECUTION_SEQUENTIAL;
+  // 0 lets onnxruntime decide
+  int intra_op_num_threads = 0;
+  int inter_op_num_threads = 0;
+  // value of `session.intra_op_thread_affinities`, e.g. "1,2;3,4" pins the intra-op threads 1
+  // and 2 to cores 1,2 and 3,4. Empty means no pinning.
+  std::string intra_op_thread_affinities;
+  bool        allow_spinning       = true;
+  bool        enable_cpu_mem_arena = true;
+  bool        enable_mem_pattern   = true;
+  // directory of the on-disk optimized model cache. When set, the graph optimized on the first
+  // start is saved there and loaded on later starts instead of re-optimizing the onnx model.
+  // The artifacts are keyed by the host cpu as well, the directory may be shared between hosts.
+  // Empty disables the cache.
+  std::string optimized_model_cache_dir;
+  // run on the process-wide onnxruntime thread pools instead of per-session ones, so replicas do
+  // not oversubscribe the cores. The pools are created by the first core of the process, sized by
+  // its thread settings.
+  bool use_global_thread_pool = false;
+  // share the prepacked weights with the other cores loading the same model file
+  bool share_prepacked_weights = true;
+  // input sizes to run a model with a dynamic height and width at, the last two dims of the blobs.
+  // The buffers are allocated for the largest one, the algorithms pick a bucket per frame, see
+  // `SelectShapeBucket`. Empty keeps the shapes fixed.
+  std::vector<ShapeBucket> shape_buckets;
+};
+
+/**
+ * @brief Load `OrtInferCoreOptions` from a config file made of `key = value` lines, `#` starts a
+ * comment. Keys are the field names of `OrtInferCoreOptions`, `shape_buckets` is a comma separated
+ * list of `HEIGHTxWIDTH`. Fields which are not present keep the value they have in `options`.
+ *
+ * @param config_path
+ * @param options
+ * @return true
+ * @return false if the file could not be read or has an invalid line.
+ */
+bool LoadOrtInferCoreOptions(const std::string &config_path, OrtInferCoreOptions &options);
+
 std::shared_ptr<BaseInferCore> CreateOrtInferCore(
     const std::string                                             onnx_path,
     const std::unordered_map<std::string, std::vector<uint64_t>> &input_blobs_shape  = {},
@@ -15,4 +70,16 @@ std::shared_ptr<BaseInferCoreFactory> CreateOrtInferCoreFactory(
     const std::unordered_map<std::string, std::vector<uint64_t>> &output_blobs_shape = {},
     const int                                                     num_threads        = 0);
 
+std::shared_ptr<BaseInferCore> CreateOrtInferCore(
+    const std::string                                             onnx_path,
+    const std::unordered_map<std::string, std::vector<uint64_t>> &input_blobs_shape,
+    const std::unordered_map<std::string, std::vector<uint64_t>> &output_blobs_shape,
+    const OrtInferCoreOptions                                    &options);
+
+std::shared_ptr<BaseInferCoreFactory> CreateOrtInferCoreFactory(
+    const std::string                                             onnx_path,
+    const std::unordered_map<std::string, std::vector<uint64_t>> &input_blobs_shape,
+    const std::unordered_map<std::string, std::vector<uint64_t>> &output_blobs_shape,
+    const OrtInferCoreOptions                                    &options);
+
 } // namespace easy_deploy
@@ -143,4 +143,153 @@ public:
   std::unique_ptr<u_char[]> self_maintain_buffer_host_{nullptr};
 };
 
+/**
+ * @brief `BlobsTensor` of ort_core which caches an `Ort::IoBinding` of its blobs per session. A
+ * binding is only rebuilt when a blob changes its shape or its buffer (`SetShape`, `ZeroCopy`)
+ * after the binding was built. Since `MemBufferPool` recycles a fixed set of buffers, and the
+ * replicas of an `InferCorePool` each keep their own binding, steady-state inference runs without
+ * building any `Ort::Value`. At most `kMaxSessionBindings` sessions are kept, the least recently
+ * used one is replaced.
+ *
+ */
+class OrtBlobsTensor : public BlobsTensor {
+public:
+  OrtBlobsTensor(std::unordered_map<std::string, std::unique_ptr<ITensor>> &&tensor_map,
+                 const std::vector<std::string>                            &input_blobs_name,
+                 const std::vector<std::string>                            &output_blobs_name)
+      : BlobsTensor(std::move(tensor_map))
+  {
+    for (const auto &blob_name : input_blobs_name)
+    {
+      input_blobs_.push_back({dynamic_cast<OrtTensor *>(GetTensor(blob_name)), nullptr, {}});
+    }
+    for (const auto &blob_name : output_blobs_name)
+    {
+      output_blobs_.push_back({dynamic_cast<OrtTensor *>(GetTensor(blob_name)), nullptr, {}});
+    }
+  }
+
+  /**
+   * @brief Get the binding of this buffer on `session`, rebuild it if it is out of date.
+   *
+   */
+  Ort::IoBinding &GetBinding(Ort::Session &session, const Ort::MemoryInfo &mem_info)
+  {
+    auto &entry = GetSessionBinding(static_cast<OrtSession *>(session));
+    bool  stale = entry.binding == nullptr;
+    for (size_t i = 0; !stale && i < entry.input_blobs.size(); ++i)
+    {
+      stale = entry.input_blobs[i].IsStale();
+    }
+    for (size_t i = 0; !stale && i < entry.output_blobs.size(); ++i)
+    {
+      stale = entry.output_blobs[i].IsStale();
+    }
+
+    if (stale)
+    {
+      Rebind(entry, session, mem_info);
+    }
+    return *entry.binding;
+  }
+
+  /**
+   * @brief The number of sessions this buffer currently keeps a binding for.
+   *
+   */
+  size_t GetSessionBindingNum() const noexcept
+  {
+    return session_bindings_.size();
+  }
+
+  static constexpr size_t kMaxSessionBindings = 8;
+
+private:
+  struct BoundBlob {
+    OrtTensor          *tensor;
+    void               *bound_ptr;
+    std::vector<size_t> bound_shape;
+
+    bool IsStale() const
+    {
+      return tensor->buffer_on_host_ != bound_ptr || tensor->GetShape() != bound_shape;
+    }
+
+    Ort::Value CreateValue(const Ort::MemoryInfo &mem_info)
+    {
+      bound_ptr   = tensor->buffer_on_host_;
+      bound_shape = tensor->GetShape();
+      return Ort::Value::CreateTensor(mem_info, bound_ptr, tensor->GetTensorByteSize(),
+                                      reinterpret_cast<const int64_t *>(bound_shape.data()),
+                                      bound_shape.size(), tensor->tensor_data_type_);
+    }
+  };
+
+  // the binding on one session, with the buffers and shapes of the blobs it was built with
+  struct SessionBinding {
+    OrtSession                     *session{nullptr};
+    std::unique_ptr<Ort::IoBinding> binding{nullptr};
+    std::vector<BoundBlob>          input_blobs;
+    std::vector<BoundBlob>          output_blobs;
+    uint64_t                        last_use{0};
+  };
+
+  // a handful of sessions at most, a linear search is cheaper than a hash map
+  SessionBinding &GetSessionBinding(OrtSession *session)
+  {
+    ++use_count_;
+    SessionBinding *lru = nullptr;
+    for (auto &entry : session_bindings_)
+    {
+      if (entry.session == session)
+      {
+        entry.last_use = use_count_;
+        return entry;
+      }
+      lru = lru == nullptr || entry.last_use < lru->last_use ? &entry : lru;
+    }
+
+    if (session_bindings_.size() < kMaxSessionBindings)
+    {
+      session_bindings_.emplace_back();
+      lru = &session_bindings_.back();
+    }
+    lru->session      = session;
+    lru->binding      = nullptr;
+    lru->input_blobs  = input_blobs_;
+    lru->output_blobs = output_blobs_;
+    lru->last_use     = use_count_;
+    return *lru;
+  }
+
+  void Rebind(SessionBinding &entry, Ort::Session &session, const Ort::MemoryInfo &mem_info)
+  {
+    if (entry.binding == nullptr)
+    {
+      entry.binding = std::make_unique<Ort::IoBinding>(session);
+    } else
+    {
+      entry.binding->ClearBoundInputs();
+      entry.binding->ClearBoundOutputs();
+    }
+
+    // the binding holds a reference of the values, no need to keep them here
+    for (auto &blob : entry.input_blobs)
+    {
+      entry.binding->BindInput(blob.tensor->GetName().c_str(), blob.CreateValue(mem_info));
+    }
+    for (auto &blob : entry.output_blobs)
+    {
+      entry.binding->BindOutput(blob.tensor->GetName().c_str(), blob.CreateValue(mem_info));
+    }
+  }
+
+private:
+  // the blobs in binding order, copied into each new session binding
+  std::vector<BoundBlob>      input_blobs_;
+  std::vector<BoundBlob>      output_blobs_;
+  std::vector<SessionBinding> session_bindings_;
+  uint64_t                    use_count_{0};
+};
+
 } // namespace easy_deploy
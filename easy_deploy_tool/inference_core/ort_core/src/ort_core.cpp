@@ -1,6 +1,11 @@
 #include "ort_core/ort_core.hpp"
 
+#include <algorithm>
+#include <mutex>
+
 #include "ort_blob_buffer.hpp"
+#include "ort_env_registry.hpp"
+#include "ort_model_cache.hpp"
 
 namespace easy_deploy {
 
@@ -13,16 +18,56 @@ static const std::unordered_map<ONNXTensorElementDataType, size_t> map_tensor_ty
     {ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64, 8},
     {ONNXTensorElementDataType::ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64, 8}};
 
+static Ort::SessionOptions BuildSessionOptions(const OrtInferCoreOptions &options)
+{
+  Ort::SessionOptions session_options;
+  session_options.SetGraphOptimizationLevel(
+      static_cast<GraphOptimizationLevel>(options.graph_opt_level));
+  session_options.SetExecutionMode(options.execution_mode == OrtExecutionMode::EXECUTION_PARALLEL
+                                       ? ExecutionMode::ORT_PARALLEL
+                                       : ExecutionMode::ORT_SEQUENTIAL);
+  session_options.SetIntraOpNumThreads(options.intra_op_num_threads);
+  session_options.SetInterOpNumThreads(options.inter_op_num_threads);
+  if (!options.intra_op_thread_affinities.empty())
+  {
+    session_options.AddConfigEntry("session.intra_op_thread_affinities",
+                                   options.intra_op_thread_affinities.c_str());
+  }
+  // spin-waiting trades idle cpu for latency, turn it off when the cores are shared with the
+  // other pipeline blocks
+  const char *allow_spinning = options.allow_spinning ? "1" : "0";
+  session_options.AddConfigEntry("session.intra_op.allow_spinning", allow_spinning);
+  session_options.AddConfigEntry("session.inter_op.allow_spinning", allow_spinning);
+  if (options.enable_cpu_mem_arena)
+  {
+    session_options.EnableCpuMemArena();
+  } else
+  {
+    session_options.DisableCpuMemArena();
+  }
+  if (options.enable_mem_pattern)
+  {
+    session_options.EnableMemPattern();
+  } else
+  {
+    session_options.DisableMemPattern();
+  }
+  session_options.SetLogSeverityLevel(4);
+  return session_options;
+}
+
 class OrtInferCore : public BaseInferCore {
 public:
-  ~OrtInferCore() override = default;
+  ~OrtInferCore() override
+  {
+    // release the blobs buffers and their bindings before the session
+    BaseInferCore::Release();
+  }
 
   OrtInferCore(const std::string                                             onnx_path,
                const std::unordered_map<std::string, std::vector<uint64_t>> &input_blobs_shape,
                const std::unordered_map<std::string, std::vector<uint64_t>> &output_blobs_shape,
-               const int                                                     num_threads = 0);
-
-  OrtInferCore(const std::string onnx_path, const int num_threads = 0);
+               const OrtInferCoreOptions                                    &options);
 
   std::unique_ptr<BlobsTensor> AllocBlobsBuffer() override;
 
@@ -36,6 +81,13 @@ public:
     return "ort_core";
   }
 
+  std::vector<ShapeBucket> GetShapeBuckets() override
+  {
+    return shape_buckets_;
+  }
+
+  bool ApplyShapeBucket(BlobsTensor *buffer, const ShapeBucket &bucket) override;
+
 private:
   bool PreProcess(std::shared_ptr<IPipelinePackage> buffer) override;
 
@@ -43,37 +95,132 @@ private:
 
   bool PostProcess(std::shared_ptr<IPipelinePackage> buffer) override;
 
+  bool BatchInference(const std::vector<std::shared_ptr<IPipelinePackage>> &buffers,
+                      std::vector<bool>                                   &results) override;
+
 private:
+  // the positions of the dynamic height and width dims of a blob, -1 if static
+  struct BucketDims {
+    int height_dim = -1;
+    int width_dim  = -1;
+  };
+
+  void ResolveShapeBucketDims(const std::vector<ShapeBucket> &shape_buckets);
+
+  int64_t ResolveDynamicDim(const std::string &blob_name, size_t dim_index) const;
+
   std::unordered_map<std::string, std::vector<uint64_t>> ResolveModelInputInformation();
 
+  bool ResolveDynamicBatchSupport();
+
   std::unordered_map<std::string, std::vector<uint64_t>> ResolveModelOutputInformation();
 
   std::unordered_map<std::string, void *> map_blob2ptr_;
 
   std::shared_ptr<Ort::Env> ort_env_;
 
+  // must outlive `ort_session_`
+  std::shared_ptr<OrtPrepackedWeightsContainer> prepacked_weights_container_;
+
   std::shared_ptr<Ort::Session> ort_session_;
 
+  Ort::MemoryInfo memory_info_{nullptr};
+
   std::unordered_map<std::string, std::vector<uint64_t>> map_input_blob_name2shape_;
   std::unordered_map<std::string, std::vector<uint64_t>> map_output_blob_name2shape_;
+
+  // empty unless the model has a dynamic height and width and buckets are configured
+  std::vector<ShapeBucket>                    shape_buckets_;
+  ShapeBucket                                 largest_bucket_;
+  std::unordered_map<std::string, BucketDims> map_blob_name2bucket_dims_;
+
+  // whether all blobs of the model have a dynamic leading (batch) dimension
+  bool support_dynamic_batch_{false};
+  // staging buffers of the batched blobs, guarded by `batch_mutex_`
+  std::mutex                                           batch_mutex_;
+  std::unordered_map<std::string, std::vector<u_char>> batch_staging_buffers_;
 };
 
 OrtInferCore::OrtInferCore(
     const std::string                                             onnx_path,
     const std::unordered_map<std::string, std::vector<uint64_t>> &input_blobs_shape,
     const std::unordered_map<std::string, std::vector<uint64_t>> &output_blobs_shape,
-    const int                                                     num_threads)
+    const OrtInferCoreOptions                                    &options)
 {
   // onnxruntime session initialization
   LOG_DEBUG("start initializing onnxruntime session with onnx model {%s} ...", onnx_path.c_str());
-  ort_env_ = std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_ERROR, onnx_path.data());
-  Ort::SessionOptions session_options;
-  session_options.SetIntraOpNumThreads(num_threads);
-  session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
-  session_options.SetLogSeverityLevel(4);
-  ort_session_ = std::make_shared<Ort::Session>(*ort_env_, onnx_path.c_str(), session_options);
+  auto &env_registry = OrtEnvRegistry::Instance();
+  ort_env_           = env_registry.GetEnv(options);
+  const bool use_global_thread_pool =
+      options.use_global_thread_pool && env_registry.HasGlobalThreadPool();
+  if (options.share_prepacked_weights)
+  {
+    prepacked_weights_container_ = env_registry.GetPrepackedWeightsContainer(onnx_path);
+  }
+
+  auto func_create_session = [&](const std::string &model_path,
+                                 Ort::SessionOptions &session_options) {
+    if (use_global_thread_pool)
+    {
+      session_options.DisablePerSessionThreads();
+    }
+    if (prepacked_weights_container_ != nullptr)
+    {
+      return std::make_shared<Ort::Session>(*ort_env_, model_path.c_str(), session_options,
+                                            prepacked_weights_container_.get());
+    }
+    return std::make_shared<Ort::Session>(*ort_env_, model_path.c_str(), session_options);
+  };
+
+  Ort::SessionOptions session_options = BuildSessionOptions(options);
+
+  // the sessions only run on the cpu execution provider
+  OrtOptimizedModelCache model_cache(options.optimized_model_cache_dir, onnx_path,
+                                     static_cast<int>(options.graph_opt_level),
+                                     "CPUExecutionProvider");
+  if (model_cache.Hit())
+  {
+    // the cached graph is already optimized, skip the optimizers on load
+    Ort::SessionOptions cached_session_options = BuildSessionOptions(options);
+    cached_session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+    try
+    {
+      ort_session_ = func_create_session(model_cache.GetCachedModelPath(), cached_session_options);
+      LOG_DEBUG("loaded optimized model from cache : %s",
+                model_cache.GetCachedModelPath().c_str());
+    } catch (const Ort::Exception &e)
+    {
+      LOG_WARN("[ort_core] Failed to load cached optimized model {%s} : %s, rebuild it",
+               model_cache.GetCachedModelPath().c_str(), e.what());
+      model_cache.Invalidate();
+    }
+  }
+
+  if (ort_session_ == nullptr)
+  {
+    if (model_cache.Enabled())
+    {
+      session_options.SetOptimizedModelFilePath(model_cache.GetTempModelPath().c_str());
+    }
+    try
+    {
+      ort_session_ = func_create_session(onnx_path, session_options);
+    } catch (const Ort::Exception &)
+    {
+      model_cache.Discard();
+      throw;
+    }
+    if (model_cache.Enabled())
+    {
+      model_cache.Commit();
+    }
+  }
   LOG_DEBUG("successfully created onnxruntime session!");
 
+  memory_info_ =
+      Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtDeviceAllocator, OrtMemType::OrtMemTypeCPU);
+
+  ResolveShapeBucketDims(options.shape_buckets);
   map_input_blob_name2shape_ =
       input_blobs_shape.empty() ? ResolveModelInputInformation() : input_blobs_shape;
   map_output_blob_name2shape_ =
@@ -97,9 +244,148 @@ OrtInferCore::OrtInferCore(
   func_display_blobs_info(input_blobs_shape);
   func_display_blobs_info(output_blobs_shape);
 
+  support_dynamic_batch_ = ResolveDynamicBatchSupport();
+
+  // onnxruntime works on host memory, there is nothing to copy before or after inference
+  SetTrivialStages(true, true);
   BaseInferCore::Init();
 }
 
+void OrtInferCore::ResolveShapeBucketDims(const std::vector<ShapeBucket> &shape_buckets)
+{
+  if (shape_buckets.empty())
+  {
+    return;
+  }
+  for (const auto &bucket : shape_buckets)
+  {
+    CHECK_STATE_THROW(bucket.height > 0 && bucket.width > 0,
+                      "[ort_core] Got invalid shape bucket : %d x %d", bucket.height,
+                      bucket.width);
+  }
+
+  OrtAllocator *allocator    = nullptr;
+  bool allocator_init_status = Ort::GetApi().GetAllocatorWithDefaultOptions(&allocator) == nullptr;
+  CHECK_STATE_THROW(allocator_init_status, "[ort_core] Failed to get allocator!!!");
+
+  // only the last two dims follow the bucket, e.g. NCHW inputs and NHW or NCHW disparities
+  auto func_add_blob = [&](const std::string &blob_name, const std::vector<int64_t> &blob_shape) {
+    const int  rank = static_cast<int>(blob_shape.size());
+    BucketDims dims;
+    if (rank >= 2 && blob_shape[rank - 2] < 0)
+    {
+      dims.height_dim = rank - 2;
+    }
+    if (rank >= 1 && blob_shape[rank - 1] < 0)
+    {
+      dims.width_dim = rank - 1;
+    }
+    if (dims.height_dim >= 0 || dims.width_dim >= 0)
+    {
+      map_blob_name2bucket_dims_[blob_name] = dims;
+    }
+  };
+  for (size_t i = 0; i < ort_session_->GetInputCount(); ++i)
+  {
+    const auto blob_name = ort_session_->GetInputNameAllocated(i, allocator);
+    func_add_blob(blob_name.get(),
+                  ort_session_->GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape());
+  }
+  for (size_t i = 0; i < ort_session_->GetOutputCount(); ++i)
+  {
+    const auto blob_name = ort_session_->GetOutputNameAllocated(i, allocator);
+    func_add_blob(blob_name.get(),
+                  ort_session_->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape());
+  }
+
+  if (map_blob_name2bucket_dims_.empty())
+  {
+    LOG_WARN("[ort_core] the model has a static height and width, the shape buckets are ignored");
+    return;
+  }
+  shape_buckets_  = shape_buckets;
+  largest_bucket_ = *std::max_element(
+      shape_buckets_.begin(), shape_buckets_.end(), [](const ShapeBucket &a, const ShapeBucket &b) {
+        return static_cast<int64_t>(a.height) * a.width < static_cast<int64_t>(b.height) * b.width;
+      });
+  LOG_DEBUG("[ort_core] %ld shape buckets, buffers sized for %d x %d", shape_buckets_.size(),
+            largest_bucket_.height, largest_bucket_.width);
+}
+
+int64_t OrtInferCore::ResolveDynamicDim(const std::string &blob_name, size_t dim_index) const
+{
+  auto iter = map_blob_name2bucket_dims_.find(blob_name);
+  if (iter != map_blob_name2bucket_dims_.end())
+  {
+    // the buffers are sized for the largest bucket
+    if (iter->second.height_dim == static_cast<int>(dim_index))
+    {
+      return largest_bucket_.height;
+    }
+    if (iter->second.width_dim == static_cast<int>(dim_index))
+    {
+      return largest_bucket_.width;
+    }
+  }
+  // the dynamic batch dim of a bucketed model, a buffer holds one frame
+  if (!shape_buckets_.empty() && dim_index == 0)
+  {
+    return 1;
+  }
+  throw std::runtime_error(
+      "auto resolve onnx model failed! for blob shape < 0, please use explicit blob shape "
+      "constructor or shape buckets for a dynamic height and width!! blob : " +
+      blob_name);
+}
+
+bool OrtInferCore::ApplyShapeBucket(BlobsTensor *buffer, const ShapeBucket &bucket)
+{
+  CHECK_STATE(buffer != nullptr, "[ort_core] ApplyShapeBucket got invalid buffer!");
+  const bool known_bucket =
+      std::any_of(shape_buckets_.begin(), shape_buckets_.end(), [&](const ShapeBucket &b) {
+        return b.height == bucket.height && b.width == bucket.width;
+      });
+  CHECK_STATE(known_bucket, "[ort_core] ApplyShapeBucket got unknown bucket : %d x %d",
+              bucket.height, bucket.width);
+
+  for (const auto &p_name_dims : map_blob_name2bucket_dims_)
+  {
+    auto tensor = buffer->GetTensor(p_name_dims.first);
+    auto shape  = tensor->GetDefaultShape();
+    if (p_name_dims.second.height_dim >= 0)
+    {
+      shape[p_name_dims.second.height_dim] = bucket.height;
+    }
+    if (p_name_dims.second.width_dim >= 0)
+    {
+      shape[p_name_dims.second.width_dim] = bucket.width;
+    }
+    tensor->SetShape(shape);
+  }
+  return true;
+}
+
+bool OrtInferCore::ResolveDynamicBatchSupport()
+{
+  for (size_t i = 0; i < ort_session_->GetInputCount(); ++i)
+  {
+    const auto shape = ort_session_->GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+    if (shape.empty() || shape[0] >= 0)
+    {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < ort_session_->GetOutputCount(); ++i)
+  {
+    const auto shape = ort_session_->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+    if (shape.empty() || shape[0] >= 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
 std::unordered_map<std::string, std::vector<uint64_t>> OrtInferCore::ResolveModelInputInformation()
 {
   std::unordered_map<std::string, std::vector<uint64_t>> ret;
@@ -123,15 +409,10 @@ std::unordered_map<std::string, std::vector<uint64_t>> OrtInferCore::ResolveMode
     size_t      blob_element_size = 1;
     for (size_t i = 0; i < blob_shape.size(); ++i)
     {
-      if (blob_shape[i] < 0)
-      {
-        throw std::runtime_error(
-            "auto resolve onnx model failed! \
-                                        for blob shape < 0, please use explicit blob shape constructor!!");
-      }
-      s_blob_info += "\t" + std::to_string(blob_shape[i]);
-      blob_element_size *= blob_shape[i];
-      ret[s_blob_name].push_back(blob_shape[i]);
+      const int64_t dim = blob_shape[i] < 0 ? ResolveDynamicDim(s_blob_name, i) : blob_shape[i];
+      s_blob_info += "\t" + std::to_string(dim);
+      blob_element_size *= dim;
+      ret[s_blob_name].push_back(dim);
     }
     s_blob_info += "\ttotal elements: " + std::to_string(blob_element_size);
     LOG_DEBUG(s_blob_info.c_str());
@@ -163,15 +444,10 @@ std::unordered_map<std::string, std::vector<uint64_t>> OrtInferCore::ResolveMode
     size_t      blob_element_size = 1;
     for (size_t i = 0; i < blob_shape.size(); ++i)
     {
-      if (blob_shape[i] < 0)
-      {
-        throw std::runtime_error(
-            "auto resolve onnx model failed! \
-                                        for blob shape < 0, please use explicit blob shape constructor!!");
-      }
-      s_blob_info += "\t" + std::to_string(blob_shape[i]);
-      blob_element_size *= blob_shape[i];
-      ret[s_blob_name].push_back(blob_shape[i]);
+      const int64_t dim = blob_shape[i] < 0 ? ResolveDynamicDim(s_blob_name, i) : blob_shape[i];
+      s_blob_info += "\t" + std::to_string(dim);
+      blob_element_size *= dim;
+      ret[s_blob_name].push_back(dim);
     }
     s_blob_info += "\ttotal elements: " + std::to_string(blob_element_size);
     LOG_DEBUG(s_blob_info.c_str());
@@ -187,6 +463,8 @@ std::unique_ptr<BlobsTensor> OrtInferCore::AllocBlobsBuffer()
   CHECK_STATE_THROW(allocator_init_status, "[ort_core] Failed to get allocator!!!");
 
   std::unordered_map<std::string, std::unique_ptr<ITensor>> tensor_map;
+  std::vector<std::string>                                  input_blobs_name;
+  std::vector<std::string>                                  output_blobs_name;
 
   // input blobs
   const int input_blob_count = map_input_blob_name2shape_.size();
@@ -212,6 +490,7 @@ std::unique_ptr<BlobsTensor> OrtInferCore::AllocBlobsBuffer()
     tensor->buffer_on_host_            = tensor->self_maintain_buffer_host_.get();
     tensor->tensor_data_type_          = tensor_type;
 
+    input_blobs_name.push_back(s_blob_name);
     tensor_map.emplace(s_blob_name, std::move(tensor));
   }
 
@@ -239,10 +518,12 @@ std::unique_ptr<BlobsTensor> OrtInferCore::AllocBlobsBuffer()
     tensor->buffer_on_host_            = tensor->self_maintain_buffer_host_.get();
     tensor->tensor_data_type_          = tensor_type;
 
+    output_blobs_name.push_back(s_blob_name);
     tensor_map.emplace(s_blob_name, std::move(tensor));
   }
 
-  return std::make_unique<BlobsTensor>(std::move(tensor_map));
+  return std::make_unique<OrtBlobsTensor>(std::move(tensor_map), input_blobs_name,
+                                          output_blobs_name);
 }
 
 bool OrtInferCore::PreProcess(std::shared_ptr<IPipelinePackage> pipeline_unit)
@@ -257,9 +538,17 @@ bool OrtInferCore::Inference(std::shared_ptr<IPipelinePackage> pipeline_unit)
   auto blobs_tensor = pipeline_unit->GetInferBuffer();
   CHECK_STATE(blobs_tensor != nullptr, "[ort_core] Inference got invalid blobs_tensor!");
 
+  // buffers allocated by this core carry a cached binding
+  auto ort_blobs_tensor = dynamic_cast<OrtBlobsTensor *>(blobs_tensor);
+  if (ort_blobs_tensor != nullptr)
+  {
+    ort_session_->Run(Ort::RunOptions{nullptr},
+                      ort_blobs_tensor->GetBinding(*ort_session_, memory_info_));
+    return true;
+  }
+
   // 构造推理接口参数
-  auto mem_info =
-      Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtDeviceAllocator, OrtMemType::OrtMemTypeCPU);
+  const auto &mem_info = memory_info_;
 
   std::vector<const char *> input_blob_names;
   std::vector<const char *> output_blob_names;
@@ -306,14 +595,169 @@ bool OrtInferCore::PostProcess(std::shared_ptr<IPipelinePackage> buffer)
   return true;
 }
 
+bool OrtInferCore::BatchInference(const std::vector<std::shared_ptr<IPipelinePackage>> &buffers,
+                                  std::vector<bool>                                   &results)
+{
+  // the model was exported with a static batch dimension, run the packages one by one
+  if (!support_dynamic_batch_ || buffers.size() == 1)
+  {
+    return BaseInferCore::BatchInference(buffers, results);
+  }
+
+  const size_t               batch_size = buffers.size();
+  std::vector<BlobsTensor *> batch_blobs_tensor;
+  for (const auto &pipeline_unit : buffers)
+  {
+    CHECK_STATE(pipeline_unit != nullptr, "[ort_core] BatchInference got invalid pipeline_unit!");
+    auto blobs_tensor = pipeline_unit->GetInferBuffer();
+    CHECK_STATE(blobs_tensor != nullptr, "[ort_core] BatchInference got invalid blobs_tensor!");
+    batch_blobs_tensor.push_back(blobs_tensor);
+  }
+
+  // the batcher groups the packages by arrival, packages of different shape buckets can not share
+  // a run. They are split into one batch per shape, in the order of their first package. A failed
+  // sub batch only drops its own packages
+  if (!shape_buckets_.empty())
+  {
+    std::vector<std::vector<std::vector<size_t>>>               sub_batch_shapes;
+    std::vector<std::vector<std::shared_ptr<IPipelinePackage>>> sub_batches;
+    std::vector<std::vector<size_t>>                            sub_batch_indices;
+    for (size_t b = 0; b < batch_size; ++b)
+    {
+      std::vector<std::vector<size_t>> shapes;
+      for (const auto &p_name_shape : map_input_blob_name2shape_)
+      {
+        shapes.push_back(batch_blobs_tensor[b]->GetTensor(p_name_shape.first)->GetShape());
+      }
+      const size_t index =
+          std::find(sub_batch_shapes.begin(), sub_batch_shapes.end(), shapes) -
+          sub_batch_shapes.begin();
+      if (index == sub_batch_shapes.size())
+      {
+        sub_batch_shapes.push_back(std::move(shapes));
+        sub_batches.emplace_back();
+        sub_batch_indices.emplace_back();
+      }
+      sub_batches[index].push_back(buffers[b]);
+      sub_batch_indices[index].push_back(b);
+    }
+    if (sub_batches.size() > 1)
+    {
+      for (size_t i = 0; i < sub_batches.size(); ++i)
+      {
+        std::vector<bool> sub_results(sub_batches[i].size(), true);
+        bool              sub_success = false;
+        try
+        {
+          sub_success = BatchInference(sub_batches[i], sub_results);
+        } catch (const std::exception &e)
+        {
+          LOG_ERROR("[ort_core] BatchInference got exception on sub batch %ld : %s", i, e.what());
+        }
+        for (size_t j = 0; j < sub_batch_indices[i].size(); ++j)
+        {
+          results[sub_batch_indices[i][j]] = sub_success && sub_results[j];
+        }
+      }
+      return true;
+    }
+  }
+
+  std::lock_guard<std::mutex> lck(batch_mutex_);
+
+  const auto &mem_info = memory_info_;
+
+  // 1. build the batched blobs on the staging buffers, pack the inputs
+  auto func_build_batch_blobs =
+      [&](const std::unordered_map<std::string, std::vector<uint64_t>> &blobs_shape,
+          bool pack_inputs, std::vector<const char *> &blob_names,
+          std::vector<Ort::Value> &blob_values) -> bool {
+    for (const auto &p_name_shape : blobs_shape)
+    {
+      const auto &blob_name = p_name_shape.first;
+      auto first = dynamic_cast<OrtTensor *>(batch_blobs_tensor[0]->GetTensor(blob_name));
+      CHECK_STATE(first != nullptr, "[ort_core] BatchInference got invalid tensor : %s",
+                  blob_name.c_str());
+      const size_t byte_size = first->GetTensorByteSize();
+      auto        &staging   = batch_staging_buffers_[blob_name];
+      if (staging.size() < byte_size * batch_size)
+      {
+        staging.resize(byte_size * batch_size);
+      }
+
+      for (size_t b = 0; b < batch_size; ++b)
+      {
+        auto tensor = batch_blobs_tensor[b]->GetTensor(blob_name);
+        CHECK_STATE(tensor->GetShape() == first->GetShape(),
+                    "[ort_core] BatchInference got packages with different shapes on blob : %s",
+                    blob_name.c_str());
+        if (pack_inputs)
+        {
+          memcpy(staging.data() + b * byte_size, tensor->RawPtr(), byte_size);
+        }
+      }
+
+      std::vector<int64_t> batch_shape(first->GetShape().begin(), first->GetShape().end());
+      batch_shape[0] *= batch_size;
+      blob_names.push_back(first->GetName().c_str());
+      blob_values.push_back(Ort::Value::CreateTensor(
+          mem_info, staging.data(), byte_size * batch_size, batch_shape.data(),
+          batch_shape.size(), first->tensor_data_type_));
+    }
+    return true;
+  };
+
+  std::vector<const char *> input_blob_names;
+  std::vector<const char *> output_blob_names;
+  std::vector<Ort::Value>   input_blob_values;
+  std::vector<Ort::Value>   output_blob_values;
+  CHECK_STATE(func_build_batch_blobs(map_input_blob_name2shape_, true, input_blob_names,
+                                     input_blob_values),
+              "[ort_core] BatchInference failed to pack input blobs!");
+  CHECK_STATE(func_build_batch_blobs(map_output_blob_name2shape_, false, output_blob_names,
+                                     output_blob_values),
+              "[ort_core] BatchInference failed to build output blobs!");
+
+  // 2. run once on the whole batch
+  ort_session_->Run(Ort::RunOptions{nullptr}, input_blob_names.data(), input_blob_values.data(),
+                    input_blob_names.size(), output_blob_names.data(), output_blob_values.data(),
+                    output_blob_names.size());
+
+  // 3. scatter the outputs back to each package
+  for (const auto &p_name_shape : map_output_blob_name2shape_)
+  {
+    const auto  &blob_name = p_name_shape.first;
+    const auto  &staging   = batch_staging_buffers_[blob_name];
+    const size_t byte_size = batch_blobs_tensor[0]->GetTensor(blob_name)->GetTensorByteSize();
+    for (size_t b = 0; b < batch_size; ++b)
+    {
+      memcpy(batch_blobs_tensor[b]->GetTensor(blob_name)->RawPtr(),
+             staging.data() + b * byte_size, byte_size);
+    }
+  }
+
+  return true;
+}
+
 std::shared_ptr<BaseInferCore> CreateOrtInferCore(
     const std::string                                             onnx_path,
     const std::unordered_map<std::string, std::vector<uint64_t>> &input_blobs_shape,
     const std::unordered_map<std::string, std::vector<uint64_t>> &output_blobs_shape,
     const int                                                     num_threads)
+{
+  OrtInferCoreOptions options;
+  options.intra_op_num_threads = num_threads;
+  return CreateOrtInferCore(onnx_path, input_blobs_shape, output_blobs_shape, options);
+}
+
+std::shared_ptr<BaseInferCore> CreateOrtInferCore(
+    const std::string                                             onnx_path,
+    const std::unordered_map<std::string, std::vector<uint64_t>> &input_blobs_shape,
+    const std::unordered_map<std::string, std::vector<uint64_t>> &output_blobs_shape,
+    const OrtInferCoreOptions                                    &options)
 {
   return std::make_shared<OrtInferCore>(onnx_path, input_blobs_shape, output_blobs_shape,
-                                        num_threads);
+                                        options);
 }
 
 } // namespace easy_deploy
@@ -6,7 +6,7 @@ struct OrtInferCoreParams {
   std::string                                            onnx_path;
   std::unordered_map<std::string, std::vector<uint64_t>> input_blobs_shape;
   std::unordered_map<std::string, std::vector<uint64_t>> output_blobs_shape;
-  int                                                    num_threads;
+  OrtInferCoreOptions                                    options;
 };
 
 class OrtInferCoreFactory : public BaseInferCoreFactory {
@@ -17,7 +17,7 @@ public:
   std::shared_ptr<BaseInferCore> Create() override
   {
     return CreateOrtInferCore(params_.onnx_path, params_.input_blobs_shape,
-                              params_.output_blobs_shape, params_.num_threads);
+                              params_.output_blobs_shape, params_.options);
   }
 
 private:
@@ -34,7 +34,22 @@ std::shared_ptr<BaseInferCoreFactory> CreateOrtInferCoreFactory(
   params.onnx_path          = onnx_path;
   params.input_blobs_shape  = input_blobs_shape;
   params.output_blobs_shape = output_blobs_shape;
-  params.num_threads        = num_threads;
+  params.options.intra_op_num_threads = num_threads;
+
+  return std::make_shared<OrtInferCoreFactory>(params);
+}
+
+std::shared_ptr<BaseInferCoreFactory> CreateOrtInferCoreFactory(
+    const std::string                                             onnx_path,
+    const std::unordered_map<std::string, std::vector<uint64_t>> &input_blobs_shape,
+    const std::unordered_map<std::string, std::vector<uint64_t>> &output_blobs_shape,
+    const OrtInferCoreOptions                                    &options)
+{
+  OrtInferCoreParams params;
+  params.onnx_path          = onnx_path;
+  params.input_blobs_shape  = input_blobs_shape;
+  params.output_blobs_shape = output_blobs_shape;
+  params.options            = options;
 
   return std::make_shared<OrtInferCoreFactory>(params);
 }
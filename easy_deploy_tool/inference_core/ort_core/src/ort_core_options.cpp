@@ -0,0 +1,205 @@
+#include "ort_core/ort_core.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+
+namespace easy_deploy {
+
+static std::string TrimString(const std::string &str)
+{
+  const auto begin = str.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos)
+  {
+    return "";
+  }
+  const auto end = str.find_last_not_of(" \t\r\n");
+  return str.substr(begin, end - begin + 1);
+}
+
+static std::string ToLower(std::string str)
+{
+  std::transform(str.begin(), str.end(), str.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return str;
+}
+
+static bool ParseBool(const std::string &value, bool &ret)
+{
+  const std::string v = ToLower(value);
+  if (v == "1" || v == "true" || v == "on")
+  {
+    ret = true;
+    return true;
+  }
+  if (v == "0" || v == "false" || v == "off")
+  {
+    ret = false;
+    return true;
+  }
+  return false;
+}
+
+static bool ParseInt(const std::string &value, int &ret)
+{
+  try
+  {
+    size_t pos = 0;
+    ret        = std::stoi(value, &pos);
+    return pos == value.size();
+  } catch (const std::exception &)
+  {
+    return false;
+  }
+}
+
+static bool ParseGraphOptLevel(const std::string &value, OrtGraphOptLevel &ret)
+{
+  const std::string v = ToLower(value);
+  if (v == "disable_all" || v == "0")
+  {
+    ret = OrtGraphOptLevel::OPT_DISABLE_ALL;
+  } else if (v == "basic" || v == "1")
+  {
+    ret = OrtGraphOptLevel::OPT_ENABLE_BASIC;
+  } else if (v == "extended" || v == "2")
+  {
+    ret = OrtGraphOptLevel::OPT_ENABLE_EXTENDED;
+  } else if (v == "all" || v == "99")
+  {
+    ret = OrtGraphOptLevel::OPT_ENABLE_ALL;
+  } else
+  {
+    return false;
+  }
+  return true;
+}
+
+static bool ParseExecutionMode(const std::string &value, OrtExecutionMode &ret)
+{
+  const std::string v = ToLower(value);
+  if (v == "sequential" || v == "0")
+  {
+    ret = OrtExecutionMode::EXECUTION_SEQUENTIAL;
+  } else if (v == "parallel" || v == "1")
+  {
+    ret = OrtExecutionMode::EXECUTION_PARALLEL;
+  } else
+  {
+    return false;
+  }
+  return true;
+}
+
+// e.g. "256x512, 320x640"
+static bool ParseShapeBuckets(const std::string &value, std::vector<ShapeBucket> &ret)
+{
+  std::vector<ShapeBucket> buckets;
+  size_t                   begin = 0;
+  while (begin <= value.size())
+  {
+    size_t end = value.find(',', begin);
+    end        = end == std::string::npos ? value.size() : end;
+
+    const std::string item  = ToLower(TrimString(value.substr(begin, end - begin)));
+    const auto        x_pos = item.find('x');
+    ShapeBucket       bucket;
+    if (x_pos == std::string::npos || !ParseInt(TrimString(item.substr(0, x_pos)), bucket.height) ||
+        !ParseInt(TrimString(item.substr(x_pos + 1)), bucket.width) || bucket.height <= 0 ||
+        bucket.width <= 0)
+    {
+      return false;
+    }
+    buckets.push_back(bucket);
+    begin = end + 1;
+  }
+  ret = std::move(buckets);
+  return true;
+}
+
+bool LoadOrtInferCoreOptions(const std::string &config_path, OrtInferCoreOptions &options)
+{
+  std::ifstream config_file(config_path);
+  if (!config_file.is_open())
+  {
+    LOG_ERROR("[ort_core] Failed to open options config file : %s", config_path.c_str());
+    return false;
+  }
+
+  const std::unordered_map<std::string, std::function<bool(const std::string &)>> parsers{
+      {"graph_opt_level",
+       [&](const std::string &v) { return ParseGraphOptLevel(v, options.graph_opt_level); }},
+      {"execution_mode",
+       [&](const std::string &v) { return ParseExecutionMode(v, options.execution_mode); }},
+      {"intra_op_num_threads",
+       [&](const std::string &v) { return ParseInt(v, options.intra_op_num_threads); }},
+      {"inter_op_num_threads",
+       [&](const std::string &v) { return ParseInt(v, options.inter_op_num_threads); }},
+      {"intra_op_thread_affinities",
+       [&](const std::string &v) {
+         options.intra_op_thread_affinities = v;
+         return true;
+       }},
+      {"allow_spinning",
+       [&](const std::string &v) { return ParseBool(v, options.allow_spinning); }},
+      {"enable_cpu_mem_arena",
+       [&](const std::string &v) { return ParseBool(v, options.enable_cpu_mem_arena); }},
+      {"enable_mem_pattern",
+       [&](const std::string &v) { return ParseBool(v, options.enable_mem_pattern); }},
+      {"use_global_thread_pool",
+       [&](const std::string &v) { return ParseBool(v, options.use_global_thread_pool); }},
+      {"share_prepacked_weights",
+       [&](const std::string &v) { return ParseBool(v, options.share_prepacked_weights); }},
+      {"shape_buckets",
+       [&](const std::string &v) { return ParseShapeBuckets(v, options.shape_buckets); }},
+      {"optimized_model_cache_dir",
+       [&](const std::string &v) {
+         options.optimized_model_cache_dir = v;
+         return true;
+       }},
+  };
+
+  std::string line;
+  int         line_index = 0;
+  while (std::getline(config_file, line))
+  {
+    ++line_index;
+    const auto comment_pos = line.find('#');
+    if (comment_pos != std::string::npos)
+    {
+      line = line.substr(0, comment_pos);
+    }
+    line = TrimString(line);
+    if (line.empty())
+    {
+      continue;
+    }
+
+    const auto eq_pos = line.find('=');
+    if (eq_pos == std::string::npos)
+    {
+      LOG_ERROR("[ort_core] %s:%d expect `key = value`, got : %s", config_path.c_str(),
+                line_index, line.c_str());
+      return false;
+    }
+    const std::string key   = TrimString(line.substr(0, eq_pos));
+    const std::string value = TrimString(line.substr(eq_pos + 1));
+
+    if (parsers.find(key) == parsers.end())
+    {
+      LOG_ERROR("[ort_core] %s:%d unknown option : %s", config_path.c_str(), line_index,
+                key.c_str());
+      return false;
+    }
+    if (!parsers.at(key)(value))
+    {
+      LOG_ERROR("[ort_core] %s:%d invalid value of option {%s} : %s", config_path.c_str(),
+                line_index, key.c_str(), value.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace easy_deploy
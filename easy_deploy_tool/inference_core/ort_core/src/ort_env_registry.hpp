@@ -0,0 +1,110 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <onnxruntime_cxx_api.h>
+
+#include "common_utils/log.hpp"
+#include "ort_core/ort_core.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief Process-wide registry of the onnxruntime objects shared by all `OrtInferCore`
+ * instances : the `Ort::Env` and the prepacked weights containers.
+ *
+ * onnxruntime keeps a single env per process, so whether it owns global thread pools is decided
+ * by the first core which creates it. Everything is held by weak references, the env and the
+ * containers are released with the last core using them.
+ */
+class OrtEnvRegistry {
+public:
+  static OrtEnvRegistry &Instance()
+  {
+    static OrtEnvRegistry registry;
+    return registry;
+  }
+
+  /**
+   * @brief Get the shared env. When `options.use_global_thread_pool` is set and the env does not
+   * exist yet, it is created with global thread pools sized by `options`.
+   */
+  std::shared_ptr<Ort::Env> GetEnv(const OrtInferCoreOptions &options)
+  {
+    std::lock_guard<std::mutex> lck(mutex_);
+    auto                        env = env_.lock();
+    if (env != nullptr)
+    {
+      if (options.use_global_thread_pool && !env_has_global_thread_pool_)
+      {
+        LOG_WARN("[ort_core] The shared onnxruntime env was created without global thread pools, "
+                 "fall back to per-session threads");
+      }
+      return env;
+    }
+
+    if (options.use_global_thread_pool)
+    {
+      Ort::ThreadingOptions threading_options;
+      threading_options.SetGlobalIntraOpNumThreads(options.intra_op_num_threads);
+      threading_options.SetGlobalInterOpNumThreads(options.inter_op_num_threads);
+      threading_options.SetGlobalSpinControl(options.allow_spinning ? 1 : 0);
+      if (!options.intra_op_thread_affinities.empty())
+      {
+        Ort::ThrowOnError(Ort::GetApi().SetGlobalIntraOpThreadAffinity(
+            threading_options, options.intra_op_thread_affinities.c_str()));
+      }
+      env = std::make_shared<Ort::Env>(threading_options, ORT_LOGGING_LEVEL_ERROR, "ort_core");
+    } else
+    {
+      env = std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_ERROR, "ort_core");
+    }
+    env_has_global_thread_pool_ = options.use_global_thread_pool;
+    env_                        = env;
+    return env;
+  }
+
+  bool HasGlobalThreadPool() noexcept
+  {
+    std::lock_guard<std::mutex> lck(mutex_);
+    return env_has_global_thread_pool_ && !env_.expired();
+  }
+
+  /**
+   * @brief Get the prepacked weights container shared by the sessions of the same model file.
+   */
+  std::shared_ptr<OrtPrepackedWeightsContainer> GetPrepackedWeightsContainer(
+      const std::string &model_path)
+  {
+    std::error_code   ec;
+    const std::string key = std::filesystem::weakly_canonical(model_path, ec).string();
+
+    std::lock_guard<std::mutex> lck(mutex_);
+    auto                        container = map_model2container_[key].lock();
+    if (container == nullptr)
+    {
+      OrtPrepackedWeightsContainer *raw_container = nullptr;
+      Ort::ThrowOnError(Ort::GetApi().CreatePrepackedWeightsContainer(&raw_container));
+      container = std::shared_ptr<OrtPrepackedWeightsContainer>(
+          raw_container, [](OrtPrepackedWeightsContainer *ptr) {
+            Ort::GetApi().ReleasePrepackedWeightsContainer(ptr);
+          });
+      map_model2container_[key] = container;
+    }
+    return container;
+  }
+
+private:
+  OrtEnvRegistry() = default;
+
+  std::mutex              mutex_;
+  std::weak_ptr<Ort::Env> env_;
+  bool                    env_has_global_thread_pool_{false};
+
+  std::unordered_map<std::string, std::weak_ptr<OrtPrepackedWeightsContainer>> map_model2container_;
+};
+
+} // namespace easy_deploy
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <onnxruntime_cxx_api.h>
+
+#include "common_utils/log.hpp"
+
+namespace easy_deploy {
+
+/**
+ * @brief On-disk cache of the graph optimized by onnxruntime, saved in ORT format. The cache
+ * key is made of the model file content, the graph optimization level, the onnxruntime
+ * version, the execution provider and the cpu model and features of the host, so a changed
+ * model, an upgraded runtime or a cache directory shared with a different machine never loads
+ * a stale artifact.
+ *
+ * Usage:
+ *   1. `Hit()` : load `GetCachedModelPath()` with graph optimizations disabled.
+ *   2. otherwise, if `Enabled()` : pass `GetTempModelPath()` to `SetOptimizedModelFilePath`,
+ *      create the session, then `Commit()`.
+ */
+class OrtOptimizedModelCache {
+public:
+  OrtOptimizedModelCache(const std::string &cache_dir,
+                         const std::string &onnx_path,
+                         int                graph_opt_level,
+                         const std::string &execution_provider)
+  {
+    if (cache_dir.empty())
+    {
+      return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    if (ec)
+    {
+      LOG_WARN("[ort_core] Failed to create optimized model cache dir {%s} : %s, cache disabled",
+               cache_dir.c_str(), ec.message().c_str());
+      return;
+    }
+
+    uint64_t model_hash = 0;
+    if (!HashFile(onnx_path, model_hash))
+    {
+      LOG_WARN("[ort_core] Failed to read model {%s}, optimized model cache disabled",
+               onnx_path.c_str());
+      return;
+    }
+    // the optimizers pick the layouts and fused kernels for the execution provider and the cpu
+    // features they find
+    const std::string key_str = std::to_string(model_hash) + "|" +
+                                std::to_string(graph_opt_level) + "|" + Ort::GetVersionString() +
+                                "|" + execution_provider + "|" + GetCpuFingerprint();
+    uint64_t          key     = kFnvOffsetBasis;
+    HashBytes(key_str.data(), key_str.size(), key);
+
+    char key_hex[17];
+    snprintf(key_hex, sizeof(key_hex), "%016llx", static_cast<unsigned long long>(key));
+    const auto cache_base = std::filesystem::path(cache_dir) /
+                            (std::filesystem::path(onnx_path).stem().string() + "_" + key_hex);
+
+    cached_model_path_ = cache_base.string() + ".ort";
+    // unique per process, concurrent workers never write to the same file
+    temp_model_path_   = cache_base.string() + "." + std::to_string(getpid()) + ".tmp.ort";
+    enabled_           = true;
+    hit_               = std::filesystem::exists(cached_model_path_, ec);
+  }
+
+  bool Enabled() const noexcept
+  {
+    return enabled_;
+  }
+
+  bool Hit() const noexcept
+  {
+    return hit_;
+  }
+
+  const std::string &GetCachedModelPath() const noexcept
+  {
+    return cached_model_path_;
+  }
+
+  const std::string &GetTempModelPath() const noexcept
+  {
+    return temp_model_path_;
+  }
+
+  /**
+   * @brief Publish the freshly written artifact. `rename` is atomic, a concurrent reader either
+   * sees the complete file or nothing.
+   */
+  void Commit() noexcept
+  {
+    if (std::rename(temp_model_path_.c_str(), cached_model_path_.c_str()) != 0)
+    {
+      LOG_WARN("[ort_core] Failed to publish optimized model cache : %s",
+               cached_model_path_.c_str());
+      Discard();
+    }
+  }
+
+  /**
+   * @brief Drop a cached artifact which onnxruntime failed to load, it is rebuilt on the next
+   * start.
+   */
+  void Invalidate() noexcept
+  {
+    std::error_code ec;
+    std::filesystem::remove(cached_model_path_, ec);
+    hit_ = false;
+  }
+
+  void Discard() noexcept
+  {
+    std::error_code ec;
+    std::filesystem::remove(temp_model_path_, ec);
+  }
+
+private:
+  static constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+  static constexpr uint64_t kFnvPrime       = 1099511628211ULL;
+
+  static void HashBytes(const char *data, size_t size, uint64_t &hash) noexcept
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= kFnvPrime;
+    }
+  }
+
+  /**
+   * @brief The cpu model and feature flags of the host from `/proc/cpuinfo`, e.g. `flags` on
+   * x86_64 and `Features` on aarch64. Empty if it can not be read.
+   */
+  static const std::string &GetCpuFingerprint()
+  {
+    static const std::string fingerprint = []() {
+      const char *const keys[] = {"vendor_id",       "model name", "flags",
+                                  "CPU implementer", "CPU part",   "Features"};
+      std::string       ret;
+      std::ifstream     cpuinfo("/proc/cpuinfo");
+      std::string       line;
+      // the first processor is enough, the cores of a host share the features
+      while (std::getline(cpuinfo, line) && !line.empty())
+      {
+        const auto colon = line.find(':');
+        if (colon == std::string::npos)
+        {
+          continue;
+        }
+        const std::string key = line.substr(0, line.find_last_not_of(" \t", colon - 1) + 1);
+        for (const char *k : keys)
+        {
+          if (key == k)
+          {
+            ret += line + "\n";
+            break;
+          }
+        }
+      }
+      return ret;
+    }();
+    return fingerprint;
+  }
+
+  static bool HashFile(const std::string &file_path, uint64_t &hash)
+  {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open())
+    {
+      return false;
+    }
+    hash = kFnvOffsetBasis;
+    std::vector<char> chunk(1 << 20);
+    while (file)
+    {
+      file.read(chunk.data(), chunk.size());
+      HashBytes(chunk.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+    return file.eof();
+  }
+
+private:
+  bool        enabled_{false};
+  bool        hit_{false};
+  std::string cached_model_path_;
+  std::string temp_model_path_;
+};
+
+} // namespace easy_deploy
@@ -113,6 +113,8 @@ RknnInferCore::RknnInferCore(
 
   ResolveModelInformation(map_blob_type);
 
+  // the outputs are ready once the inference future completes
+  SetTrivialStages(false, true);
   BaseInferCore::Init(mem_buf_size);
 }
 